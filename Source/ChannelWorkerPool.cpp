@@ -0,0 +1,135 @@
+/*
+  ==============================================================================
+
+    ChannelWorkerPool.cpp
+
+  ==============================================================================
+*/
+
+#include "ChannelWorkerPool.h"
+
+#if JUCE_WINDOWS
+ #include <windows.h>
+#elif JUCE_MAC || JUCE_IOS
+ #include <dispatch/dispatch.h>
+#else
+ #include <semaphore.h>
+ #include <cerrno>
+#endif
+
+//==============================================================================
+#if JUCE_WINDOWS
+ChannelWorkerPool::Semaphore::Semaphore()      : handle (CreateSemaphoreW (nullptr, 0, LONG_MAX, nullptr)) {}
+ChannelWorkerPool::Semaphore::~Semaphore()     { CloseHandle (handle); }
+void ChannelWorkerPool::Semaphore::post() noexcept  { ReleaseSemaphore (handle, 1, nullptr); }
+void ChannelWorkerPool::Semaphore::wait() noexcept  { WaitForSingleObject (handle, INFINITE); }
+#elif JUCE_MAC || JUCE_IOS
+ChannelWorkerPool::Semaphore::Semaphore()      : handle (dispatch_semaphore_create (0)) {}
+ChannelWorkerPool::Semaphore::~Semaphore()     { dispatch_release ((dispatch_semaphore_t) handle); }
+void ChannelWorkerPool::Semaphore::post() noexcept  { dispatch_semaphore_signal ((dispatch_semaphore_t) handle); }
+void ChannelWorkerPool::Semaphore::wait() noexcept  { dispatch_semaphore_wait ((dispatch_semaphore_t) handle, DISPATCH_TIME_FOREVER); }
+#else
+ChannelWorkerPool::Semaphore::Semaphore()      : handle (new sem_t)   { sem_init ((sem_t*) handle, 0, 0); }
+ChannelWorkerPool::Semaphore::~Semaphore()     { sem_destroy ((sem_t*) handle); delete (sem_t*) handle; }
+void ChannelWorkerPool::Semaphore::post() noexcept  { sem_post ((sem_t*) handle); }
+
+void ChannelWorkerPool::Semaphore::wait() noexcept
+{
+    while (sem_wait ((sem_t*) handle) != 0 && errno == EINTR) {}
+}
+#endif
+
+//==============================================================================
+ChannelWorkerPool::Worker::Worker (ChannelWorkerPool& p, int l, const juce::AudioWorkgroup& w)
+    : juce::Thread ("PitchShifter channel worker " + juce::String (l)), pool (p), lane (l), workgroup (w)
+{
+}
+
+void ChannelWorkerPool::Worker::run()
+{
+    // a workgroup has to be joined from the thread itself; without one this does nothing
+    juce::WorkgroupToken token;
+    workgroup.join (token);
+
+    for (;;)
+    {
+        wake.wait();
+
+        if (threadShouldExit())
+            return;
+
+        pool.workOn (lane);
+    }
+}
+
+//==============================================================================
+ChannelWorkerPool::~ChannelWorkerPool()
+{
+    stop();
+}
+
+void ChannelWorkerPool::start (int numWorkers, int blockSize, double sampleRate, const juce::AudioWorkgroup& workgroup)
+{
+    stop();
+
+    const auto options = juce::Thread::RealtimeOptions{}.withApproximateAudioProcessingTime (blockSize, sampleRate);
+
+    for (int i = 0; i < numWorkers; ++i)
+    {
+        auto* worker = workers.add (new Worker (*this, i + 1, workgroup));
+
+        // real-time scheduling can be refused, e.g. on Linux without the rtprio limit
+        if (! worker->startRealtimeThread (options))
+            worker->startThread (juce::Thread::Priority::highest);
+    }
+}
+
+void ChannelWorkerPool::stop()
+{
+    for (auto* worker : workers)
+    {
+        worker->signalThreadShouldExit();
+        worker->wake.post();
+    }
+
+    for (auto* worker : workers)
+        worker->stopThread (1000);
+
+    workers.clear();
+}
+
+void ChannelWorkerPool::run (Job& job, int numJobs) noexcept
+{
+    // every job of the previous call has finished, so nothing can still be reading currentJob
+    currentJob = &job;
+    numDone.store (0, std::memory_order_relaxed);
+    claims.store ((uint64_t) numJobs << 32, std::memory_order_release);
+
+    const int numToWake = juce::jlimit (0, workers.size(), numJobs - 1);
+
+    for (int i = 0; i < numToWake; ++i)
+        workers.getUnchecked (i)->wake.post();
+
+    workOn (0);
+
+    // anything left was claimed by a worker that's already running it, so it
+    // can't be taken back; spin for a while, then give the worker the core
+    for (int spins = 0; numDone.load (std::memory_order_acquire) < numJobs; ++spins)
+        if (spins >= 1000)
+            std::this_thread::yield();
+}
+
+void ChannelWorkerPool::workOn (int lane) noexcept
+{
+    for (;;)
+    {
+        const auto claim = claims.fetch_add (1, std::memory_order_acq_rel);
+        const int index = (int) (claim & 0xffffffff);
+
+        if (index >= (int) (claim >> 32))
+            return;
+
+        currentJob->runJob (index, lane);
+        numDone.fetch_add (1, std::memory_order_release);
+    }
+}
@@ -0,0 +1,100 @@
+/*
+  ==============================================================================
+
+    ChannelWorkerPool.h
+    A small fixed pool of threads that helps the audio thread render channels.
+
+    The threads are started in prepareToPlay at real-time priority, joined
+    to the host's audio workgroup where there is one, and then sleep on a
+    semaphore. run() posts the semaphores, which takes no lock, and hands out
+    job indices through an atomic counter. The calling thread claims jobs
+    too, so any a late worker hasn't reached yet are rendered inline, and
+    the call only ever waits for jobs a worker has already started.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+class ChannelWorkerPool
+{
+public:
+    /** Work handed to the pool; runJob is called once per index, with the
+        lane (0 = calling thread) telling it which scratch set to use.
+    */
+    struct Job
+    {
+        virtual ~Job() = default;
+        virtual void runJob (int index, int lane) noexcept = 0;
+    };
+
+    ChannelWorkerPool() = default;
+    ~ChannelWorkerPool();
+
+    /** Starts numWorkers helper threads, stopping any previous ones. The block
+        size and rate tell the scheduler how much work to expect each period.
+        Not real-time safe.
+    */
+    void start (int numWorkers, int blockSize, double sampleRate,
+                const juce::AudioWorkgroup& workgroup = {});
+
+    /** Stops and joins the helper threads. */
+    void stop();
+
+    /** Number of threads that may run jobs at once, including the caller. */
+    int getNumLanes() const noexcept        { return workers.size() + 1; }
+
+    /** Runs job.runJob (i, lane) for every i in [0, numJobs) and returns once
+        all of them have finished. Called from the audio thread.
+    */
+    void run (Job& job, int numJobs) noexcept;
+
+private:
+    /** A counting semaphore from the OS. post() is an atomic increment that
+        only enters the kernel when a thread is asleep on it, with no mutex,
+        unlike juce::WaitableEvent.
+    */
+    class Semaphore
+    {
+    public:
+        Semaphore();
+        ~Semaphore();
+
+        void post() noexcept;
+        void wait() noexcept;
+
+    private:
+        void* handle = nullptr;
+
+        JUCE_DECLARE_NON_COPYABLE (Semaphore)
+    };
+
+    class Worker  : public juce::Thread
+    {
+    public:
+        Worker (ChannelWorkerPool& p, int l, const juce::AudioWorkgroup& w);
+        void run() override;
+
+        Semaphore wake;
+
+    private:
+        ChannelWorkerPool& pool;
+        int lane;
+        juce::AudioWorkgroup workgroup;
+    };
+
+    void workOn (int lane) noexcept;
+
+    juce::OwnedArray<Worker> workers;
+
+    // the job count sits in the top half of claims and the next index in the
+    // bottom half, so one fetch_add tells a worker both its index and how many
+    // jobs the call it landed in has, even when it woke late for an earlier one
+    Job* currentJob = nullptr;
+    std::atomic<uint64_t> claims { 0 };
+    std::atomic<int> numDone { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ChannelWorkerPool)
+};
@@ -0,0 +1,380 @@
+/*
+  ==============================================================================
+
+    DelayLine.cpp
+
+  ==============================================================================
+*/
+
+#include "DelayLine.h"
+#include "SimdOps.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+namespace
+{
+    constexpr size_t cacheLineBytes = 64;
+
+    // longest run the interpolators gather at once
+    constexpr int maxGather = 64;
+
+    template <typename SampleType>
+    size_t roundUpToCacheLine (size_t numSamples)
+    {
+        constexpr size_t perLine = cacheLineBytes / sizeof (SampleType);
+        return (numSamples + perLine - 1) / perLine * perLine;
+    }
+
+    //==============================================================================
+    // the sinc kernel spans sincTaps samples, sincTaps / 2 - 1 before the read
+    // position and sincTaps / 2 after it, tabulated at sincPhases fractional offsets
+    constexpr int sincTaps = 16;
+    constexpr int sincPhases = 256;
+    constexpr int sincFirstTap = -(sincTaps / 2 - 1);
+
+    // furthest any interpolator reads behind the sample before the read position
+    constexpr int maxLookback = -sincFirstTap;
+    constexpr double sincCutoff = 0.9;
+
+    static_assert (sincTaps / 2 <= DelayLine<float>::guardSamples, "sinc kernel must fit inside the guard");
+    static_assert (sincTaps % SimdOps::FloatVec::size == 0 && sincTaps % SimdOps::DoubleVec::size == 0,
+                   "sinc kernel must be a whole number of vectors");
+
+    template <typename SampleType>
+    using SincTable = std::array<SampleType, (size_t) ((sincPhases + 1) * sincTaps)>;
+
+    template <typename SampleType>
+    SincTable<SampleType> makeSincTable()
+    {
+        constexpr double pi = 3.14159265358979323846;
+        constexpr double halfWidth = sincTaps / 2;
+        SincTable<SampleType> table;
+        double coefficients[sincTaps];
+
+        // one extra phase so the coefficient blend between phases never wraps
+        for (int phase = 0; phase <= sincPhases; ++phase)
+        {
+            const double frac = (double) phase / sincPhases;
+            auto* row = table.data() + phase * sincTaps;
+            double sum = 0.0;
+
+            for (int tap = 0; tap < sincTaps; ++tap)
+            {
+                const double x = (sincFirstTap + tap) - frac;
+                const double arg = pi * sincCutoff * x;
+                const double sincValue = x == 0.0 ? 1.0 : std::sin (arg) / arg;
+                const double w = (x + halfWidth) / (2.0 * halfWidth);
+                const double blackman = 0.42 - 0.5 * std::cos (2.0 * pi * w) + 0.08 * std::cos (4.0 * pi * w);
+
+                coefficients[tap] = sincValue * blackman;
+                sum += coefficients[tap];
+            }
+
+            // unity gain at DC for every phase
+            for (int tap = 0; tap < sincTaps; ++tap)
+                row[tap] = (SampleType) (coefficients[tap] / sum);
+        }
+
+        return table;
+    }
+
+    template <typename SampleType>
+    const SincTable<SampleType>& getSincTable()
+    {
+        static const SincTable<SampleType> table = makeSincTable<SampleType>();
+        return table;
+    }
+
+    //==============================================================================
+    template <typename SampleType>
+    void interpolateLinear (const SampleType* ring, const int* index, const SampleType* frac, SampleType* out, int numSamples) noexcept
+    {
+        using Vec = SimdOps::Vec<SampleType>;
+        SampleType x0[maxGather], x1[maxGather];
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            x0[i] = ring[index[i]];
+            x1[i] = ring[index[i] + 1];
+        }
+
+        const int vecLength = SimdOps::vectorisedLength<SampleType> (numSamples);
+
+        for (int i = 0; i < vecLength; i += Vec::size)
+        {
+            const auto a = Vec::load (x0 + i);
+            (a + Vec::load (frac + i) * (Vec::load (x1 + i) - a)).store (out + i);
+        }
+
+        for (int i = vecLength; i < numSamples; ++i)
+            out[i] = x0[i] + frac[i] * (x1[i] - x0[i]);
+    }
+
+    template <bool useLagrange, typename SampleType>
+    void interpolateCubic (const SampleType* ring, const int* index, const SampleType* frac, SampleType* out, int numSamples) noexcept
+    {
+        using Vec = SimdOps::Vec<SampleType>;
+        SampleType xm1[maxGather], x0[maxGather], x1[maxGather], x2[maxGather];
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            const SampleType* p = ring + index[i];
+            xm1[i] = p[-1];
+            x0[i]  = p[0];
+            x1[i]  = p[1];
+            x2[i]  = p[2];
+        }
+
+        const auto zero = Vec::fill ((SampleType) 0);
+        const auto half = Vec::fill ((SampleType) 0.5);
+        const auto one = Vec::fill ((SampleType) 1);
+        const auto two = Vec::fill ((SampleType) 2);
+        const auto sixth = Vec::fill ((SampleType) 1 / (SampleType) 6);
+        const int vecLength = SimdOps::vectorisedLength<SampleType> (numSamples);
+
+        for (int i = 0; i < vecLength; i += Vec::size)
+        {
+            const auto ym1 = Vec::load (xm1 + i);
+            const auto y0  = Vec::load (x0 + i);
+            const auto y1  = Vec::load (x1 + i);
+            const auto y2  = Vec::load (x2 + i);
+            const auto x   = Vec::load (frac + i);
+
+            if (useLagrange)
+            {
+                const auto xp1 = x + one;
+                const auto xm1v = x - one;
+                const auto xm2 = x - two;
+                const auto cm1 = zero - x * xm1v * xm2 * sixth;
+                const auto c0  = xp1 * xm1v * xm2 * half;
+                const auto c1  = zero - xp1 * x * xm2 * half;
+                const auto c2  = xp1 * x * xm1v * sixth;
+
+                (ym1 * cm1 + y0 * c0 + y1 * c1 + y2 * c2).store (out + i);
+            }
+            else
+            {
+                const auto b = half * (y1 - ym1);
+                const auto c = ym1 - Vec::fill ((SampleType) 2.5) * y0 + two * y1 - half * y2;
+                const auto d = half * (y2 - ym1) + Vec::fill ((SampleType) 1.5) * (y0 - y1);
+
+                (((d * x + c) * x + b) * x + y0).store (out + i);
+            }
+        }
+
+        for (int i = vecLength; i < numSamples; ++i)
+        {
+            const SampleType x = frac[i];
+
+            if (useLagrange)
+            {
+                out[i] = -xm1[i] * x * (x - 1) * (x - 2) / 6
+                       + x0[i] * (x + 1) * (x - 1) * (x - 2) / 2
+                       - x1[i] * (x + 1) * x * (x - 2) / 2
+                       + x2[i] * (x + 1) * x * (x - 1) / 6;
+            }
+            else
+            {
+                const SampleType b = (SampleType) 0.5 * (x1[i] - xm1[i]);
+                const SampleType c = xm1[i] - (SampleType) 2.5 * x0[i] + 2 * x1[i] - (SampleType) 0.5 * x2[i];
+                const SampleType d = (SampleType) 0.5 * (x2[i] - xm1[i]) + (SampleType) 1.5 * (x0[i] - x1[i]);
+
+                out[i] = ((d * x + c) * x + b) * x + x0[i];
+            }
+        }
+    }
+
+    template <typename SampleType>
+    void interpolateSinc (const SampleType* ring, const int* index, const SampleType* frac, SampleType* out, int numSamples) noexcept
+    {
+        using Vec = SimdOps::Vec<SampleType>;
+        const SampleType* table = getSincTable<SampleType>().data();
+
+        // the taps are contiguous in both the history and the table, so each
+        // output is a short vector dot product with coefficients blended between phases
+        for (int i = 0; i < numSamples; ++i)
+        {
+            // locate() keeps frac below 1, but a phase past the last row would
+            // blend with one beyond the end of the table
+            const SampleType phasePos = frac[i] * (SampleType) sincPhases;
+            const int phase = std::min ((int) phasePos, sincPhases - 1);
+            const auto blend = Vec::fill (phasePos - (SampleType) phase);
+            const SampleType* c0 = table + phase * sincTaps;
+            const SampleType* c1 = c0 + sincTaps;
+            const SampleType* p = ring + index[i] + sincFirstTap;
+            auto acc = Vec::fill ((SampleType) 0);
+
+            for (int tap = 0; tap < sincTaps; tap += Vec::size)
+            {
+                const auto a = Vec::load (c0 + tap);
+                const auto coeff = a + blend * (Vec::load (c1 + tap) - a);
+                acc = acc + Vec::load (p + tap) * coeff;
+            }
+
+            out[i] = acc.sum();
+        }
+    }
+}
+
+//==============================================================================
+int Interpolation::getLookahead (Type type) noexcept
+{
+    switch (type)
+    {
+        case hermite:
+        case lagrange:  return 2;
+        case sinc:      return sincTaps / 2;
+        case linear:
+        default:        return 1;
+    }
+}
+
+const char* Interpolation::getName (Type type) noexcept
+{
+    switch (type)
+    {
+        case linear:    return "Linear";
+        case hermite:   return "Hermite";
+        case lagrange:  return "Lagrange";
+        case sinc:      return "Sinc";
+        default:        return "";
+    }
+}
+
+//==============================================================================
+template <typename SampleType>
+void DelayLine<SampleType>::prepare (int newNumChannels, int maxDelaySamples, int maxBlockSize)
+{
+    numChannels = newNumChannels > 0 ? newNumChannels : 0;
+
+    // a read can reach maxDelaySamples behind the last sample of the block, plus
+    // the samples the widest interpolator looks at either side of it
+    const int needed = std::max (1, maxDelaySamples) + std::max (1, maxBlockSize) + 1 + maxLookback;
+
+    capacity = 2 * guardSamples;
+    while (capacity < needed)
+        capacity <<= 1;
+
+    mask = capacity - 1;
+    channelStride = roundUpToCacheLine<SampleType> ((size_t) (capacity + 2 * guardSamples));
+
+    // over-allocate by one cache line and align the start by hand
+    constexpr size_t perLine = cacheLineBytes / sizeof (SampleType);
+    storage.assign (channelStride * (size_t) numChannels + perLine, SampleType());
+
+    const auto address = reinterpret_cast<std::uintptr_t> (storage.data());
+    const auto misalignment = (address / sizeof (SampleType)) % perLine;
+    data = storage.data() + (misalignment == 0 ? 0 : perLine - misalignment);
+
+    // built here rather than on the first sinc read from the audio thread
+    getSincTable<SampleType>();
+
+    reset();
+}
+
+template <typename SampleType>
+void DelayLine<SampleType>::release()
+{
+    storage = {};
+    data = nullptr;
+    numChannels = capacity = mask = 0;
+    blockStart = writePos = 0;
+}
+
+template <typename SampleType>
+void DelayLine<SampleType>::reset() noexcept
+{
+    std::fill (storage.begin(), storage.end(), SampleType());
+    blockStart = 0;
+    writePos = 0;
+}
+
+template <typename SampleType>
+void DelayLine<SampleType>::write (const SampleType* const* channelData, int numChannelsToWrite, int numSamples) noexcept
+{
+    if (capacity == 0 || numSamples <= 0)
+        return;
+
+    // a block longer than the ring only needs its newest capacity samples
+    const int skip = numSamples > capacity ? numSamples - capacity : 0;
+    const int toWrite = numSamples - skip;
+    const int start = (writePos + skip) & mask;
+    const int firstPart = std::min (toWrite, capacity - start);
+    const int channelsToWrite = std::min (numChannelsToWrite, numChannels);
+
+    for (int ch = 0; ch < numChannels; ++ch)
+    {
+        auto* ring = getChannel (ch);
+
+        if (ch < channelsToWrite)
+        {
+            const SampleType* src = channelData[ch] + skip;
+            std::memcpy (ring + start, src, sizeof (SampleType) * (size_t) firstPart);
+            std::memcpy (ring, src + firstPart, sizeof (SampleType) * (size_t) (toWrite - firstPart));
+        }
+        else
+        {
+            std::memset (ring + start, 0, sizeof (SampleType) * (size_t) firstPart);
+            std::memset (ring, 0, sizeof (SampleType) * (size_t) (toWrite - firstPart));
+        }
+
+        // refresh the mirrors so reads either side of the wrap see the other end
+        std::memcpy (ring - guardSamples, ring + capacity - guardSamples, sizeof (SampleType) * guardSamples);
+        std::memcpy (ring + capacity, ring, sizeof (SampleType) * guardSamples);
+    }
+
+    blockStart = writePos;
+    writePos = (writePos + numSamples) & mask;
+}
+
+//==============================================================================
+template <typename SampleType>
+void DelayLine<SampleType>::locate (double pos, const SampleType* delays, int* index, SampleType* frac, int numSamples) const noexcept
+{
+    const SampleType belowOne = std::nextafter ((SampleType) 1, (SampleType) 0);
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        const double readPos = pos + i - delays[i];
+        const double whole = std::floor (readPos);
+
+        index[i] = (blockStart + (int) whole) & mask;
+
+        // a fraction a hair under 1 rounds up to exactly 1 in float
+        frac[i] = std::min ((SampleType) (readPos - whole), belowOne);
+    }
+}
+
+template <typename SampleType>
+void DelayLine<SampleType>::readInterpBlock (int channel, double pos, const SampleType* delays, SampleType* out,
+                                             int numSamples, Interpolation::Type type) const noexcept
+{
+    static_assert (chunkSize <= maxGather, "chunks must fit the interpolators' gather rows");
+
+    const SampleType* ring = getChannel (channel);
+    int index[chunkSize];
+    SampleType frac[chunkSize];
+
+    for (int start = 0; start < numSamples; start += chunkSize)
+    {
+        const int num = std::min (chunkSize, numSamples - start);
+        locate (pos + start, delays + start, index, frac, num);
+
+        switch (type)
+        {
+            case Interpolation::hermite:   interpolateCubic<false> (ring, index, frac, out + start, num); break;
+            case Interpolation::lagrange:  interpolateCubic<true> (ring, index, frac, out + start, num); break;
+            case Interpolation::sinc:      interpolateSinc (ring, index, frac, out + start, num); break;
+            case Interpolation::linear:
+            case Interpolation::numTypes:
+            default:                       interpolateLinear (ring, index, frac, out + start, num); break;
+        }
+    }
+}
+
+template class DelayLine<float>;
+template class DelayLine<double>;
@@ -0,0 +1,117 @@
+/*
+  ==============================================================================
+
+    DelayLine.h
+    Multichannel input history the grain taps read from.
+
+    Each channel holds a power-of-two number of samples, so wrapping a read
+    position is a single mask. The ring is bordered by guard samples that
+    mirror its opposite end, which lets an interpolator look a few samples
+    either side of any position without checking for the wrap. Channels start
+    on cache-line boundaries and are sized from the longest delay actually
+    needed rather than a fixed second of audio.
+
+    readInterpBlock() serves a whole run of fractional-delay reads at once:
+    positions are resolved in one pass, the neighbouring samples gathered
+    into rows, and the interpolation itself done a vector at a time.
+
+    The line is templated on sample type and instantiated for float and double.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace Interpolation
+{
+    enum Type
+    {
+        linear = 0,
+        hermite,        // 4-point Catmull-Rom
+        lagrange,       // 4-point, third order
+        sinc,           // 16-tap Blackman-windowed, polyphase
+        numTypes
+    };
+
+    /** Samples past the read position each interpolator looks at. A read
+        closer than this to the write head picks up stale history.
+    */
+    int getLookahead (Type type) noexcept;
+
+    /** Display names, in Type order. */
+    const char* getName (Type type) noexcept;
+}
+
+template <typename SampleType>
+class DelayLine
+{
+public:
+    /** Samples mirrored either side of the ring; enough for the widest interpolator. */
+    static constexpr int guardSamples = 16;
+
+    DelayLine() = default;
+
+    /** Sizes the history to hold maxDelaySamples behind a block of up to
+        maxBlockSize samples, rounded up to a power of two. Not real-time safe.
+    */
+    void prepare (int numChannels, int maxDelaySamples, int maxBlockSize);
+
+    /** Frees the history. */
+    void release();
+
+    /** Fills the history with silence. */
+    void reset() noexcept;
+
+    /** Appends a block to every channel. The block becomes the reference for
+        subsequent reads: position 0 is its first sample.
+    */
+    void write (const SampleType* const* channelData, int numChannels, int numSamples) noexcept;
+
+    /** Returns channel's history at pos - delay samples from the start of the
+        last written block, linearly interpolated.
+    */
+    SampleType readInterpSample (int channel, double pos, double delay) const noexcept
+    {
+        const double readPos = pos - delay;
+        const int whole = (int) readPos - (readPos < (int) readPos ? 1 : 0);
+        const auto frac = (SampleType) (readPos - whole);
+        const SampleType* p = getChannel (channel) + ((blockStart + whole) & mask);
+
+        return p[0] + frac * (p[1] - p[0]);
+    }
+
+    /** Fills out[i] with channel's history at pos + i - delays[i], using the
+        given interpolator. Safe to call from several threads at once.
+    */
+    void readInterpBlock (int channel, double pos, const SampleType* delays, SampleType* out,
+                          int numSamples, Interpolation::Type type) const noexcept;
+
+    /** Ring length per channel, a power of two. */
+    int getCapacity() const noexcept            { return capacity; }
+
+    /** Total bytes of sample storage across all channels. */
+    size_t getMemoryBytes() const noexcept      { return storage.size() * sizeof (SampleType); }
+
+private:
+    // reads are resolved and gathered this many at a time, in stack arrays
+    static constexpr int chunkSize = 64;
+
+    void locate (double pos, const SampleType* delays, int* index, SampleType* frac, int numSamples) const noexcept;
+
+    const SampleType* getChannel (int channel) const noexcept   { return data + (size_t) channel * channelStride + guardSamples; }
+    SampleType* getChannel (int channel) noexcept               { return data + (size_t) channel * channelStride + guardSamples; }
+
+    int numChannels = 0;
+    int capacity = 0;
+    int mask = 0;
+    int blockStart = 0;
+    int writePos = 0;
+
+    // guard + ring + guard per channel, padded so each channel starts on a cache line
+    size_t channelStride = 0;
+    std::vector<SampleType> storage;
+    SampleType* data = nullptr;
+};
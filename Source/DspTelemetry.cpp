@@ -0,0 +1,109 @@
+/*
+  ==============================================================================
+
+    DspTelemetry.cpp
+
+  ==============================================================================
+*/
+
+#include "DspTelemetry.h"
+
+const char* DspTelemetry::getStageName (Stage stage) noexcept
+{
+    switch (stage)
+    {
+        case midiStage:         return "midi";
+        case historyStage:      return "history";
+        case resamplingStage:   return "resampling";
+        case kernelStage:       return "kernel";
+        case outputStage:       return "output";
+        default:                return "";
+    }
+}
+
+juce::String DspTelemetry::getCsvHeader()
+{
+    juce::String header ("samples,budget_us,total_us");
+
+    for (int stage = 0; stage < numStages; ++stage)
+        header << "," << getStageName ((Stage) stage) << "_us";
+
+    return header + ",load,state";
+}
+
+juce::String DspTelemetry::toCsvRow (const BlockStats& stats)
+{
+    juce::String row;
+    row << stats.numSamples << "," << juce::String (stats.budget * 1.0e6, 2) << "," << juce::String (stats.total * 1.0e6, 2);
+
+    for (int stage = 0; stage < numStages; ++stage)
+        row << "," << juce::String (stats.stages[stage] * 1.0e6, 2);
+
+    row << "," << juce::String (stats.budget > 0.0 ? stats.total / stats.budget : 0.0, 4) << "," << stats.processingState;
+    return row;
+}
+
+#if PITCHSHIFTER_TELEMETRY
+void DspTelemetry::prepare (double newSampleRate) noexcept
+{
+    sampleRate = newSampleRate;
+    fifo.reset();
+    numOverruns = 0;
+    numDropped = 0;
+}
+
+void DspTelemetry::beginBlock (int numSamples) noexcept
+{
+    current = {};
+    current.numSamples = numSamples;
+    current.budget = numSamples / sampleRate;
+    activeStage = -1;
+    blockStart = juce::Time::getHighResolutionTicks();
+}
+
+int DspTelemetry::switchStage (int newStage) noexcept
+{
+    const auto now = juce::Time::getHighResolutionTicks();
+
+    if (activeStage >= 0)
+        current.stages[activeStage] += juce::Time::highResolutionTicksToSeconds (now - stageStart);
+
+    const int previous = activeStage;
+    activeStage = newStage;
+    stageStart = now;
+
+    return previous;
+}
+
+void DspTelemetry::endBlock() noexcept
+{
+    current.total = juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - blockStart);
+
+    if (current.total > current.budget)
+        ++numOverruns;
+
+    int start1, size1, start2, size2;
+    fifo.prepareToWrite (1, start1, size1, start2, size2);
+
+    if (size1 + size2 == 0)
+    {
+        ++numDropped;
+        return;
+    }
+
+    queue[size1 > 0 ? start1 : start2] = current;
+    fifo.finishedWrite (1);
+}
+
+int DspTelemetry::pull (BlockStats* dest, int maxBlocks) noexcept
+{
+    int start1, size1, start2, size2;
+    fifo.prepareToRead (maxBlocks, start1, size1, start2, size2);
+
+    std::copy (queue + start1, queue + start1 + size1, dest);
+    std::copy (queue + start2, queue + start2 + size2, dest + size1);
+
+    fifo.finishedRead (size1 + size2);
+    return size1 + size2;
+}
+#endif
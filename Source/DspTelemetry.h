@@ -0,0 +1,136 @@
+/*
+  ==============================================================================
+
+    DspTelemetry.h
+    Per-block timing of the processor's stages, handed to the editor.
+
+    The audio thread stamps each stage with the high-resolution clock and
+    adds the time to the block's record. Stages nest: an inner stage pauses
+    the one around it, so each is charged only its own time. At the end of
+    the block the record goes into a juce::AbstractFifo, which is wait-free
+    for one writer and one reader. When nobody is reading, records are
+    dropped rather than waited for. A block counts as an overrun when it
+    took longer than the audio it covers.
+
+    Build with PITCHSHIFTER_TELEMETRY=0 (the "Release No Telemetry"
+    configuration) and every call below becomes an empty inline function.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+#ifndef PITCHSHIFTER_TELEMETRY
+ #define PITCHSHIFTER_TELEMETRY 1
+#endif
+
+class DspTelemetry
+{
+public:
+    enum Stage
+    {
+        midiStage = 0,          // MIDI events
+        historyStage,           // writing the delay line
+        resamplingStage,        // oversampling up and down
+        kernelStage,            // grain engine or phase vocoder
+        outputStage,            // dry/wet mix and output gain
+        numStages
+    };
+
+    /** One processed block. Times are in seconds. */
+    struct BlockStats
+    {
+        int numSamples = 0;
+        double budget = 0.0;
+        double total = 0.0;
+        double stages[numStages] = {};
+        int processingState = 0;
+    };
+
+    static const char* getStageName (Stage stage) noexcept;
+
+    /** A CSV header line and one row per block, for the editor's log. */
+    static juce::String getCsvHeader();
+    static juce::String toCsvRow (const BlockStats& stats);
+
+   #if PITCHSHIFTER_TELEMETRY
+    static constexpr bool enabled = true;
+
+    DspTelemetry() = default;
+
+    /** Sets the rate used for each block's budget and empties the queue. */
+    void prepare (double sampleRate) noexcept;
+
+    /** Times a whole block, from construction to destruction. */
+    class ScopedBlock
+    {
+    public:
+        ScopedBlock (DspTelemetry& t, int numSamples) noexcept  : telemetry (t)   { telemetry.beginBlock (numSamples); }
+        ~ScopedBlock()                                                         { telemetry.endBlock(); }
+
+    private:
+        DspTelemetry& telemetry;
+    };
+
+    /** Charges the time from construction to destruction to one stage. */
+    class ScopedStage
+    {
+    public:
+        ScopedStage (DspTelemetry& t, Stage s) noexcept  : telemetry (t), outer (t.switchStage (s)) {}
+        ~ScopedStage()                                  { telemetry.switchStage (outer); }
+
+    private:
+        DspTelemetry& telemetry;
+        int outer;
+    };
+
+    /** Tags the block being timed with what the processor did in it. */
+    void setProcessingState (int state) noexcept     { current.processingState = state; }
+
+    /** Copies up to maxBlocks queued records into dest and returns how many. Reader side only. */
+    int pull (BlockStats* dest, int maxBlocks) noexcept;
+
+    /** Blocks that went over budget since prepare(). */
+    juce::int64 getNumOverruns() const noexcept     { return numOverruns.load(); }
+
+    /** Records lost because the queue was full. */
+    juce::int64 getNumDropped() const noexcept      { return numDropped.load(); }
+
+private:
+    static constexpr int queueSize = 1024;
+
+    void beginBlock (int numSamples) noexcept;
+    void endBlock() noexcept;
+
+    // charges the running stage up to now, makes newStage (-1 for none) the running one
+    // and returns the one it replaced
+    int switchStage (int newStage) noexcept;
+
+    double sampleRate = 44100.0;
+    juce::int64 blockStart = 0;
+    juce::int64 stageStart = 0;
+    int activeStage = -1;
+    BlockStats current;
+
+    juce::AbstractFifo fifo { queueSize };
+    BlockStats queue[queueSize];
+    std::atomic<juce::int64> numOverruns { 0 };
+    std::atomic<juce::int64> numDropped { 0 };
+   #else
+    static constexpr bool enabled = false;
+
+    void prepare (double) noexcept {}
+
+    struct ScopedBlock  { ScopedBlock (DspTelemetry&, int) noexcept {} };
+    struct ScopedStage  { ScopedStage (DspTelemetry&, Stage) noexcept {} };
+
+    void setProcessingState (int) noexcept {}
+    int pull (BlockStats*, int) noexcept            { return 0; }
+    juce::int64 getNumOverruns() const noexcept     { return 0; }
+    juce::int64 getNumDropped() const noexcept      { return 0; }
+   #endif
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DspTelemetry)
+};
@@ -0,0 +1,234 @@
+/*
+  ==============================================================================
+
+    GrainKernel.cpp
+
+  ==============================================================================
+*/
+
+#include "GrainKernel.h"
+#include "SimdOps.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace GrainKernel
+{
+    template <typename SampleType>
+    double fillPhasor (SampleType* dest, double phase, double increment, double incrementStep, int numSamples) noexcept
+    {
+        using Vec = SimdOps::Vec<SampleType>;
+
+        // each vector is the running phase plus a per-lane ramp, which only
+        // needs one wrap in either direction while a vector spans less than a cycle
+        const double fastestIncrement = std::max (std::abs (increment), std::abs (increment + incrementStep * numSamples));
+        const int numVectorised = fastestIncrement * Vec::size < 1.0 ? SimdOps::vectorisedLength<SampleType> (numSamples) : 0;
+        int i = 0;
+
+        if (numVectorised > 0)
+        {
+            // lane k is k increments on, plus the k (k - 1) / 2 steps those increments grew by
+            SampleType laneSteps[Vec::size];
+
+            for (int lane = 0; lane < Vec::size; ++lane)
+                laneSteps[lane] = (SampleType) (lane * (lane - 1) / 2);
+
+            const auto lanes = Vec::ramp ((SampleType) 0, (SampleType) 1);
+            const auto steps = Vec::load (laneSteps) * Vec::fill ((SampleType) incrementStep);
+            const auto zero  = Vec::fill ((SampleType) 0);
+            const auto one   = Vec::fill ((SampleType) 1);
+            const double vectorSteps = Vec::size * (Vec::size - 1) / 2;
+
+            for (; i < numVectorised; i += Vec::size)
+            {
+                auto p = Vec::fill ((SampleType) phase) + lanes * Vec::fill ((SampleType) increment) + steps;
+                (p + p.whereBelow (zero, one) - p.whereAtLeast (one, one)).store (dest + i);
+
+                // the phase itself stays in double so long blocks don't drift
+                phase += increment * Vec::size + incrementStep * vectorSteps;
+                phase -= std::floor (phase);
+                increment += incrementStep * Vec::size;
+            }
+        }
+
+        // wrapped in both directions since upward shifts run backwards
+        for (; i < numSamples; ++i)
+        {
+            dest[i] = (SampleType) phase;
+
+            phase += increment;
+            phase -= std::floor (phase);
+            increment += incrementStep;
+        }
+
+        return phase;
+    }
+
+    template <typename SampleType>
+    void offsetPhasor (SampleType* dest, const SampleType* phasor, int numSamples) noexcept
+    {
+        using Vec = SimdOps::Vec<SampleType>;
+
+        const auto half = Vec::fill ((SampleType) 0.5);
+        const auto one  = Vec::fill ((SampleType) 1);
+        const int numVectorised = SimdOps::vectorisedLength<SampleType> (numSamples);
+
+        for (int i = 0; i < numVectorised; i += Vec::size)
+        {
+            auto p = Vec::load (phasor + i) + half;
+            (p - p.whereAtLeast (one, one)).store (dest + i);
+        }
+
+        for (int i = numVectorised; i < numSamples; ++i)
+        {
+            auto p = phasor[i] + (SampleType) 0.5;
+            dest[i] = p >= (SampleType) 1 ? p - (SampleType) 1 : p;
+        }
+    }
+
+    template <typename SampleType>
+    void scale (SampleType* dest, const SampleType* src, SampleType gain, int numSamples) noexcept
+    {
+        using Vec = SimdOps::Vec<SampleType>;
+
+        const auto g = Vec::fill (gain);
+        const int numVectorised = SimdOps::vectorisedLength<SampleType> (numSamples);
+
+        for (int i = 0; i < numVectorised; i += Vec::size)
+            (Vec::load (src + i) * g).store (dest + i);
+
+        for (int i = numVectorised; i < numSamples; ++i)
+            dest[i] = src[i] * gain;
+    }
+
+    template <typename SampleType>
+    void glideDelay (SampleType* dest, const SampleType* phasor, double windowSamps, double windowStep,
+                     double baseDelayStep, int numSamples) noexcept
+    {
+        using Vec = SimdOps::Vec<SampleType>;
+
+        // the sample index is counted exactly and scaled each time, so a long
+        // block doesn't pile up rounding in the window length
+        const auto window     = Vec::fill ((SampleType) windowSamps);
+        const auto windowRate = Vec::fill ((SampleType) windowStep);
+        const auto baseRate   = Vec::fill ((SampleType) baseDelayStep);
+        const auto stride     = Vec::fill ((SampleType) Vec::size);
+        const int numVectorised = SimdOps::vectorisedLength<SampleType> (numSamples);
+        auto index = Vec::ramp ((SampleType) 0, (SampleType) 1);
+
+        for (int i = 0; i < numVectorised; i += Vec::size)
+        {
+            (Vec::load (phasor + i) * (window + windowRate * index) + baseRate * index).store (dest + i);
+            index = index + stride;
+        }
+
+        for (int i = numVectorised; i < numSamples; ++i)
+            dest[i] = (SampleType) ((double) phasor[i] * (windowSamps + windowStep * i) + baseDelayStep * i);
+    }
+
+    // overwrite is a template argument inside so each loop is branch-free
+    template <bool overwrite, typename SampleType>
+    static void mixTapsInto (SampleType* dest,
+                             const SampleType* tapA, const SampleType* envA,
+                             const SampleType* tapB, const SampleType* envB,
+                             SampleType gain, SampleType gainStep, int numSamples) noexcept
+    {
+        using Vec = SimdOps::Vec<SampleType>;
+
+        auto g = Vec::ramp (gain, gainStep);
+        const auto gStep = Vec::fill (gainStep * (SampleType) Vec::size);
+        const int numVectorised = SimdOps::vectorisedLength<SampleType> (numSamples);
+
+        for (int i = 0; i < numVectorised; i += Vec::size)
+        {
+            auto grains = Vec::load (tapA + i) * Vec::load (envA + i)
+                        + Vec::load (tapB + i) * Vec::load (envB + i);
+
+            if (overwrite)
+                (grains * g).store (dest + i);
+            else
+                (Vec::load (dest + i) + grains * g).store (dest + i);
+
+            g = g + gStep;
+        }
+
+        for (int i = numVectorised; i < numSamples; ++i)
+        {
+            auto gi = gain + gainStep * (SampleType) i;
+            auto grains = gi * (tapA[i] * envA[i] + tapB[i] * envB[i]);
+            dest[i] = overwrite ? grains : dest[i] + grains;
+        }
+    }
+
+    template <typename SampleType>
+    void mixTaps (SampleType* dest,
+                  const SampleType* tapA, const SampleType* envA,
+                  const SampleType* tapB, const SampleType* envB,
+                  SampleType gain, SampleType gainStep, int numSamples, bool overwrite) noexcept
+    {
+        if (overwrite)
+            mixTapsInto<true> (dest, tapA, envA, tapB, envB, gain, gainStep, numSamples);
+        else
+            mixTapsInto<false> (dest, tapA, envA, tapB, envB, gain, gainStep, numSamples);
+    }
+
+    template <bool overwrite, typename SampleType>
+    static void addScaledInto (SampleType* dest, const SampleType* src, SampleType gain, SampleType gainStep, int numSamples) noexcept
+    {
+        using Vec = SimdOps::Vec<SampleType>;
+
+        auto g = Vec::ramp (gain, gainStep);
+        const auto gStep = Vec::fill (gainStep * (SampleType) Vec::size);
+        const int numVectorised = SimdOps::vectorisedLength<SampleType> (numSamples);
+
+        for (int i = 0; i < numVectorised; i += Vec::size)
+        {
+            if (overwrite)
+                (Vec::load (src + i) * g).store (dest + i);
+            else
+                (Vec::load (dest + i) + Vec::load (src + i) * g).store (dest + i);
+
+            g = g + gStep;
+        }
+
+        for (int i = numVectorised; i < numSamples; ++i)
+        {
+            auto scaled = (gain + gainStep * (SampleType) i) * src[i];
+            dest[i] = overwrite ? scaled : dest[i] + scaled;
+        }
+    }
+
+    template <typename SampleType>
+    void addScaled (SampleType* dest, const SampleType* src, SampleType gain, SampleType gainStep, int numSamples, bool overwrite) noexcept
+    {
+        if (overwrite)
+            addScaledInto<true> (dest, src, gain, gainStep, numSamples);
+        else
+            addScaledInto<false> (dest, src, gain, gainStep, numSamples);
+    }
+
+    //==============================================================================
+    template double fillPhasor<float>  (float*, double, double, double, int) noexcept;
+    template double fillPhasor<double> (double*, double, double, double, int) noexcept;
+
+    template void offsetPhasor<float>  (float*, const float*, int) noexcept;
+    template void offsetPhasor<double> (double*, const double*, int) noexcept;
+
+    template void scale<float>  (float*, const float*, float, int) noexcept;
+    template void scale<double> (double*, const double*, double, int) noexcept;
+
+    template void glideDelay<float>  (float*, const float*, double, double, double, int) noexcept;
+    template void glideDelay<double> (double*, const double*, double, double, double, int) noexcept;
+
+    template void mixTaps<float>  (float*, const float*, const float*, const float*, const float*, float, float, int, bool) noexcept;
+    template void mixTaps<double> (double*, const double*, const double*, const double*, const double*, double, double, int, bool) noexcept;
+
+    template void addScaled<float>  (float*, const float*, float, float, int, bool) noexcept;
+    template void addScaled<double> (double*, const double*, double, double, int, bool) noexcept;
+
+    double transpoToPhasorFreq (double semitones, double windowMs) noexcept
+    {
+        auto ratio = std::pow (2.0, semitones / 12.0);
+        return (1.0 - ratio) * 1000.0 / windowMs;
+    }
+}
@@ -0,0 +1,70 @@
+/*
+  ==============================================================================
+
+    GrainKernel.h
+    Block-oriented helpers for the two-tap grain pitch shifter.
+    Grain envelopes come from the shared tables in GrainWindow.h.
+
+    Each voice is a sawtooth phasor driving two taps half a period apart.
+    Rather than stepping everything one sample at a time, processBlock builds
+    the phasor, window and delay-time vectors for the whole buffer and then
+    mixes the taps in one vectorised pass.
+
+    Everything is templated on the sample type and instantiated for float and
+    double, so each host precision runs natively at its own vector width.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+namespace GrainKernel
+{
+    /** Writes numSamples of a wrapped [0, 1) sawtooth into dest, starting at
+        phase and advancing by increment each sample. The increment itself grows
+        by incrementStep per sample so smoothed pitch changes glide. Returns the
+        next phase.
+    */
+    template <typename SampleType>
+    double fillPhasor (SampleType* dest, double phase, double increment, double incrementStep, int numSamples) noexcept;
+
+    /** dest = (phasor + 0.5) wrapped back into [0, 1). */
+    template <typename SampleType>
+    void offsetPhasor (SampleType* dest, const SampleType* phasor, int numSamples) noexcept;
+
+    /** dest = src * gain, used to turn a phasor into a delay time in samples. */
+    template <typename SampleType>
+    void scale (SampleType* dest, const SampleType* src, SampleType gain, int numSamples) noexcept;
+
+    /** The delay times for a window that is changing length: dest = phasor *
+        (windowSamps + windowStep * i) + baseDelayStep * i. Only runs during a
+        glide; otherwise the delays are just a scale() of the phasor.
+    */
+    template <typename SampleType>
+    void glideDelay (SampleType* dest, const SampleType* phasor, double windowSamps, double windowStep,
+                     double baseDelayStep, int numSamples) noexcept;
+
+    /** dest += g * (tapA * envA + tapB * envB), with g starting at gain and
+        moving by gainStep per sample. With overwrite set, dest is assigned
+        instead, which saves clearing it before the first voice.
+    */
+    template <typename SampleType>
+    void mixTaps (SampleType* dest,
+                  const SampleType* tapA, const SampleType* envA,
+                  const SampleType* tapB, const SampleType* envB,
+                  SampleType gain, SampleType gainStep, int numSamples, bool overwrite = false) noexcept;
+
+    /** dest += g * src, with g starting at gain and moving by gainStep per
+        sample, or dest = g * src with overwrite set. Used for voices whose
+        phasor is standing still, where each tap is just a delayed copy at a
+        fixed envelope level.
+    */
+    template <typename SampleType>
+    void addScaled (SampleType* dest, const SampleType* src, SampleType gain, SampleType gainStep, int numSamples, bool overwrite = false) noexcept;
+
+    /** Phasor frequency in Hz that shifts by the given number of semitones
+        when the delay sweeps across a window of windowMs milliseconds.
+        Upward shifts give negative frequencies (the delay shrinks).
+    */
+    double transpoToPhasorFreq (double semitones, double windowMs) noexcept;
+}
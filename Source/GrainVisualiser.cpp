@@ -0,0 +1,178 @@
+/*
+  ==============================================================================
+
+    GrainVisualiser.cpp
+
+  ==============================================================================
+*/
+
+#include "GrainVisualiser.h"
+
+GrainVisualiser::GrainVisualiser (VisualiserFeed& feedToShow)
+    : feed (feedToShow)
+{
+    history.assign ((size_t) fftSize, 0.0f);
+    incoming.resize ((size_t) VisualiserFeed::audioQueueSize);
+    fftData.resize ((size_t) fftSize * 2);
+
+    // everything is filled in paint, so the editor behind never needs repainting
+    setOpaque (true);
+
+    feed.addViewer();
+    startTimerHz (30);
+}
+
+GrainVisualiser::~GrainVisualiser()
+{
+    stopTimer();
+    feed.removeViewer();
+}
+
+juce::Rectangle<float> GrainVisualiser::getGrainArea() const noexcept
+{
+    auto bounds = getLocalBounds().toFloat().reduced (4.0f);
+    return bounds.removeFromLeft (bounds.getWidth() * 0.5f).reduced (4.0f, 0.0f);
+}
+
+juce::Rectangle<float> GrainVisualiser::getSpectrumArea() const noexcept
+{
+    auto bounds = getLocalBounds().toFloat().reduced (4.0f);
+    return bounds.removeFromRight (bounds.getWidth() * 0.5f).reduced (4.0f, 0.0f);
+}
+
+void GrainVisualiser::resized()
+{
+    windowPathShape = -1;
+    updateWindowPath();
+    updateSpectrumPath();
+}
+
+void GrainVisualiser::timerCallback()
+{
+    if (! isShowing())
+        return;
+
+    if (feed.pullSnapshot (snapshot))
+    {
+        updateWindowPath();
+        repaint (getGrainArea().getSmallestIntegerContainer());
+    }
+
+    int numPulled = 0;
+
+    for (int num; (num = feed.pullAudio (incoming.data(), (int) incoming.size())) > 0;)
+    {
+        for (int i = 0; i < num; ++i)
+        {
+            history[(size_t) historyPos] = incoming[(size_t) i];
+            historyPos = (historyPos + 1) & (fftSize - 1);
+        }
+
+        numPulled += num;
+    }
+
+    if (numPulled > 0)
+    {
+        updateSpectrumPath();
+        repaint (getSpectrumArea().getSmallestIntegerContainer());
+    }
+}
+
+void GrainVisualiser::updateWindowPath()
+{
+    if (snapshot.windowShape == windowPathShape)
+        return;
+
+    windowPathShape = snapshot.windowShape;
+    windowPath.clear();
+
+    const auto area = getGrainArea();
+    const float* table = GrainWindow::getTable ((GrainWindow::Shape) windowPathShape);
+    const int numPoints = juce::jmax (2, (int) area.getWidth() / 2);
+
+    for (int point = 0; point <= numPoints; ++point)
+    {
+        const double phase = juce::jmin (0.9999, (double) point / numPoints);
+        const float x = area.getX() + area.getWidth() * (float) phase;
+        const float y = area.getBottom() - area.getHeight() * GrainWindow::lookup (table, phase);
+
+        if (point == 0)
+            windowPath.startNewSubPath (x, y);
+        else
+            windowPath.lineTo (x, y);
+    }
+}
+
+void GrainVisualiser::updateSpectrumPath()
+{
+    // unroll the ring oldest first, window it and take magnitudes in place
+    for (int i = 0; i < fftSize; ++i)
+        fftData[(size_t) i] = history[(size_t) ((historyPos + i) & (fftSize - 1))];
+
+    fftWindow.multiplyWithWindowingTable (fftData.data(), (size_t) fftSize);
+    fft.performFrequencyOnlyForwardTransform (fftData.data());
+
+    spectrumPath.clear();
+
+    const auto area = getSpectrumArea();
+    const double nyquist = feed.getSampleRate() * 0.5;
+    const double minHz = 20.0;
+    const int numPoints = juce::jmax (2, (int) area.getWidth() / 2);
+
+    // log frequency across, dB up; the window halves the level, so 4/N brings a full-scale sine to 0 dB
+    for (int point = 0; point <= numPoints; ++point)
+    {
+        const double hz = minHz * std::pow (nyquist / minHz, (double) point / numPoints);
+        const int bin = juce::jlimit (0, fftSize / 2, (int) (hz / nyquist * (fftSize / 2)));
+        const float db = juce::jmax (minDb, juce::Decibels::gainToDecibels (fftData[(size_t) bin] * 4.0f / fftSize, minDb));
+
+        const float x = area.getX() + area.getWidth() * (float) point / (float) numPoints;
+        const float y = juce::jmap (db, minDb, 0.0f, area.getBottom(), area.getY());
+
+        if (point == 0)
+            spectrumPath.startNewSubPath (x, y);
+        else
+            spectrumPath.lineTo (x, y);
+    }
+}
+
+void GrainVisualiser::paint (juce::Graphics& g)
+{
+    g.fillAll (juce::Colours::black);
+
+    const auto grainArea = getGrainArea();
+    const auto spectrumArea = getSpectrumArea();
+
+    g.setColour (juce::Colours::darkgrey);
+    g.drawRect (grainArea);
+    g.drawRect (spectrumArea);
+
+    g.setColour (juce::Colours::magenta.withAlpha (0.6f));
+    g.strokePath (spectrumPath, juce::PathStrokeType (1.0f));
+
+    if (! snapshot.granular)
+        return;
+
+    g.setColour (juce::Colours::grey);
+    g.strokePath (windowPath, juce::PathStrokeType (1.0f));
+    g.drawText (juce::String (snapshot.windowMs, 1) + " ms", grainArea.reduced (4.0f), juce::Justification::topRight);
+
+    // each voice has two taps half a cycle apart, both riding the same window
+    const float* table = GrainWindow::getTable ((GrainWindow::Shape) snapshot.windowShape);
+
+    for (int voice = 0; voice < snapshot.numVoices; ++voice)
+    {
+        const auto colour = juce::Colour::fromHSV ((float) voice / (float) VoiceEngine::maxVoices, 0.7f, 1.0f,
+                                                   juce::jlimit (0.2f, 1.0f, snapshot.gain[voice]));
+        g.setColour (colour);
+
+        for (float phase : { snapshot.phase[voice], std::fmod (snapshot.phase[voice] + 0.5f, 1.0f) })
+        {
+            const float x = grainArea.getX() + grainArea.getWidth() * phase;
+            const float y = grainArea.getBottom() - grainArea.getHeight() * GrainWindow::lookup (table, phase);
+
+            g.drawVerticalLine ((int) x, y, grainArea.getBottom());
+            g.fillEllipse (x - 3.0f, y - 3.0f, 6.0f, 6.0f);
+        }
+    }
+}
@@ -0,0 +1,61 @@
+/*
+  ==============================================================================
+
+    GrainVisualiser.h
+    The editor's view of the grain voices and the output spectrum.
+
+    The left half draws the grain window with each voice's two taps riding
+    on it; the right half the spectrum of the first output channel. Data
+    comes from the processor's VisualiserFeed on a 30 Hz timer. The window
+    outline is a cached path rebuilt only when the shape or size changes,
+    the spectrum path only when new audio arrived, and each half repaints
+    only its own area when its data actually moved.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "VisualiserFeed.h"
+
+class GrainVisualiser  : public juce::Component,
+                         private juce::Timer
+{
+public:
+    explicit GrainVisualiser (VisualiserFeed& feedToShow);
+    ~GrainVisualiser() override;
+
+    void paint (juce::Graphics& g) override;
+    void resized() override;
+
+private:
+    static constexpr int fftOrder = 11;
+    static constexpr int fftSize = 1 << fftOrder;
+    static constexpr float minDb = -100.0f;
+
+    void timerCallback() override;
+    void updateWindowPath();
+    void updateSpectrumPath();
+
+    juce::Rectangle<float> getGrainArea() const noexcept;
+    juce::Rectangle<float> getSpectrumArea() const noexcept;
+
+    VisualiserFeed& feed;
+    VisualiserFeed::Snapshot snapshot;
+
+    juce::dsp::FFT fft { fftOrder };
+    juce::dsp::WindowingFunction<float> fftWindow { (size_t) fftSize, juce::dsp::WindowingFunction<float>::hann };
+
+    // the latest fftSize output samples, as a ring
+    std::vector<float> history;
+    int historyPos = 0;
+    std::vector<float> incoming;
+    std::vector<float> fftData;
+
+    juce::Path windowPath;
+    int windowPathShape = -1;
+    juce::Path spectrumPath;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (GrainVisualiser)
+};
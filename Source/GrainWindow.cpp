@@ -0,0 +1,120 @@
+/*
+  ==============================================================================
+
+    GrainWindow.cpp
+
+  ==============================================================================
+*/
+
+#include "GrainWindow.h"
+
+#include <array>
+#include <cmath>
+
+namespace GrainWindow
+{
+    namespace
+    {
+        constexpr double pi = 3.14159265358979323846;
+
+        // fraction of the grain spent fading in (and again fading out)
+        constexpr double tukeyTaper = 0.25;
+        constexpr double trapezoidRamp = 0.25;
+
+        double evaluate (Shape shape, double p)
+        {
+            switch (shape)
+            {
+                case hann:
+                    return 0.5 - 0.5 * std::cos (2.0 * pi * p);
+
+                case tukey:
+                {
+                    auto edge = p < 0.5 ? p : 1.0 - p;
+
+                    if (edge >= tukeyTaper)
+                        return 1.0;
+
+                    return 0.5 - 0.5 * std::cos (pi * edge / tukeyTaper);
+                }
+
+                case trapezoid:
+                {
+                    auto edge = p < 0.5 ? p : 1.0 - p;
+                    return edge >= trapezoidRamp ? 1.0 : edge / trapezoidRamp;
+                }
+
+                case sine:
+                case numShapes:
+                default:
+                    return std::sin (pi * p);
+            }
+        }
+
+        struct Tables
+        {
+            Tables()
+            {
+                for (int s = 0; s < numShapes; ++s)
+                    for (int i = 0; i <= tableSize; ++i)
+                        data[(size_t) s][(size_t) i] = (float) evaluate ((Shape) s, (double) i / tableSize);
+            }
+
+            std::array<std::array<float, tableSize + 1>, numShapes> data;
+        };
+
+        const Tables& getTables()
+        {
+            static const Tables tables;
+            return tables;
+        }
+    }
+
+    const float* getTable (Shape shape)
+    {
+        if (shape < 0 || shape >= numShapes)
+            shape = sine;
+
+        return getTables().data[(size_t) shape].data();
+    }
+
+    template <typename SampleType>
+    void fill (SampleType* dest, const SampleType* phasor, int numSamples, const float* table) noexcept
+    {
+        for (int i = 0; i < numSamples; ++i)
+        {
+            auto pos = phasor[i] * (SampleType) tableSize;
+            auto index = (int) pos;
+
+            // float rounding can land a phase of 0.99999 exactly on tableSize
+            if (index >= tableSize)
+                index = tableSize - 1;
+
+            auto frac = pos - (SampleType) index;
+            dest[i] = (SampleType) table[index] + frac * (SampleType) (table[index + 1] - table[index]);
+        }
+    }
+
+    template void fill<float>  (float*, const float*, int, const float*) noexcept;
+    template void fill<double> (double*, const double*, int, const float*) noexcept;
+
+    float lookup (const float* table, double phase) noexcept
+    {
+        double value;
+        fill (&value, &phase, 1, table);
+        return (float) value;
+    }
+
+    const char* getName (Shape shape) noexcept
+    {
+        switch (shape)
+        {
+            case sine:      return "Sine";
+            case hann:      return "Hann";
+            case tukey:     return "Tukey";
+            case trapezoid: return "Trapezoid";
+            case numShapes:
+            default:        return "";
+        }
+    }
+}
@@ -0,0 +1,47 @@
+/*
+  ==============================================================================
+
+    GrainWindow.h
+    Precomputed grain envelope tables.
+
+    Every shape is sampled once into a small table the first time it is asked
+    for, and shared read-only by all plugin instances in the process. The
+    kernel then looks envelopes up with linear interpolation instead of
+    calling std::sin per tap per sample.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+namespace GrainWindow
+{
+    enum Shape
+    {
+        sine = 0,
+        hann,
+        tukey,
+        trapezoid,
+        numShapes
+    };
+
+    /** Number of table segments; each table stores tableSize + 1 points so the
+        interpolating lookup never needs to wrap.
+    */
+    constexpr int tableSize = 1024;
+
+    /** Returns the shared table for a shape, building all tables on first use.
+        Call it from prepareToPlay so the build never lands on the audio thread.
+    */
+    const float* getTable (Shape shape);
+
+    /** dest = window (phasor) for phasor values in [0, 1). Instantiated for float and double. */
+    template <typename SampleType>
+    void fill (SampleType* dest, const SampleType* phasor, int numSamples, const float* table) noexcept;
+
+    /** window (phase) for a single phase in [0, 1). */
+    float lookup (const float* table, double phase) noexcept;
+
+    /** Display names, in Shape order. */
+    const char* getName (Shape shape) noexcept;
+}
@@ -0,0 +1,349 @@
+/*
+  ==============================================================================
+
+    PhaseVocoder.cpp
+
+  ==============================================================================
+*/
+
+#include "PhaseVocoder.h"
+#include "SharedResources.h"
+#include "SimdOps.h"
+
+namespace
+{
+    constexpr float twoPi = juce::MathConstants<float>::twoPi;
+
+    inline float wrapPhase (float phase) noexcept
+    {
+        return phase - twoPi * std::floor ((phase + juce::MathConstants<float>::pi) / twoPi);
+    }
+}
+
+//==============================================================================
+PhaseVocoder::FrameTables::FrameTables (int order)
+    : fft (order)
+{
+    const int size = 1 << order;
+
+    window.resize ((size_t) size);
+
+    for (int n = 0; n < size; ++n)
+        window[(size_t) n] = 0.5f - 0.5f * std::cos (twoPi * (float) n / (float) size);
+}
+
+std::shared_ptr<const PhaseVocoder::FrameTables> PhaseVocoder::getFrameTables (int order)
+{
+    return SharedResources::get<FrameTables> (0.0, 1 << order, [order] { return std::make_unique<FrameTables> (order); });
+}
+
+void PhaseVocoder::prepare (int numChannels, double)
+{
+    for (int o = minOrder; o <= maxOrder; ++o)
+        frameTables[o - minOrder] = getFrameTables (o);
+
+    const size_t maxSize = (size_t) 1 << maxOrder;
+    const size_t maxBins = maxSize / 2 + 1;
+    const size_t phasesPerSetup = maxBins + maxBins * VoiceEngine::maxVoices;
+    const size_t perChannel = maxSize * 2 + phasesPerSetup * 2;
+    const size_t shared = maxSize * 2 + maxBins * 6 + maxSize * 2;
+
+    arena.allocate (shared + perChannel * (size_t) numChannels, true);
+    peakArena.allocate (maxBins * 3, true);
+
+    auto* p = arena.get();
+    frame = p;          p += maxSize * 2;
+    magnitude = p;      p += maxBins;
+    analysisPhase = p;  p += maxBins;
+    instFreq = p;       p += maxBins;
+    binReal = p;        p += maxBins;
+    binImag = p;        p += maxBins;
+    binPhase = p;       p += maxBins;
+    spectrum = p;       p += maxSize * 2;
+
+    peaks = peakArena.get();
+    peakOfBin = peaks + maxBins;
+    destOfBin = peakOfBin + maxBins;
+
+    channels.resize ((size_t) numChannels);
+
+    for (auto& state : channels)
+    {
+        state.inFifo = p;                   p += maxSize;
+        state.outAccum = p;                 p += maxSize;
+
+        for (auto* phases : { &state.current, &state.fading })
+        {
+            phases->lastPhase = p;          p += maxBins;
+            phases->synthPhase = p;         p += maxBins * VoiceEngine::maxVoices;
+        }
+    }
+
+    order = pendingOrder;
+    overlap = pendingOverlap;
+    current = makeSetup (order, overlap);
+    reset();
+}
+
+void PhaseVocoder::setFrameSize (int newOrder, int newOverlap) noexcept
+{
+    pendingOrder = juce::jlimit (minOrder, maxOrder, newOrder);
+    pendingOverlap = juce::jlimit (2, 16, newOverlap);
+}
+
+PhaseVocoder::FrameSetup PhaseVocoder::makeSetup (int newOrder, int newOverlap) const noexcept
+{
+    FrameSetup setup;
+    setup.fftSize = 1 << newOrder;
+    setup.hopSize = setup.fftSize / newOverlap;
+    setup.numBins = setup.fftSize / 2 + 1;
+
+    // the same window is used for both analysis and synthesis
+    setup.fft = &frameTables[newOrder - minOrder]->fft;
+    setup.window = frameTables[newOrder - minOrder]->window.data();
+
+    // Hann squared sums to 3/8 of the overlap factor; the inverse FFT is already scaled by 1/N
+    setup.outputGain = 1.0f / (0.375f * (float) newOverlap);
+    return setup;
+}
+
+void PhaseVocoder::configure() noexcept
+{
+    order = pendingOrder;
+    overlap = pendingOverlap;
+
+    // The old setup carries on where it was, fading out, and the new one
+    // starts from fresh phases, fading in. Both overlap-add into the same
+    // output ring, so only their frame gains need to change. Only called
+    // between crossfades, so the outgoing setup always starts at full gain.
+    fading = current;
+    current = makeSetup (order, overlap);
+    fadeLength = juce::jmax (fading.fftSize, current.fftSize);
+
+    for (auto& state : channels)
+    {
+        std::swap (state.current, state.fading);
+        juce::FloatVectorOperations::clear (state.current.lastPhase, current.numBins);
+        juce::FloatVectorOperations::clear (state.current.synthPhase, current.numBins * VoiceEngine::maxVoices);
+        state.current.hopCounter = 0;
+        state.fadeLeft = fadeLength;
+    }
+}
+
+void PhaseVocoder::reset() noexcept
+{
+    const size_t maxSize = (size_t) 1 << maxOrder;
+    const size_t maxBins = maxSize / 2 + 1;
+
+    for (auto& state : channels)
+    {
+        juce::FloatVectorOperations::clear (state.inFifo, (int) maxSize);
+        juce::FloatVectorOperations::clear (state.outAccum, (int) maxSize);
+
+        for (auto* phases : { &state.current, &state.fading })
+        {
+            juce::FloatVectorOperations::clear (phases->lastPhase, (int) maxBins);
+            juce::FloatVectorOperations::clear (phases->synthPhase, (int) (maxBins * VoiceEngine::maxVoices));
+            phases->hopCounter = 0;
+        }
+
+        state.pos = 0;
+        state.fadeLeft = 0;
+    }
+
+    blockFadeLeft = 0;
+}
+
+void PhaseVocoder::setVoices (int newNumVoices, const float* transpo, const float* gains) noexcept
+{
+    numVoices = juce::jlimit (0, VoiceEngine::maxVoices, newNumVoices);
+
+    for (int v = 0; v < numVoices; ++v)
+    {
+        ratios[v] = std::pow (2.0f, transpo[v] / 12.0f);
+        voiceGains[v] = gains[v];
+    }
+}
+
+//==============================================================================
+template <typename SampleType>
+void PhaseVocoder::process (int channel, SampleType* data, int numSamples) noexcept
+{
+    if (channel == 0)
+    {
+        // a change mid-crossfade waits for it to finish; switching at once would
+        // restart the half-faded-in setup's fade-out from full gain
+        if ((pendingOrder != order || pendingOverlap != overlap) && channels[0].fadeLeft == 0)
+            configure();
+
+        blockFadeLeft = channels[0].fadeLeft;
+    }
+
+    auto& state = channels[(size_t) channel];
+    const int mask = (1 << maxOrder) - 1;
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        state.inFifo[state.pos] = (float) data[i];
+        data[i] = (SampleType) state.outAccum[state.pos];
+        state.outAccum[state.pos] = 0.0f;
+        state.pos = (state.pos + 1) & mask;
+
+        if (++state.current.hopCounter == current.hopSize)
+        {
+            state.current.hopCounter = 0;
+            processFrame (state, current, state.current, getFadeGainAt (state.fadeLeft, false));
+        }
+
+        if (state.fadeLeft > 0)
+        {
+            --state.fadeLeft;
+
+            if (++state.fading.hopCounter >= fading.hopSize)
+            {
+                state.fading.hopCounter = 0;
+                processFrame (state, fading, state.fading, getFadeGainAt (state.fadeLeft, true));
+            }
+        }
+    }
+}
+
+template void PhaseVocoder::process<float> (int, float*, int) noexcept;
+template void PhaseVocoder::process<double> (int, double*, int) noexcept;
+
+float PhaseVocoder::getFadeGainAt (int fadeLeft, bool fadingOut) const noexcept
+{
+    if (fadeLeft <= 0)
+        return fadingOut ? 0.0f : 1.0f;
+
+    // equal power, since the two setups differ in latency and phase and so don't add up coherently
+    const float angle = juce::MathConstants<float>::halfPi * (float) fadeLeft / (float) fadeLength;
+    return fadingOut ? std::sin (angle) : std::cos (angle);
+}
+
+void PhaseVocoder::processFrame (ChannelState& state, const FrameSetup& setup, PhaseState& phases, float gain) noexcept
+{
+    const int fftSize = setup.fftSize;
+    const int mask = (1 << maxOrder) - 1;
+    const int start = state.pos - fftSize + mask + 1;
+
+    // the latest fftSize samples, oldest first: pos is the next slot to be written
+    for (int n = 0; n < fftSize; ++n)
+        frame[n] = state.inFifo[(start + n) & mask] * setup.window[n];
+
+    setup.fft->forward (frame);
+
+    analyse (setup, phases);
+    findPeaks (setup);
+
+    juce::FloatVectorOperations::clear (spectrum, fftSize * 2);
+
+    for (int v = 0; v < numVoices; ++v)
+        synthesiseVoice (setup, phases, v);
+
+    juce::FloatVectorOperations::copy (frame, spectrum, fftSize * 2);
+    setup.fft->inverse (frame);
+
+    juce::FloatVectorOperations::multiply (frame, setup.window, fftSize);
+
+    const float frameGain = setup.outputGain * gain;
+
+    for (int n = 0; n < fftSize; ++n)
+        state.outAccum[(state.pos + n) & mask] += frame[n] * frameGain;
+}
+
+void PhaseVocoder::analyse (const FrameSetup& setup, PhaseState& phases) noexcept
+{
+    const int numBins = setup.numBins;
+    const float expectedPerBin = twoPi * (float) setup.hopSize / (float) setup.fftSize;
+
+    for (int k = 0; k < numBins; ++k)
+    {
+        binReal[k] = frame[2 * k];
+        binImag[k] = frame[2 * k + 1];
+    }
+
+    SimdOps::cartesianToPolar (binReal, binImag, magnitude, analysisPhase, numBins);
+
+    for (int k = 0; k < numBins; ++k)
+    {
+        const float phase = analysisPhase[k];
+        const float expected = expectedPerBin * (float) k;
+        const float deviation = wrapPhase (phase - phases.lastPhase[k] - expected);
+
+        phases.lastPhase[k] = phase;
+        instFreq[k] = expected + deviation;     // radians per hop
+    }
+}
+
+void PhaseVocoder::findPeaks (const FrameSetup& setup) noexcept
+{
+    const int numBins = setup.numBins;
+    numPeaks = 0;
+
+    for (int k = 1; k < numBins - 1; ++k)
+        if (magnitude[k] > magnitude[k - 1] && magnitude[k] >= magnitude[k + 1])
+            peaks[numPeaks++] = k;
+
+    if (numPeaks == 0)
+        peaks[numPeaks++] = 0;
+
+    // each bin belongs to its nearest peak
+    int current = 0;
+
+    for (int k = 0; k < numBins; ++k)
+    {
+        while (current + 1 < numPeaks && std::abs (peaks[current + 1] - k) < std::abs (peaks[current] - k))
+            ++current;
+
+        peakOfBin[k] = peaks[current];
+    }
+}
+
+void PhaseVocoder::synthesiseVoice (const FrameSetup& setup, PhaseState& phases, int voice) noexcept
+{
+    const int numBins = setup.numBins;
+    const float ratio = ratios[voice];
+    const float gain = voiceGains[voice];
+    auto* synth = phases.synthPhase + (size_t) voice * (size_t) numBins;
+
+    // first where each bin lands and at what phase, region by region, since a
+    // peak carries on from whatever phase the bin it lands on was left at
+    int k = 0;
+
+    while (k < numBins)
+    {
+        const int peak = peakOfBin[k];
+        const int target = juce::roundToInt ((float) peak * ratio);
+
+        // the peak's phase advances at its shifted instantaneous frequency
+        const float peakPhase = wrapPhase (synth[juce::jlimit (0, numBins - 1, target)] + instFreq[peak] * ratio);
+
+        // every bin in this region moves with the peak and keeps its phase offset to it
+        for (; k < numBins && peakOfBin[k] == peak; ++k)
+        {
+            const int dest = target + (k - peak);
+            const float phase = peakPhase + (analysisPhase[k] - analysisPhase[peak]);
+
+            binPhase[k] = phase;
+            destOfBin[k] = dest > 0 && dest < numBins - 1 ? dest : -1;
+
+            if (destOfBin[k] >= 0)
+                synth[dest] = wrapPhase (phase);
+        }
+    }
+
+    // then every bin's sine and cosine in one vectorised pass
+    SimdOps::polarToCartesian (magnitude, binPhase, binReal, binImag, numBins);
+
+    for (k = 0; k < numBins; ++k)
+    {
+        const int dest = destOfBin[k];
+
+        if (dest >= 0)
+        {
+            spectrum[2 * dest]     += binReal[k] * gain;
+            spectrum[2 * dest + 1] += binImag[k] * gain;
+        }
+    }
+}
@@ -0,0 +1,154 @@
+/*
+  ==============================================================================
+
+    PhaseVocoder.h
+    Frequency-domain pitch shifter, the alternative to the grain engine.
+
+    Each channel is analysed with a Hann-windowed RealFft every hop
+    samples. Spectral peaks are shifted by each voice's ratio, and the bins
+    around a peak move rigidly with it, keeping their phase offset to the
+    peak (identity phase locking). All voices are summed in the spectrum,
+    so there is one inverse FFT per frame however many voices are playing.
+
+    Every buffer lives in one arena sized for the largest frame, allocated in
+    prepare(), so frame size and overlap can change without allocating, and
+    the change crossfades rather than clearing. The FFT plans and windows are
+    read-only, one per frame size, and shared by every instance in the
+    process; each instance transforms in its own frame buffer, so they never
+    wait on one another.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "RealFft.h"
+#include "VoiceEngine.h"
+
+class PhaseVocoder
+{
+public:
+    static constexpr int minOrder = 9;      // 512 samples
+    static constexpr int maxOrder = 12;     // 4096 samples
+
+    /** The FFT plan and analysis window for one frame size. */
+    struct FrameTables
+    {
+        explicit FrameTables (int order);
+
+        RealFft fft;
+        std::vector<float> window;      // periodic Hann
+    };
+
+    /** Returns the process-wide tables for a 2^order frame, building them on first use. */
+    static std::shared_ptr<const FrameTables> getFrameTables (int order);
+
+    /** Allocates the arena and picks up the shared FFT plans. Not real-time safe. */
+    void prepare (int numChannels, double sampleRate);
+
+    /** Clears all channel history. */
+    void reset() noexcept;
+
+    /** Picks the frame size (2^order samples) and the number of frames that
+        overlap each sample. Takes effect on the next process(), or once a
+        crossfade already running has finished: the old setup keeps running
+        and crossfades into the new one over the longer frame.
+    */
+    void setFrameSize (int order, int overlap) noexcept;
+
+    /** Delay from input to output in samples at the frame size being rendered,
+        which lags a new setting until it takes effect.
+    */
+    int getLatencySamples() const noexcept              { return current.fftSize > 0 ? current.fftSize : 1 << juce::jlimit (minOrder, maxOrder, pendingOrder); }
+
+    /** True while the last block processed was crossfading between frame setups. */
+    bool isCrossfading() const noexcept                 { return blockFadeLeft > 0; }
+
+    /** The latency of the setup being faded out, while isCrossfading(). */
+    int getFadingLatencySamples() const noexcept        { return fading.fftSize; }
+
+    /** The crossfade gain of the outgoing or the incoming setup at a sample of
+        the last block processed, so the dry signal can follow the same fade.
+    */
+    float getFadeGain (int sample, bool fadingOut) const noexcept     { return getFadeGainAt (blockFadeLeft - sample, fadingOut); }
+
+    /** Sets the voices to render: transpositions in semitones, linear gains. */
+    void setVoices (int numVoices, const float* transpo, const float* gains) noexcept;
+
+    /** Shifts numSamples of one channel in place. The FFT works in single
+        precision, so double input is converted at the frame buffers.
+    */
+    template <typename SampleType>
+    void process (int channel, SampleType* data, int numSamples) noexcept;
+
+private:
+    /** One frame size and overlap, with its plan and window. */
+    struct FrameSetup
+    {
+        int fftSize = 0, hopSize = 0, numBins = 0;
+        const RealFft* fft = nullptr;
+        const float* window = nullptr;
+        float outputGain = 1.0f;
+    };
+
+    /** The phase history one setup carries from frame to frame. */
+    struct PhaseState
+    {
+        float* lastPhase = nullptr;
+        float* synthPhase = nullptr;    // maxVoices rows of numBins, one per voice
+        int hopCounter = 0;
+    };
+
+    struct ChannelState
+    {
+        float* inFifo = nullptr;        // both rings are the largest frame long,
+        float* outAccum = nullptr;      // so every setup can share them
+        PhaseState current, fading;
+        int pos = 0;
+        int fadeLeft = 0;               // samples until the fading setup stops
+    };
+
+    FrameSetup makeSetup (int order, int overlap) const noexcept;
+    void configure() noexcept;
+    float getFadeGainAt (int fadeLeft, bool fadingOut) const noexcept;
+    void processFrame (ChannelState& state, const FrameSetup& setup, PhaseState& phases, float gain) noexcept;
+    void analyse (const FrameSetup& setup, PhaseState& phases) noexcept;
+    void findPeaks (const FrameSetup& setup) noexcept;
+    void synthesiseVoice (const FrameSetup& setup, PhaseState& phases, int voice) noexcept;
+
+    std::shared_ptr<const FrameTables> frameTables[maxOrder - minOrder + 1];
+
+    juce::HeapBlock<float> arena;
+    juce::HeapBlock<int> peakArena;
+    std::vector<ChannelState> channels;
+
+    // after a change the old setup renders alongside the new one for fadeLength samples,
+    // each frame weighted by how far through the crossfade it starts
+    FrameSetup current, fading;
+    int fadeLength = 0;
+    int blockFadeLeft = 0;
+
+    // shared per-frame scratch, carved out of the arena
+    float* frame = nullptr;
+    float* magnitude = nullptr;
+    float* analysisPhase = nullptr;
+    float* instFreq = nullptr;
+    float* binReal = nullptr;
+    float* binImag = nullptr;
+    float* binPhase = nullptr;
+    float* spectrum = nullptr;
+    int* peaks = nullptr;
+    int* peakOfBin = nullptr;
+    int* destOfBin = nullptr;      // -1 where the shifted bin falls off the spectrum
+    int numPeaks = 0;
+
+    int order = 11, pendingOrder = 11;
+    int overlap = 4, pendingOverlap = 4;
+
+    int numVoices = 0;
+    float ratios[VoiceEngine::maxVoices] = {};
+    float voiceGains[VoiceEngine::maxVoices] = {};
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PhaseVocoder)
+};
@@ -0,0 +1,188 @@
+/*
+  ==============================================================================
+
+    PitchShifterApi.cpp
+
+  ==============================================================================
+*/
+
+#include "PitchShifterApi.h"
+#include "ShifterCore.h"
+
+#include <cmath>
+#include <new>
+#include <vector>
+
+struct pitchshifter
+{
+    ShifterCore core;
+    int numChannels = 0;
+    int maxBlockSize = 0;
+
+    // channel pointers offset into the caller's buffers, and planar rows for interleaved audio
+    std::vector<const float*> inputs;
+    std::vector<float*> outputs;
+    std::vector<float> planar;
+};
+
+namespace
+{
+    // the same mapping the plugin's parameters use: anything at or below the floor is silence
+    float decibelsToGain (float db, float floorDb) noexcept
+    {
+        return db > floorDb ? std::pow (10.0f, db * 0.05f) : 0.0f;
+    }
+
+    constexpr float voiceGainFloorDb = -60.0f;
+    constexpr float outputGainFloorDb = -100.0f;
+    constexpr float minWindowMs = 5.0f;
+    constexpr float maxWindowMs = 300.0f;
+}
+
+pitchshifter* pitchshifter_create (void)
+{
+    return new (std::nothrow) pitchshifter();
+}
+
+void pitchshifter_destroy (pitchshifter* shifter)
+{
+    delete shifter;
+}
+
+int pitchshifter_prepare (pitchshifter* shifter, double sample_rate, int num_channels, int max_block_size)
+{
+    if (shifter == nullptr || sample_rate <= 0.0 || num_channels <= 0 || max_block_size <= 0)
+        return -1;
+
+    try
+    {
+        shifter->core.prepare (num_channels, max_block_size, sample_rate, 1, false, maxWindowMs);
+        shifter->inputs.assign ((size_t) num_channels, nullptr);
+        shifter->outputs.assign ((size_t) num_channels, nullptr);
+        shifter->planar.assign ((size_t) num_channels * (size_t) max_block_size, 0.0f);
+    }
+    catch (const std::bad_alloc&)
+    {
+        shifter->numChannels = 0;
+        shifter->maxBlockSize = 0;
+        return -1;
+    }
+
+    shifter->numChannels = num_channels;
+    shifter->maxBlockSize = max_block_size;
+    return 0;
+}
+
+void pitchshifter_reset (pitchshifter* shifter)
+{
+    if (shifter == nullptr)
+        return;
+
+    shifter->core.clearHistory();
+    shifter->core.reset();
+}
+
+void pitchshifter_process_planar (pitchshifter* shifter, const float* const* input, float* const* output, int num_frames)
+{
+    if (shifter == nullptr || shifter->numChannels == 0)
+        return;
+
+    for (int start = 0; start < num_frames; start += shifter->maxBlockSize)
+    {
+        const int num = num_frames - start < shifter->maxBlockSize ? num_frames - start : shifter->maxBlockSize;
+
+        for (int channel = 0; channel < shifter->numChannels; ++channel)
+        {
+            shifter->inputs[(size_t) channel] = input[channel] + start;
+            shifter->outputs[(size_t) channel] = output[channel] + start;
+        }
+
+        shifter->core.process (shifter->inputs.data(), shifter->outputs.data(), num);
+    }
+}
+
+void pitchshifter_process_interleaved (pitchshifter* shifter, const float* input, float* output, int num_frames)
+{
+    if (shifter == nullptr || shifter->numChannels == 0)
+        return;
+
+    const int numChannels = shifter->numChannels;
+
+    for (int channel = 0; channel < numChannels; ++channel)
+        shifter->outputs[(size_t) channel] = shifter->planar.data() + (size_t) channel * (size_t) shifter->maxBlockSize;
+
+    // each chunk is split into the planar rows and rendered there in place, so input
+    // is fully read before output is written and the two may be the same buffer
+    for (int start = 0; start < num_frames; start += shifter->maxBlockSize)
+    {
+        const int num = num_frames - start < shifter->maxBlockSize ? num_frames - start : shifter->maxBlockSize;
+        const float* in = input + (size_t) start * (size_t) numChannels;
+        float* out = output + (size_t) start * (size_t) numChannels;
+
+        for (int i = 0; i < num; ++i)
+            for (int channel = 0; channel < numChannels; ++channel)
+                shifter->outputs[(size_t) channel][i] = in[i * numChannels + channel];
+
+        shifter->core.process (shifter->outputs.data(), shifter->outputs.data(), num);
+
+        for (int i = 0; i < num; ++i)
+            for (int channel = 0; channel < numChannels; ++channel)
+                out[i * numChannels + channel] = shifter->outputs[(size_t) channel][i];
+    }
+}
+
+int pitchshifter_get_latency (const pitchshifter* shifter)
+{
+    return shifter != nullptr ? (int) std::lround (shifter->core.getLatencySamples()) : 0;
+}
+
+void pitchshifter_set_window_size (pitchshifter* shifter, float window_ms)
+{
+    if (shifter != nullptr)
+        shifter->core.setWindowSize (window_ms < minWindowMs ? minWindowMs : (window_ms > maxWindowMs ? maxWindowMs : window_ms));
+}
+
+void pitchshifter_set_window_shape (pitchshifter* shifter, int shape)
+{
+    if (shifter != nullptr && shape >= 0 && shape < GrainWindow::numShapes)
+        shifter->core.setWindowShape ((GrainWindow::Shape) shape);
+}
+
+void pitchshifter_set_num_voices (pitchshifter* shifter, int num_voices)
+{
+    if (shifter != nullptr)
+        shifter->core.setNumVoices (num_voices);
+}
+
+void pitchshifter_set_voice (pitchshifter* shifter, int voice, float semitones, float gain_db)
+{
+    if (shifter == nullptr || voice < 0 || voice >= VoiceEngine::maxVoices)
+        return;
+
+    shifter->core.setTranspo (voice, semitones);
+    shifter->core.setGain (voice, decibelsToGain (gain_db, voiceGainFloorDb));
+}
+
+void pitchshifter_set_mix (pitchshifter* shifter, float mix_percent)
+{
+    if (shifter != nullptr)
+        shifter->core.setMix (mix_percent / 100.0f);
+}
+
+void pitchshifter_set_output_gain (pitchshifter* shifter, float gain_db)
+{
+    if (shifter != nullptr)
+        shifter->core.setOutputGain (decibelsToGain (gain_db, outputGainFloorDb));
+}
+
+void pitchshifter_set_low_latency (pitchshifter* shifter, int low_latency)
+{
+    if (shifter != nullptr)
+        shifter->core.setLowLatency (low_latency != 0);
+}
+
+void pitchshifter_set_interpolation (pitchshifter* shifter, int interpolation)
+{
+    if (shifter != nullptr && interpolation >= 0 && interpolation < Interpolation::numTypes)
+        shifter->core.setInterpolation ((Interpolation::Type) interpolation);
+}
@@ -0,0 +1,121 @@
+/*
+  ==============================================================================
+
+    PitchShifterApi.h
+    Plain C interface to the grain pitch shifter, for embedding it without a
+    plugin host.
+
+    A shifter is created, prepared for a channel count, sample rate and
+    largest block, then fed blocks of float audio, planar or interleaved.
+    Everything is allocated by pitchshifter_prepare(); processing, resetting
+    and the setters never allocate, lock or wait, so they can run on a
+    real-time thread. Blocks longer than the prepared size are split up
+    internally. A shifter may be used from one thread at a time.
+
+    Parameter changes are picked up by the next block and smoothed from there.
+
+  ==============================================================================
+*/
+
+#ifndef PITCHSHIFTER_API_H
+#define PITCHSHIFTER_API_H
+
+#if defined (_WIN32) && defined (PITCHSHIFTER_SHARED)
+  #ifdef PITCHSHIFTER_BUILDING
+    #define PITCHSHIFTER_API __declspec (dllexport)
+  #else
+    #define PITCHSHIFTER_API __declspec (dllimport)
+  #endif
+#elif defined (PITCHSHIFTER_SHARED)
+  #define PITCHSHIFTER_API __attribute__ ((visibility ("default")))
+#else
+  #define PITCHSHIFTER_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct pitchshifter pitchshifter;
+
+/** Voices, numbered from 0. */
+#define PITCHSHIFTER_MAX_VOICES 16
+
+/** Window shapes, as in GrainWindow::Shape. */
+enum
+{
+    PITCHSHIFTER_WINDOW_SINE = 0,
+    PITCHSHIFTER_WINDOW_HANN,
+    PITCHSHIFTER_WINDOW_TUKEY,
+    PITCHSHIFTER_WINDOW_TRAPEZOID
+};
+
+/** Tap interpolators, as in Interpolation::Type. */
+enum
+{
+    PITCHSHIFTER_INTERP_LINEAR = 0,
+    PITCHSHIFTER_INTERP_HERMITE,
+    PITCHSHIFTER_INTERP_LAGRANGE,
+    PITCHSHIFTER_INTERP_SINC
+};
+
+/** Returns a new shifter, or NULL if out of memory. It starts with the plugin's
+    defaults: two voices at 0 semitones and 0 dB, a 50 ms sine window, linear
+    interpolation and a fully wet mix. Nothing is processed until it's prepared.
+*/
+PITCHSHIFTER_API pitchshifter* pitchshifter_create (void);
+
+/** Frees a shifter. NULL is ignored. */
+PITCHSHIFTER_API void pitchshifter_destroy (pitchshifter* shifter);
+
+/** Allocates for the given layout and resets. Returns 0 on success, -1 for bad
+    arguments or when out of memory. Not real-time safe.
+*/
+PITCHSHIFTER_API int pitchshifter_prepare (pitchshifter* shifter, double sample_rate, int num_channels, int max_block_size);
+
+/** Silences the history, restarts the grains and lands every parameter on its value. */
+PITCHSHIFTER_API void pitchshifter_reset (pitchshifter* shifter);
+
+/** Renders num_frames of every channel. input and output are arrays of
+    num_channels channel pointers; output may point at the input channels.
+    Does nothing until the shifter has been prepared.
+*/
+PITCHSHIFTER_API void pitchshifter_process_planar (pitchshifter* shifter, const float* const* input,
+                                                   float* const* output, int num_frames);
+
+/** Renders num_frames of interleaved audio. output may be the same buffer as input. */
+PITCHSHIFTER_API void pitchshifter_process_interleaved (pitchshifter* shifter, const float* input,
+                                                        float* output, int num_frames);
+
+/** Delay the host should compensate for, in samples, for the current settings. */
+PITCHSHIFTER_API int pitchshifter_get_latency (const pitchshifter* shifter);
+
+/** Grain window length, 5 to 300 ms. */
+PITCHSHIFTER_API void pitchshifter_set_window_size (pitchshifter* shifter, float window_ms);
+
+/** One of the PITCHSHIFTER_WINDOW_ values. */
+PITCHSHIFTER_API void pitchshifter_set_window_shape (pitchshifter* shifter, int shape);
+
+/** Voices sounding, 1 to PITCHSHIFTER_MAX_VOICES. */
+PITCHSHIFTER_API void pitchshifter_set_num_voices (pitchshifter* shifter, int num_voices);
+
+/** A voice's transposition in semitones and its level in dB; -60 dB and below is silent. */
+PITCHSHIFTER_API void pitchshifter_set_voice (pitchshifter* shifter, int voice, float semitones, float gain_db);
+
+/** Wet proportion in percent, 0 to 100. */
+PITCHSHIFTER_API void pitchshifter_set_mix (pitchshifter* shifter, float mix_percent);
+
+/** Gain on the whole output, in dB. */
+PITCHSHIFTER_API void pitchshifter_set_output_gain (pitchshifter* shifter, float gain_db);
+
+/** Non-zero caps the window at 12 ms and reads straight back from the newest input. */
+PITCHSHIFTER_API void pitchshifter_set_low_latency (pitchshifter* shifter, int low_latency);
+
+/** One of the PITCHSHIFTER_INTERP_ values. */
+PITCHSHIFTER_API void pitchshifter_set_interpolation (pitchshifter* shifter, int interpolation);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -1,145 +1,346 @@
-/*
-  ==============================================================================
-
-    This file contains the basic framework code for a JUCE plugin editor.
-
-  ==============================================================================
-*/
-
-#include "PluginProcessor.h"
-#include "PluginEditor.h"
-
-//==============================================================================
-PitchShifterAudioProcessorEditor::PitchShifterAudioProcessorEditor (PitchShifterAudioProcessor& p)
-    : AudioProcessorEditor (&p), audioProcessor (p)
-{
-    // Make sure that before the constructor has finished, you've set the
-    // editor's size to whatever you need it to be.
-    setSize (700, 500);
-    
-    mTranspoOne.setTextBoxStyle(juce::Slider::TextBoxAbove, false, 100, 25);
-    mTranspoOne.setRange(-12.0, 12.0, 0.1);
-    mTranspoOne.setValue(audioProcessor.mTranspoOne);
-    addAndMakeVisible(&mTranspoOne);
-    mTranspoOne.addListener(this);
-    
-    mTranspoTwo.setTextBoxStyle(juce::Slider::TextBoxAbove, false, 100, 25);
-    mTranspoTwo.setRange(-12.0, 12.0, 0.1);
-    mTranspoTwo.setValue(audioProcessor.mTranspoTwo);
-    addAndMakeVisible(&mTranspoTwo);
-    mTranspoTwo.addListener(this);
-    
-    mWindowSizeMs.setTextBoxStyle(juce::Slider::TextBoxAbove, false, 100, 25);
-    mWindowSizeMs.setRange(5.0, 300.0, 0.1);
-    mWindowSizeMs.setValue(audioProcessor.mWindowSizeMs);
-    addAndMakeVisible(&mWindowSizeMs);
-    mWindowSizeMs.addListener(this);
-    
-    mPreset.addItem("Perfect Fifth", 1);
-    mPreset.addItem("Weird", 2);
-    mPreset.addItem("Scary", 3);
-    mPreset.setSelectedId(audioProcessor.mPresetFlag);
-    addAndMakeVisible(&mPreset);
-    mPreset.addListener(this);
-    
-    addAndMakeVisible(&mTranspoTwoLabel);
-    mTranspoOneLabel.setText("Transposition Voice 1", juce::dontSendNotification);
-    mTranspoOneLabel.attachToComponent(&mTranspoOne, true);
-    mTranspoOneLabel.setColour(juce::Label::textColourId, juce::Colours::magenta);
-    mTranspoOneLabel.setJustificationType(juce::Justification::right);
-    
-    addAndMakeVisible(&mTranspoOneLabel);
-    mTranspoTwoLabel.setText("Transposition Voice 2", juce::dontSendNotification);
-    mTranspoTwoLabel.attachToComponent(&mTranspoTwo, true);
-    mTranspoTwoLabel.setColour(juce::Label::textColourId, juce::Colours::magenta);
-    mTranspoTwoLabel.setJustificationType(juce::Justification::right);
-    
-    addAndMakeVisible(&mWindowSizeLabel);
-    mWindowSizeLabel.setText("Window Size", juce::dontSendNotification);
-    mWindowSizeLabel.attachToComponent(&mWindowSizeMs, true);
-    mWindowSizeLabel.setColour(juce::Label::textColourId, juce::Colours::magenta);
-    mWindowSizeLabel.setJustificationType(juce::Justification::right);
-}
-
-PitchShifterAudioProcessorEditor::~PitchShifterAudioProcessorEditor()
-{
-    mTranspoOne.removeListener(this);
-    mTranspoTwo.removeListener(this);
-    mWindowSizeMs.removeListener(this);
-    mPreset.removeListener(this);
-}
-
-//==============================================================================
-void PitchShifterAudioProcessorEditor::sliderValueChanged(juce::Slider *slider)
-{
-    double phasorFreqOne, phasorFreqTwo, windowSizeSec;
-    
-    audioProcessor.mWindowSizeMs = mWindowSizeMs.getValue();
-    windowSizeSec = audioProcessor.mWindowSizeMs/(double)1000.0f;
-    audioProcessor.mWindowSizeSamps = atec::Utilities::sec2samp(windowSizeSec, audioProcessor.mSampleRate);
-    audioProcessor.mTranspoOne = mTranspoOne.getValue();
-    audioProcessor.mTranspoTwo = mTranspoTwo.getValue();
-    
-    phasorFreqOne = atec::Utilities::transpo2freq(audioProcessor.mTranspoOne, audioProcessor.mWindowSizeMs);
-    phasorFreqTwo = atec::Utilities::transpo2freq(audioProcessor.mTranspoTwo, audioProcessor.mWindowSizeMs);
-    audioProcessor.setPhasorFreqOne(phasorFreqOne);
-    audioProcessor.setPhasorFreqTwo(phasorFreqTwo);
-    
-    DBG("Window Ms: " + juce::String(audioProcessor.mWindowSizeMs));
-    DBG("Window samples: " + juce::String(audioProcessor.mWindowSizeSamps));
-    DBG("TranspoOne: " + juce::String(audioProcessor.mTranspoOne));
-    DBG("TranspoTwo: " + juce::String(audioProcessor.mTranspoTwo));
-    DBG("FreqOne" + juce::String(phasorFreqOne));
-    DBG("FreqTwo" + juce::String(phasorFreqTwo));
-}
-
-void PitchShifterAudioProcessorEditor::comboBoxChanged(juce::ComboBox *comboBox)
-{
-    audioProcessor.mPresetFlag = mPreset.getSelectedId();
-    
-    switch (mPreset.getSelectedId())
-    {
-        case 1:
-            mTranspoOne.setValue(0.0f);
-            mTranspoTwo.setValue(7.5f);
-            //mTranspo.setValue(4.0f);
-            break;
-            
-        case 2:
-            mTranspoOne.setValue(-12.0f);
-            mTranspoTwo.setValue(12.0f);
-            break;
-            
-        case 3:
-            mTranspoOne.setValue(0.0f);
-            mTranspoTwo.setValue(-6.5f);
-            
-        default:
-            break;
-    }
-}
-
-void PitchShifterAudioProcessorEditor::paint (juce::Graphics& g)
-{
-    // (Our component is opaque, so we must completely fill the background with a solid colour)
-    g.fillAll (getLookAndFeel().findColour (juce::ResizableWindow::backgroundColourId));
-
-    g.setColour (juce::Colours::white);
-    g.setFont (30.0f);
-    g.drawFittedText ("Pitch Shifter", getLocalBounds(), juce::Justification::centred, 1);
-}
-
-void PitchShifterAudioProcessorEditor::resized()
-{
-    // This is generally where you'll want to lay out the positions of any
-    // subcomponents in your editor..
-    
-    mTranspoOne.setBounds(200, 50, 300, 50);
-    
-    mTranspoTwo.setBounds(200, 100, 300, 50);
-    
-    mWindowSizeMs.setBounds(200, 400, 300, 50);
-    
-    mPreset.setBounds(350, 325, 75, 50);
-    
-}
+/*
+  ==============================================================================
+
+    This file contains the basic framework code for a JUCE plugin editor.
+
+  ==============================================================================
+*/
+
+#include "PluginProcessor.h"
+#include "PluginEditor.h"
+
+//==============================================================================
+PitchShifterAudioProcessorEditor::PitchShifterAudioProcessorEditor (PitchShifterAudioProcessor& p)
+    : AudioProcessorEditor (&p), audioProcessor (p), mVisualiser (p.getVisualiserFeed())
+{
+    // Make sure that before the constructor has finished, you've set the
+    // editor's size to whatever you need it to be.
+    setSize (700, 680);
+    
+    addAndMakeVisible(&mVisualiser);
+    
+    mTranspoOne.setTextBoxStyle(juce::Slider::TextBoxAbove, false, 100, 25);
+    addAndMakeVisible(&mTranspoOne);
+    mTranspoOneAttachment.reset(new SliderAttachment(audioProcessor.mParameters, PitchShifterAudioProcessor::transpoParamId(0), mTranspoOne));
+    
+    mTranspoTwo.setTextBoxStyle(juce::Slider::TextBoxAbove, false, 100, 25);
+    addAndMakeVisible(&mTranspoTwo);
+    mTranspoTwoAttachment.reset(new SliderAttachment(audioProcessor.mParameters, PitchShifterAudioProcessor::transpoParamId(1), mTranspoTwo));
+    
+    mWindowSizeMs.setTextBoxStyle(juce::Slider::TextBoxAbove, false, 100, 25);
+    addAndMakeVisible(&mWindowSizeMs);
+    mWindowSizeMsAttachment.reset(new SliderAttachment(audioProcessor.mParameters, ParamIDs::windowSize, mWindowSizeMs));
+    
+    mNumVoices.setTextBoxStyle(juce::Slider::TextBoxAbove, false, 100, 25);
+    addAndMakeVisible(&mNumVoices);
+    mNumVoicesAttachment.reset(new SliderAttachment(audioProcessor.mParameters, ParamIDs::numVoices, mNumVoices));
+    
+    mMix.setTextBoxStyle(juce::Slider::TextBoxAbove, false, 100, 25);
+    addAndMakeVisible(&mMix);
+    mMixAttachment.reset(new SliderAttachment(audioProcessor.mParameters, ParamIDs::mix, mMix));
+    
+    if (DspTelemetry::enabled)
+    {
+        mLoadMeter.setColour(juce::Label::textColourId, juce::Colours::magenta);
+        mLoadMeter.setJustificationType(juce::Justification::right);
+        mLoadMeter.setMinimumHorizontalScale(0.5f);
+        addAndMakeVisible(&mLoadMeter);
+        
+        mLogTelemetry.setColour(juce::ToggleButton::textColourId, juce::Colours::magenta);
+        mLogTelemetry.onClick = [this] { setTelemetryLogging(mLogTelemetry.getToggleState()); };
+        addAndMakeVisible(&mLogTelemetry);
+        
+        mTelemetryBlocks.resize(1024);
+    }
+    
+    mMorph.setTextBoxStyle(juce::Slider::TextBoxAbove, false, 100, 25);
+    addAndMakeVisible(&mMorph);
+    mMorphAttachment.reset(new SliderAttachment(audioProcessor.mParameters, ParamIDs::morph, mMorph));
+    
+    mOutputGain.setTextBoxStyle(juce::Slider::TextBoxAbove, false, 100, 25);
+    addAndMakeVisible(&mOutputGain);
+    mOutputGainAttachment.reset(new SliderAttachment(audioProcessor.mParameters, ParamIDs::outputGain, mOutputGain));
+    
+    mLowLatency.setColour(juce::ToggleButton::textColourId, juce::Colours::magenta);
+    addAndMakeVisible(&mLowLatency);
+    mLowLatencyAttachment.reset(new ButtonAttachment(audioProcessor.mParameters, ParamIDs::lowLatency, mLowLatency));
+    
+    refreshPresets();
+    addAndMakeVisible(&mPreset);
+    mPreset.addListener(this);
+    
+    // the morph ends are program numbers, which can outgrow a fixed choice list, so
+    // these set the parameters directly rather than through an attachment
+    addAndMakeVisible(&mMorphFrom);
+    mMorphFrom.addListener(this);
+    addAndMakeVisible(&mMorphTo);
+    mMorphTo.addListener(this);
+    
+    // the host can change program and automate the morph ends while the editor is open
+    startTimerHz(10);
+    
+    // captures the current musical settings as a new user preset
+    mStorePreset.onClick = [this]
+    {
+        const auto& bank = audioProcessor.getPresetBank();
+        
+        if (audioProcessor.storeUserPreset("User " + juce::String(bank.getNumPresets() - bank.getNumFactoryPresets() + 1)) >= 0)
+            refreshPresets();
+    };
+    addAndMakeVisible(&mStorePreset);
+    
+    for (int shape = 0; shape < GrainWindow::numShapes; shape++)
+        mWindowShape.addItem(GrainWindow::getName((GrainWindow::Shape) shape), shape + 1);
+    addAndMakeVisible(&mWindowShape);
+    mWindowShapeAttachment.reset(new ComboBoxAttachment(audioProcessor.mParameters, ParamIDs::windowShape, mWindowShape));
+    
+    mEngine.addItem("Granular", granularEngine + 1);
+    mEngine.addItem("Phase Vocoder", phaseVocoderEngine + 1);
+    addAndMakeVisible(&mEngine);
+    mEngineAttachment.reset(new ComboBoxAttachment(audioProcessor.mParameters, ParamIDs::engine, mEngine));
+    
+    for (int type = 0; type < Interpolation::numTypes; type++)
+        mInterpolation.addItem(Interpolation::getName((Interpolation::Type) type), type + 1);
+    addAndMakeVisible(&mInterpolation);
+    mInterpolationAttachment.reset(new ComboBoxAttachment(audioProcessor.mParameters, ParamIDs::interpolation, mInterpolation));
+    
+    mOversampling.addItemList({ "1x", "2x", "4x", "8x" }, 1);
+    addAndMakeVisible(&mOversampling);
+    mOversamplingAttachment.reset(new ComboBoxAttachment(audioProcessor.mParameters, ParamIDs::oversampling, mOversampling));
+    
+    addAndMakeVisible(&mTranspoTwoLabel);
+    mTranspoOneLabel.setText("Transposition Voice 1", juce::dontSendNotification);
+    mTranspoOneLabel.attachToComponent(&mTranspoOne, true);
+    mTranspoOneLabel.setColour(juce::Label::textColourId, juce::Colours::magenta);
+    mTranspoOneLabel.setJustificationType(juce::Justification::right);
+    
+    addAndMakeVisible(&mTranspoOneLabel);
+    mTranspoTwoLabel.setText("Transposition Voice 2", juce::dontSendNotification);
+    mTranspoTwoLabel.attachToComponent(&mTranspoTwo, true);
+    mTranspoTwoLabel.setColour(juce::Label::textColourId, juce::Colours::magenta);
+    mTranspoTwoLabel.setJustificationType(juce::Justification::right);
+    
+    addAndMakeVisible(&mWindowSizeLabel);
+    mWindowSizeLabel.setText("Window Size", juce::dontSendNotification);
+    mWindowSizeLabel.attachToComponent(&mWindowSizeMs, true);
+    mWindowSizeLabel.setColour(juce::Label::textColourId, juce::Colours::magenta);
+    mWindowSizeLabel.setJustificationType(juce::Justification::right);
+    
+    addAndMakeVisible(&mNumVoicesLabel);
+    mNumVoicesLabel.setText("Voices", juce::dontSendNotification);
+    mNumVoicesLabel.attachToComponent(&mNumVoices, true);
+    mNumVoicesLabel.setColour(juce::Label::textColourId, juce::Colours::magenta);
+    mNumVoicesLabel.setJustificationType(juce::Justification::right);
+    
+    addAndMakeVisible(&mMixLabel);
+    mMixLabel.setText("Mix", juce::dontSendNotification);
+    mMixLabel.attachToComponent(&mMix, true);
+    mMixLabel.setColour(juce::Label::textColourId, juce::Colours::magenta);
+    mMixLabel.setJustificationType(juce::Justification::right);
+    
+    addAndMakeVisible(&mMorphLabel);
+    mMorphLabel.setText("Morph", juce::dontSendNotification);
+    mMorphLabel.attachToComponent(&mMorph, true);
+    mMorphLabel.setColour(juce::Label::textColourId, juce::Colours::magenta);
+    mMorphLabel.setJustificationType(juce::Justification::right);
+    
+    addAndMakeVisible(&mOutputGainLabel);
+    mOutputGainLabel.setText("Output", juce::dontSendNotification);
+    mOutputGainLabel.attachToComponent(&mOutputGain, true);
+    mOutputGainLabel.setColour(juce::Label::textColourId, juce::Colours::magenta);
+    mOutputGainLabel.setJustificationType(juce::Justification::right);
+    
+    addAndMakeVisible(&mMorphFromLabel);
+    mMorphFromLabel.setText("From", juce::dontSendNotification);
+    mMorphFromLabel.attachToComponent(&mMorphFrom, true);
+    mMorphFromLabel.setColour(juce::Label::textColourId, juce::Colours::magenta);
+    mMorphFromLabel.setJustificationType(juce::Justification::right);
+    
+    addAndMakeVisible(&mMorphToLabel);
+    mMorphToLabel.setText("To", juce::dontSendNotification);
+    mMorphToLabel.attachToComponent(&mMorphTo, true);
+    mMorphToLabel.setColour(juce::Label::textColourId, juce::Colours::magenta);
+    mMorphToLabel.setJustificationType(juce::Justification::right);
+    
+    addAndMakeVisible(&mWindowShapeLabel);
+    mWindowShapeLabel.setText("Window Shape", juce::dontSendNotification);
+    mWindowShapeLabel.attachToComponent(&mWindowShape, true);
+    mWindowShapeLabel.setColour(juce::Label::textColourId, juce::Colours::magenta);
+    mWindowShapeLabel.setJustificationType(juce::Justification::right);
+    
+    addAndMakeVisible(&mEngineLabel);
+    mEngineLabel.setText("Engine", juce::dontSendNotification);
+    mEngineLabel.attachToComponent(&mEngine, true);
+    mEngineLabel.setColour(juce::Label::textColourId, juce::Colours::magenta);
+    mEngineLabel.setJustificationType(juce::Justification::right);
+    
+    addAndMakeVisible(&mInterpolationLabel);
+    mInterpolationLabel.setText("Interpolation", juce::dontSendNotification);
+    mInterpolationLabel.attachToComponent(&mInterpolation, true);
+    mInterpolationLabel.setColour(juce::Label::textColourId, juce::Colours::magenta);
+    mInterpolationLabel.setJustificationType(juce::Justification::right);
+    
+    addAndMakeVisible(&mOversamplingLabel);
+    mOversamplingLabel.setText("Oversampling", juce::dontSendNotification);
+    mOversamplingLabel.attachToComponent(&mOversampling, true);
+    mOversamplingLabel.setColour(juce::Label::textColourId, juce::Colours::magenta);
+    mOversamplingLabel.setJustificationType(juce::Justification::right);
+}
+
+PitchShifterAudioProcessorEditor::~PitchShifterAudioProcessorEditor()
+{
+    mPreset.removeListener(this);
+    mMorphFrom.removeListener(this);
+    mMorphTo.removeListener(this);
+    stopTimer();
+}
+
+//==============================================================================
+void PitchShifterAudioProcessorEditor::comboBoxChanged(juce::ComboBox *comboBox)
+{
+    // the sliders are attached to parameters, so they follow the preset once the audio thread swaps it in
+    if (comboBox == &mPreset && mPreset.getSelectedId() > 0)
+        audioProcessor.setCurrentProgram(mPreset.getSelectedId() - 1);
+    else if (comboBox == &mMorphFrom && mMorphFrom.getSelectedId() > 0)
+        audioProcessor.setParameterValue(ParamIDs::morphFrom, (float) (mMorphFrom.getSelectedId() - 1));
+    else if (comboBox == &mMorphTo && mMorphTo.getSelectedId() > 0)
+        audioProcessor.setParameterValue(ParamIDs::morphTo, (float) (mMorphTo.getSelectedId() - 1));
+}
+
+void PitchShifterAudioProcessorEditor::timerCallback()
+{
+    // a state restored from elsewhere can bring more user presets with it
+    if (mPreset.getNumItems() != audioProcessor.getNumPrograms())
+        refreshPresets();
+    else
+        showSelectedPresets();
+    
+    if (! DspTelemetry::enabled)
+        return;
+    
+    auto& telemetry = audioProcessor.getTelemetry();
+    double total = 0.0, budget = 0.0, peak = 0.0;
+    int numBlocks;
+    
+    // drain everything queued since the last tick so the meter covers every block
+    while ((numBlocks = telemetry.pull(mTelemetryBlocks.data(), (int) mTelemetryBlocks.size())) > 0)
+    {
+        for (int i = 0; i < numBlocks; i++)
+        {
+            const auto& block = mTelemetryBlocks[(size_t) i];
+            total += block.total;
+            budget += block.budget;
+            peak = juce::jmax(peak, block.budget > 0.0 ? block.total / block.budget : 0.0);
+            
+            if (mTelemetryLog != nullptr)
+                mTelemetryLog->writeText(DspTelemetry::toCsvRow(block) + "\n", false, false, nullptr);
+        }
+    }
+    
+    if (budget <= 0.0)
+        return;
+    
+    mLoadMeter.setText("DSP " + juce::String(100.0 * total / budget, 1) + "%  peak " + juce::String(100.0 * peak, 1)
+                       + "%  overruns " + juce::String(telemetry.getNumOverruns()), juce::dontSendNotification);
+}
+
+void PitchShifterAudioProcessorEditor::setTelemetryLogging(bool shouldLog)
+{
+    mTelemetryLog.reset();
+    
+    if (! shouldLog)
+        return;
+    
+    auto file = juce::File::getSpecialLocation(juce::File::userDocumentsDirectory)
+                    .getNonexistentChildFile("PitchShifter Load", ".csv");
+    
+    mTelemetryLog = file.createOutputStream();
+    
+    if (mTelemetryLog != nullptr)
+        mTelemetryLog->writeText(DspTelemetry::getCsvHeader() + "\n", false, false, nullptr);
+    else
+        mLogTelemetry.setToggleState(false, juce::dontSendNotification);
+}
+
+void PitchShifterAudioProcessorEditor::refreshPresets()
+{
+    mPreset.clear(juce::dontSendNotification);
+    
+    for (int index = 0; index < audioProcessor.getNumPrograms(); index++)
+        mPreset.addItem(audioProcessor.getProgramName(index), index + 1);
+    
+    // item id = morph parameter value + 1, with "Live" standing for the parameters as set
+    for (auto* morphEnd : { &mMorphFrom, &mMorphTo })
+    {
+        morphEnd->clear(juce::dontSendNotification);
+        morphEnd->addItem("Live", 1);
+        
+        for (int index = 0; index < audioProcessor.getNumPrograms(); index++)
+            morphEnd->addItem(audioProcessor.getProgramName(index), index + 2);
+    }
+    
+    showSelectedPresets();
+}
+
+void PitchShifterAudioProcessorEditor::showSelectedPresets()
+{
+    // setting the id a box already shows does nothing, so this is cheap to call every tick
+    mPreset.setSelectedId(audioProcessor.getCurrentProgram() + 1, juce::dontSendNotification);
+    mMorphFrom.setSelectedId((int) *audioProcessor.mParameters.getRawParameterValue(ParamIDs::morphFrom) + 1, juce::dontSendNotification);
+    mMorphTo.setSelectedId((int) *audioProcessor.mParameters.getRawParameterValue(ParamIDs::morphTo) + 1, juce::dontSendNotification);
+}
+
+void PitchShifterAudioProcessorEditor::paint (juce::Graphics& g)
+{
+    // (Our component is opaque, so we must completely fill the background with a solid colour)
+    g.fillAll (getLookAndFeel().findColour (juce::ResizableWindow::backgroundColourId));
+
+    g.setColour (juce::Colours::white);
+    g.setFont (30.0f);
+    g.drawFittedText ("Pitch Shifter", getLocalBounds().removeFromTop (500), juce::Justification::centred, 1);
+}
+
+void PitchShifterAudioProcessorEditor::resized()
+{
+    // This is generally where you'll want to lay out the positions of any
+    // subcomponents in your editor..
+    
+    mTranspoOne.setBounds(200, 50, 300, 50);
+    
+    mTranspoTwo.setBounds(200, 100, 300, 50);
+    
+    mWindowSizeMs.setBounds(200, 400, 300, 50);
+    
+    mNumVoices.setBounds(200, 150, 300, 50);
+    
+    mPreset.setBounds(350, 325, 120, 30);
+    
+    mStorePreset.setBounds(475, 325, 60, 30);
+    
+    mWindowShape.setBounds(350, 250, 100, 30);
+    
+    mEngine.setBounds(350, 210, 120, 30);
+    
+    mInterpolation.setBounds(560, 250, 120, 30);
+    
+    mOversampling.setBounds(560, 290, 120, 30);
+    
+    mMix.setBounds(200, 450, 300, 50);
+    
+    mLowLatency.setBounds(520, 410, 150, 30);
+    
+    mMorph.setBounds(580, 40, 110, 50);
+    
+    mMorphFrom.setBounds(580, 100, 110, 30);
+    
+    mMorphTo.setBounds(580, 140, 110, 30);
+    
+    mOutputGain.setBounds(580, 180, 110, 50);
+    
+    mLoadMeter.setBounds(510, 470, 180, 25);
+    
+    mLogTelemetry.setBounds(590, 440, 100, 25);
+    
+    mVisualiser.setBounds(10, 510, 680, 160);
+    
+}
@@ -1,45 +1,103 @@
-/*
-  ==============================================================================
-
-    This file contains the basic framework code for a JUCE plugin editor.
-
-  ==============================================================================
-*/
-
-#pragma once
-
-#include <JuceHeader.h>
-#include "PluginProcessor.h"
-
-//==============================================================================
-/**
-*/
-class PitchShifterAudioProcessorEditor  : public juce::AudioProcessorEditor, public juce::Slider::Listener, public juce::ComboBox::Listener
-{
-public:
-    PitchShifterAudioProcessorEditor (PitchShifterAudioProcessor&);
-    ~PitchShifterAudioProcessorEditor() override;
-
-    //==============================================================================
-    void paint (juce::Graphics&) override;
-    void resized() override;
-
-private:
-    // This reference is provided as a quick way for your editor to
-    // access the processor object that created it.
-    PitchShifterAudioProcessor& audioProcessor;
-    
-    juce::Slider mTranspoOne;
-    juce::Slider mTranspoTwo;
-    juce::Slider mWindowSizeMs;
-    juce::Label mTranspoOneLabel;
-    juce::Label mTranspoTwoLabel;
-    juce::Label mWindowSizeLabel;
-    juce::ComboBox mPreset;
-    juce::Label mPresetLabel;
-    
-    void sliderValueChanged (juce::Slider* slider) override;
-    void comboBoxChanged (juce::ComboBox* comboBox) override;
-
-    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PitchShifterAudioProcessorEditor)
-};
+/*
+  ==============================================================================
+
+    This file contains the basic framework code for a JUCE plugin editor.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+#include "GrainVisualiser.h"
+
+//==============================================================================
+/**
+*/
+class PitchShifterAudioProcessorEditor  : public juce::AudioProcessorEditor, public juce::ComboBox::Listener,
+                                          private juce::Timer
+{
+public:
+    PitchShifterAudioProcessorEditor (PitchShifterAudioProcessor&);
+    ~PitchShifterAudioProcessorEditor() override;
+
+    //==============================================================================
+    void paint (juce::Graphics&) override;
+    void resized() override;
+
+private:
+    // This reference is provided as a quick way for your editor to
+    // access the processor object that created it.
+    PitchShifterAudioProcessor& audioProcessor;
+    
+    juce::Slider mTranspoOne;
+    juce::Slider mTranspoTwo;
+    juce::Slider mWindowSizeMs;
+    juce::Slider mNumVoices;
+    juce::Slider mMix;
+    juce::Slider mMorph;
+    juce::Slider mOutputGain;
+    juce::Label mTranspoOneLabel;
+    juce::Label mTranspoTwoLabel;
+    juce::Label mWindowSizeLabel;
+    juce::Label mNumVoicesLabel;
+    juce::Label mMixLabel;
+    juce::Label mMorphLabel;
+    juce::Label mOutputGainLabel;
+    juce::ComboBox mPreset;
+    juce::Label mPresetLabel;
+    juce::TextButton mStorePreset { "Store" };
+    juce::ComboBox mMorphFrom;
+    juce::Label mMorphFromLabel;
+    juce::ComboBox mMorphTo;
+    juce::Label mMorphToLabel;
+    juce::ComboBox mWindowShape;
+    juce::Label mWindowShapeLabel;
+    juce::ComboBox mEngine;
+    juce::Label mEngineLabel;
+    juce::ComboBox mInterpolation;
+    juce::Label mInterpolationLabel;
+    juce::ComboBox mOversampling;
+    juce::Label mOversamplingLabel;
+    juce::ToggleButton mLowLatency { "Low Latency" };
+    
+    GrainVisualiser mVisualiser;
+    
+    // DSP load from the processor's telemetry, optionally logged as CSV
+    juce::Label mLoadMeter;
+    juce::ToggleButton mLogTelemetry { "Log Load" };
+    std::unique_ptr<juce::FileOutputStream> mTelemetryLog;
+    std::vector<DspTelemetry::BlockStats> mTelemetryBlocks;
+    
+    // attachments must be destroyed before the components they control,
+    // so they're declared after them
+    using SliderAttachment = juce::AudioProcessorValueTreeState::SliderAttachment;
+    using ComboBoxAttachment = juce::AudioProcessorValueTreeState::ComboBoxAttachment;
+    using ButtonAttachment = juce::AudioProcessorValueTreeState::ButtonAttachment;
+    std::unique_ptr<SliderAttachment> mTranspoOneAttachment;
+    std::unique_ptr<SliderAttachment> mTranspoTwoAttachment;
+    std::unique_ptr<SliderAttachment> mWindowSizeMsAttachment;
+    std::unique_ptr<SliderAttachment> mNumVoicesAttachment;
+    std::unique_ptr<SliderAttachment> mMixAttachment;
+    std::unique_ptr<SliderAttachment> mMorphAttachment;
+    std::unique_ptr<SliderAttachment> mOutputGainAttachment;
+    std::unique_ptr<ComboBoxAttachment> mWindowShapeAttachment;
+    std::unique_ptr<ComboBoxAttachment> mEngineAttachment;
+    std::unique_ptr<ComboBoxAttachment> mInterpolationAttachment;
+    std::unique_ptr<ComboBoxAttachment> mOversamplingAttachment;
+    std::unique_ptr<ButtonAttachment> mLowLatencyAttachment;
+    
+    void comboBoxChanged (juce::ComboBox* comboBox) override;
+    
+    void timerCallback() override;
+    void setTelemetryLogging(bool shouldLog);
+    
+    // lists the processor's presets, ticking the current one and the morph ends
+    void refreshPresets();
+    
+    // ticks the current preset and the morph ends without rebuilding the lists
+    void showSelectedPresets();
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PitchShifterAudioProcessorEditor)
+};
@@ -1,316 +1,1225 @@
-/*
-  ==============================================================================
-
-    This file contains the basic framework code for a JUCE plugin processor.
-
-  ==============================================================================
-*/
-
-#include "PluginProcessor.h"
-#include "PluginEditor.h"
-
-//==============================================================================
-PitchShifterAudioProcessor::PitchShifterAudioProcessor()
-#ifndef JucePlugin_PreferredChannelConfigurations
-     : AudioProcessor (BusesProperties()
-                     #if ! JucePlugin_IsMidiEffect
-                      #if ! JucePlugin_IsSynth
-                       .withInput  ("Input",  juce::AudioChannelSet::stereo(), true)
-                      #endif
-                       .withOutput ("Output", juce::AudioChannelSet::stereo(), true)
-                     #endif
-                       )
-#endif
-{
-    mTranspoOne = 0.0f;
-    mTranspoTwo = 0.0f;
-    mWindowSizeMs = 50.0f;
-    mPresetFlag = 1;
-}
-
-PitchShifterAudioProcessor::~PitchShifterAudioProcessor()
-{
-}
-
-//==============================================================================
-void PitchShifterAudioProcessor::setPhasorType(atec::LFO::LfoType t)
-{
-    mPhasorOne[0].setType(t);
-    mPhasorOne[1].setType(t);
-    mPhasorTwo[0].setType(t);
-    mPhasorTwo[1].setType(t);
-}
-
-void PitchShifterAudioProcessor::setPhasorFreqOne(double f)
-{
-    mPhasorOne[0].setFreq(f);
-    mPhasorOne[1].setFreq(f);
-}
-
-void PitchShifterAudioProcessor::setPhasorFreqTwo(double f)
-{
-    mPhasorTwo[0].setFreq(f);
-    mPhasorTwo[1].setFreq(f);
-}
-
-void PitchShifterAudioProcessor::setPhasorDebug(bool d)
-{
-    mPhasorOne[0].debug(d);
-    mPhasorOne[1].debug(d);
-    mPhasorTwo[0].debug(d);
-    mPhasorTwo[1].debug(d);
-
-}
-
-void PitchShifterAudioProcessor::initPhasor()
-{
-    mPhasorOne[0].init();
-    mPhasorOne[1].init();
-    mPhasorTwo[0].init();
-    mPhasorTwo[1].init();
-}
-
-
-const juce::String PitchShifterAudioProcessor::getName() const
-{
-    return JucePlugin_Name;
-}
-
-bool PitchShifterAudioProcessor::acceptsMidi() const
-{
-   #if JucePlugin_WantsMidiInput
-    return true;
-   #else
-    return false;
-   #endif
-}
-
-bool PitchShifterAudioProcessor::producesMidi() const
-{
-   #if JucePlugin_ProducesMidiOutput
-    return true;
-   #else
-    return false;
-   #endif
-}
-
-bool PitchShifterAudioProcessor::isMidiEffect() const
-{
-   #if JucePlugin_IsMidiEffect
-    return true;
-   #else
-    return false;
-   #endif
-}
-
-double PitchShifterAudioProcessor::getTailLengthSeconds() const
-{
-    return 0.0;
-}
-
-int PitchShifterAudioProcessor::getNumPrograms()
-{
-    return 1;   // NB: some hosts don't cope very well if you tell them there are 0 programs,
-                // so this should be at least 1, even if you're not really implementing programs.
-}
-
-int PitchShifterAudioProcessor::getCurrentProgram()
-{
-    return 0;
-}
-
-void PitchShifterAudioProcessor::setCurrentProgram (int index)
-{
-}
-
-const juce::String PitchShifterAudioProcessor::getProgramName (int index)
-{
-    return {};
-}
-
-void PitchShifterAudioProcessor::changeProgramName (int index, const juce::String& newName)
-{
-}
-
-//==============================================================================
-void PitchShifterAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
-{
-    double phasorFreqOne, phasorFreqTwo;
-    
-    mNumInputChannels = getTotalNumInputChannels();
-    mBlockSize = samplesPerBlock;
-    mSampleRate = sampleRate;
-    
-    //initialize mWindowSizeSamps now that we know the sample rate
-    mWindowSizeSamps = atec::Utilities::sec2samp(mWindowSizeMs/1000.0f, mSampleRate);
-    
-    mRingBuf.debug(false);
-    mRingBuf.setSize(mNumInputChannels, 1.0 * mSampleRate, mBlockSize);
-    mRingBuf.init();
-    
-    setPhasorDebug(false);
-    setPhasorType(atec::LFO::saw);
-    phasorFreqOne = atec::Utilities::transpo2freq(mTranspoOne, mWindowSizeMs);
-    phasorFreqTwo = atec::Utilities::transpo2freq(mTranspoTwo, mWindowSizeMs);
-    setPhasorFreqOne(phasorFreqOne);
-    setPhasorFreqTwo(phasorFreqTwo);
-
-    initPhasor();
-}
-
-void PitchShifterAudioProcessor::releaseResources()
-{
-    // When playback stops, you can use this as an opportunity to free up any
-    // spare memory, etc.
-}
-
-#ifndef JucePlugin_PreferredChannelConfigurations
-bool PitchShifterAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts) const
-{
-  #if JucePlugin_IsMidiEffect
-    juce::ignoreUnused (layouts);
-    return true;
-  #else
-    // This is the place where you check if the layout is supported.
-    // In this template code we only support mono or stereo.
-    // Some plugin hosts, such as certain GarageBand versions, will only
-    // load plugins that support stereo bus layouts.
-    if (layouts.getMainOutputChannelSet() != juce::AudioChannelSet::mono()
-     && layouts.getMainOutputChannelSet() != juce::AudioChannelSet::stereo())
-        return false;
-
-    // This checks if the input layout matches the output layout
-   #if ! JucePlugin_IsSynth
-    if (layouts.getMainOutputChannelSet() != layouts.getMainInputChannelSet())
-        return false;
-   #endif
-
-    return true;
-  #endif
-}
-#endif
-
-void PitchShifterAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
-{
-    juce::ScopedNoDenormals noDenormals;
-    auto totalNumInputChannels  = getTotalNumInputChannels();
-    auto totalNumOutputChannels = getTotalNumOutputChannels();
-    auto bufSize = buffer.getNumSamples();
-
-    // In case we have more outputs than inputs, this code clears any output
-    // channels that didn't contain input data, (because these aren't
-    // guaranteed to be empty - they may contain garbage).
-    // This is here to avoid people getting screaming feedback
-    // when they first compile a plugin, but obviously you don't need to keep
-    // this code if your algorithm always overwrites all the output channels.
-    for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
-        buffer.clear (i, 0, buffer.getNumSamples());
-    
-    //use a range-based for loop to look at the incoming MIDI messages
-    for (const auto metadata : midiMessages)
-    {
-        double phasorFreqOne, phasorFreqTwo;
-        auto message = metadata.getMessage();
-        
-        if(message.isNoteOn())
-        {
-            mTranspoOne = message.getNoteNumber() - 60.0f;
-            mTranspoTwo = message.getNoteNumber() - 60.0f;
-            phasorFreqOne = atec::Utilities::transpo2freq(mTranspoOne, mWindowSizeMs);
-            phasorFreqTwo = atec::Utilities::transpo2freq(mTranspoTwo, mWindowSizeMs);
-            setPhasorFreqOne(phasorFreqOne);
-            setPhasorFreqTwo(phasorFreqTwo);
-        }
-    }
-    
-    mRingBuf.write(buffer);
-    
-    buffer.clear();
-
-    // pull a block of delayed interpolated audio from the RingBuffer
-    // we'll read at two different positions A & B, and crossfade the results
-    for (int channel = 0; channel < totalNumInputChannels; ++channel)
-    {
-        auto* channelData = buffer.getWritePointer (channel);
-        
-        for (int i = 0; i < bufSize; i++)
-        {
-            double phasorSampleA, phasorSampleB;
-            double envSignalA, envSignalB;
-            double delayTimeSignalA, delayTimeSignalB;
-            double sampleA, sampleB;
-            
-            //Voice 1
-            phasorSampleA = mPhasorOne[channel].getNextSample();
-            phasorSampleB = std::fmod(phasorSampleA + 0.5, 1.0f);
-            
-            envSignalA = std::sin(phasorSampleA * juce::MathConstants<double>::pi);
-            delayTimeSignalA = phasorSampleA * mWindowSizeSamps;
-            
-            envSignalB = std::sin(phasorSampleB * juce::MathConstants<double>::pi);
-            delayTimeSignalB = phasorSampleB * mWindowSizeSamps;
-            
-            sampleA = mRingBuf.readInterpSample(channel, i - mWindowSizeSamps, delayTimeSignalA);
-            sampleA *= envSignalA;
-            
-            sampleB = mRingBuf.readInterpSample(channel, i - mWindowSizeSamps, delayTimeSignalB);
-            sampleB *= envSignalB;
-            
-            channelData[i] = sampleA + sampleB;
-            
-            //Voice 2
-            phasorSampleA = mPhasorTwo[channel].getNextSample();
-            phasorSampleB = std::fmod(phasorSampleA + 0.5, 1.0f);
-            
-            envSignalA = std::sin(phasorSampleA * juce::MathConstants<double>::pi);
-            delayTimeSignalA = phasorSampleA * mWindowSizeSamps;
-            
-            envSignalB = std::sin(phasorSampleB * juce::MathConstants<double>::pi);
-            delayTimeSignalB = phasorSampleB * mWindowSizeSamps;
-            
-            sampleA = mRingBuf.readInterpSample(channel, i - mWindowSizeSamps, delayTimeSignalA);
-            sampleA *= envSignalA;
-            
-            sampleB = mRingBuf.readInterpSample(channel, i - mWindowSizeSamps, delayTimeSignalB);
-            sampleB *= envSignalB;
-            
-            channelData[i] += sampleA + sampleB;
-        }
-        
-    }
-    
-    buffer.applyGain(juce::Decibels::decibelsToGain(-3.0f));
-    
-}
-
-//==============================================================================
-bool PitchShifterAudioProcessor::hasEditor() const
-{
-    return true; // (change this to false if you choose to not supply an editor)
-}
-
-juce::AudioProcessorEditor* PitchShifterAudioProcessor::createEditor()
-{
-    return new PitchShifterAudioProcessorEditor (*this);
-}
-
-//==============================================================================
-void PitchShifterAudioProcessor::getStateInformation (juce::MemoryBlock& destData)
-{
-    // You should use this method to store your parameters in the memory block.
-    // You could do that either as raw data, or use the XML or ValueTree classes
-    // as intermediaries to make it easy to save and load complex data.
-}
-
-void PitchShifterAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
-{
-    // You should use this method to restore your parameters from this memory block,
-    // whose contents will have been created by the getStateInformation() call.
-}
-
-//==============================================================================
-// This creates new instances of the plugin..
-juce::AudioProcessor* JUCE_CALLTYPE createPluginFilter()
-{
-    return new PitchShifterAudioProcessor();
-}
+/*
+  ==============================================================================
+
+    This file contains the basic framework code for a JUCE plugin processor.
+
+  ==============================================================================
+*/
+
+#include "PluginProcessor.h"
+#include "PluginEditor.h"
+
+//==============================================================================
+PitchShifterAudioProcessor::PitchShifterAudioProcessor()
+#ifndef JucePlugin_PreferredChannelConfigurations
+     : AudioProcessor (BusesProperties()
+                     #if ! JucePlugin_IsMidiEffect
+                      #if ! JucePlugin_IsSynth
+                       .withInput  ("Input",  juce::AudioChannelSet::stereo(), true)
+                      #endif
+                       .withOutput ("Output", juce::AudioChannelSet::stereo(), true)
+                     #endif
+                       ),
+#else
+     :
+#endif
+       mParameters (*this, nullptr, juce::Identifier ("PitchShifter"), createParameterLayout())
+{
+    mWindowSizeParam = mParameters.getRawParameterValue(ParamIDs::windowSize);
+    mNumVoicesParam = mParameters.getRawParameterValue(ParamIDs::numVoices);
+    mWindowShapeParam = mParameters.getRawParameterValue(ParamIDs::windowShape);
+    mEngineParam = mParameters.getRawParameterValue(ParamIDs::engine);
+    mFftSizeParam = mParameters.getRawParameterValue(ParamIDs::fftSize);
+    mFftOverlapParam = mParameters.getRawParameterValue(ParamIDs::fftOverlap);
+    mMixParam = mParameters.getRawParameterValue(ParamIDs::mix);
+    mOutputGainParam = mParameters.getRawParameterValue(ParamIDs::outputGain);
+    mLowLatencyParam = mParameters.getRawParameterValue(ParamIDs::lowLatency);
+    mInterpolationParam = mParameters.getRawParameterValue(ParamIDs::interpolation);
+    mOversamplingParam = mParameters.getRawParameterValue(ParamIDs::oversampling);
+    mOversamplingFilterParam = mParameters.getRawParameterValue(ParamIDs::oversamplingFilter);
+    mParameters.addParameterListener(ParamIDs::oversampling, this);
+    mParameters.addParameterListener(ParamIDs::oversamplingFilter, this);
+    mMorphParam = mParameters.getRawParameterValue(ParamIDs::morph);
+    mMorphFromParam = mParameters.getRawParameterValue(ParamIDs::morphFrom);
+    mMorphToParam = mParameters.getRawParameterValue(ParamIDs::morphTo);
+    mParameters.addParameterListener(ParamIDs::morphFrom, this);
+    mParameters.addParameterListener(ParamIDs::morphTo, this);
+    
+    for (int voice = 0; voice < VoiceEngine::maxVoices; voice++)
+    {
+        mTranspoParams[voice] = mParameters.getRawParameterValue(transpoParamId(voice));
+        mGainParams[voice] = mParameters.getRawParameterValue(gainParamId(voice));
+    }
+    
+    for (auto* param : getParameters())
+    {
+        auto* ranged = dynamic_cast<juce::RangedAudioParameter*>(param);
+        jassert(ranged != nullptr);
+        
+        mStateParamsByHash.push_back({ ranged->paramID.hashCode(), (int) mStateParams.size() });
+        mStateParams.push_back(ranged);
+    }
+    
+    std::sort(mStateParamsByHash.begin(), mStateParamsByHash.end());
+    
+    // saved states key values by ID hash, so two IDs must never share one
+    jassert(std::adjacent_find(mStateParamsByHash.begin(), mStateParamsByHash.end(),
+                               [] (const auto& a, const auto& b) { return a.first == b.first; }) == mStateParamsByHash.end());
+    
+    // presets hold the sound, not the set-up: engine, quality, morph and output settings stay as they are
+    mPresetParams.assign(mStateParams.size(), false);
+    
+    for (const char* paramId : { ParamIDs::windowSize, ParamIDs::numVoices, ParamIDs::windowShape, ParamIDs::mix })
+        mPresetParams[(size_t) findStateParam(juce::String(paramId).hashCode())] = true;
+    
+    for (int voice = 0; voice < VoiceEngine::maxVoices; voice++)
+    {
+        mPresetParams[(size_t) findStateParam(transpoParamId(voice).hashCode())] = true;
+        mPresetParams[(size_t) findStateParam(gainParamId(voice).hashCode())] = true;
+    }
+    
+    mPresetBank.prepare((int) mStateParams.size());
+    mPresetValues.resize(mStateParams.size());
+    addFactoryPresets();
+    mCurrentPreset = nice - 1;
+    mPendingPreset = -1;
+    mPresetFade = 1.0f;
+    mPresetFadeStart = 1.0f;
+    
+    mMorphValueParams[morphWindowSize] = findStateParam(juce::String(ParamIDs::windowSize).hashCode());
+    mMorphValueParams[morphNumVoices] = findStateParam(juce::String(ParamIDs::numVoices).hashCode());
+    
+    for (int voice = 0; voice < VoiceEngine::maxVoices; voice++)
+    {
+        mMorphValueParams[morphTranspo + voice] = findStateParam(transpoParamId(voice).hashCode());
+        mMorphValueParams[morphGain + voice] = findStateParam(gainParamId(voice).hashCode());
+    }
+    
+    updateMorphTable();
+    
+    mChannelThreadsEnabled = true;
+    mBlockLength = 0;
+    mDoublePrecision = false;
+    mSilentSamples = 0;
+    mDrainSamples = 0;
+    mProcessingState = processingFull;
+    mOversamplingFactor = 1;
+    mPreparedOversampling = 0;
+    mPreparedOversamplingFilter = 0;
+    mPrepared = false;
+    mRenderedEngine = granularEngine;
+    mMidiNoteActive = false;
+    mMidiNote = -1;
+    mMidiTranspo = 0.0;
+    mSampleRate = 44100.0;
+    mTailSeconds = 0.0;
+    
+    readParameters(mSnapshot);
+    applyParameters(mSnapshot);
+}
+
+PitchShifterAudioProcessor::~PitchShifterAudioProcessor()
+{
+    mParameters.removeParameterListener(ParamIDs::oversampling, this);
+    mParameters.removeParameterListener(ParamIDs::oversamplingFilter, this);
+    mParameters.removeParameterListener(ParamIDs::morphFrom, this);
+    mParameters.removeParameterListener(ParamIDs::morphTo, this);
+    cancelPendingUpdate();
+}
+
+//==============================================================================
+juce::String PitchShifterAudioProcessor::transpoParamId(int voice)
+{
+    return "transpo" + juce::String(voice + 1);
+}
+
+juce::String PitchShifterAudioProcessor::gainParamId(int voice)
+{
+    return "gain" + juce::String(voice + 1);
+}
+
+juce::AudioProcessorValueTreeState::ParameterLayout PitchShifterAudioProcessor::createParameterLayout()
+{
+    juce::AudioProcessorValueTreeState::ParameterLayout layout;
+    
+    layout.add(std::make_unique<juce::AudioParameterFloat>(ParamIDs::windowSize, "Window Size",
+                                                           juce::NormalisableRange<float>(5.0f, maxWindowMs, 0.1f), 50.0f));
+    layout.add(std::make_unique<juce::AudioParameterInt>(ParamIDs::numVoices, "Voices", 1, VoiceEngine::maxVoices, 2));
+    
+    juce::StringArray shapes;
+    for (int shape = 0; shape < GrainWindow::numShapes; shape++)
+        shapes.add(GrainWindow::getName((GrainWindow::Shape) shape));
+    
+    layout.add(std::make_unique<juce::AudioParameterChoice>(ParamIDs::windowShape, "Window Shape", shapes, GrainWindow::sine));
+    
+    // the phase vocoder trades latency (FFT size) and CPU (overlap) for quality on big shifts
+    layout.add(std::make_unique<juce::AudioParameterChoice>(ParamIDs::engine, "Engine",
+                                                            juce::StringArray { "Granular", "Phase Vocoder" }, granularEngine));
+    layout.add(std::make_unique<juce::AudioParameterChoice>(ParamIDs::fftSize, "FFT Size",
+                                                            juce::StringArray { "512", "1024", "2048", "4096" }, 2));
+    layout.add(std::make_unique<juce::AudioParameterChoice>(ParamIDs::fftOverlap, "FFT Overlap",
+                                                            juce::StringArray { "4x", "8x" }, 0));
+    
+    layout.add(std::make_unique<juce::AudioParameterFloat>(ParamIDs::mix, "Mix",
+                                                           juce::NormalisableRange<float>(0.0f, 100.0f, 0.1f), 100.0f));
+    
+    // caps the window and reads straight off the write head, for live monitoring
+    layout.add(std::make_unique<juce::AudioParameterBool>(ParamIDs::lowLatency, "Low Latency", false));
+    
+    juce::StringArray interpolations;
+    for (int type = 0; type < Interpolation::numTypes; type++)
+        interpolations.add(Interpolation::getName((Interpolation::Type) type));
+    
+    layout.add(std::make_unique<juce::AudioParameterChoice>(ParamIDs::interpolation, "Interpolation", interpolations, Interpolation::linear));
+    
+    // band-limits the faster-than-realtime reads of upward shifts; costs nothing at 1x
+    layout.add(std::make_unique<juce::AudioParameterChoice>(ParamIDs::oversampling, "Oversampling",
+                                                            juce::StringArray { "1x", "2x", "4x", "8x" }, 0));
+    layout.add(std::make_unique<juce::AudioParameterChoice>(ParamIDs::oversamplingFilter, "Oversampling Filter",
+                                                            juce::StringArray { "Polyphase IIR", "FIR Equiripple" }, 0));
+    
+    for (int voice = 0; voice < VoiceEngine::maxVoices; voice++)
+    {
+        auto voiceName = "Voice " + juce::String(voice + 1);
+        
+        layout.add(std::make_unique<juce::AudioParameterFloat>(transpoParamId(voice), voiceName + " Transposition",
+                                                               juce::NormalisableRange<float>(-12.0f, 12.0f, 0.1f), 0.0f));
+        layout.add(std::make_unique<juce::AudioParameterFloat>(gainParamId(voice), voiceName + " Gain",
+                                                               juce::NormalisableRange<float>(-60.0f, 6.0f, 0.1f), 0.0f));
+    }
+    
+    // added after the voices so existing parameter indices stay put for hosts that save by index.
+    // Program 0 is the live parameters, so the defaults morph from nothing to nothing
+    layout.add(std::make_unique<juce::AudioParameterFloat>(ParamIDs::morph, "Morph",
+                                                           juce::NormalisableRange<float>(0.0f, 100.0f, 0.1f), 0.0f));
+    layout.add(std::make_unique<juce::AudioParameterInt>(ParamIDs::morphFrom, "Morph From", 0, PresetBank::maxPresets, 0));
+    layout.add(std::make_unique<juce::AudioParameterInt>(ParamIDs::morphTo, "Morph To", 0, PresetBank::maxPresets, 0));
+    layout.add(std::make_unique<juce::AudioParameterFloat>(ParamIDs::outputGain, "Output Gain",
+                                                           juce::NormalisableRange<float>(-24.0f, 12.0f, 0.1f), 0.0f));
+    
+    return layout;
+}
+
+void PitchShifterAudioProcessor::setParameterValue(const juce::String& paramId, float value)
+{
+    if (auto* param = mParameters.getParameter(paramId))
+        param->setValueNotifyingHost(param->convertTo0to1(value));
+}
+
+void PitchShifterAudioProcessor::addFactoryPresets()
+{
+    struct FactoryPreset
+    {
+        const char* name;
+        float transpoOne;
+        float transpoTwo;
+    };
+    
+    // in presetType order; only the first two transpositions are part of them
+    const FactoryPreset presets[] = {
+        { "Perfect Fifth", 0.0f, 7.5f },
+        { "Weird", -12.0f, 12.0f },
+        { "Scary", 0.0f, -6.5f }
+    };
+    
+    for (const auto& preset : presets)
+    {
+        auto* values = mPresetBank.addFactoryPreset(preset.name);
+        values[findStateParam(transpoParamId(0).hashCode())] = preset.transpoOne;
+        values[findStateParam(transpoParamId(1).hashCode())] = preset.transpoTwo;
+    }
+}
+
+void PitchShifterAudioProcessor::applyPreset(int preset)
+{
+    const int index = preset - 1;
+    
+    if (! juce::isPositiveAndBelow(index, mPresetBank.getNumPresets()))
+        return;
+    
+    std::vector<float> values(mStateParams.size());
+    mPresetBank.copyValues(index, values.data());
+    setParameterValues(values.data());
+    mCurrentPreset = index;
+}
+
+int PitchShifterAudioProcessor::storeUserPreset(const juce::String& name)
+{
+    std::vector<float> values(mStateParams.size());
+    getParameterValues(values.data());
+    keepPresetValues(values.data());
+    
+    const int index = mPresetBank.storeUserPreset(name, values.data());
+    
+    if (index >= 0)
+    {
+        mCurrentPreset = index;
+        updateMorphTable();
+        updateHostDisplay();
+    }
+    
+    return index;
+}
+
+int PitchShifterAudioProcessor::findStateParam(int idHash) const noexcept
+{
+    auto found = std::lower_bound(mStateParamsByHash.begin(), mStateParamsByHash.end(), std::make_pair(idHash, 0));
+    
+    if (found == mStateParamsByHash.end() || found->first != idHash)
+        return -1;
+    
+    return found->second;
+}
+
+void PitchShifterAudioProcessor::getParameterValues(float* values) const noexcept
+{
+    for (size_t i = 0; i < mStateParams.size(); i++)
+        values[i] = mStateParams[i]->convertFrom0to1(mStateParams[i]->getValue());
+}
+
+void PitchShifterAudioProcessor::keepPresetValues(float* values) const noexcept
+{
+    for (size_t i = 0; i < mStateParams.size(); i++)
+        if (! mPresetParams[i])
+            values[i] = std::numeric_limits<float>::quiet_NaN();
+}
+
+void PitchShifterAudioProcessor::setParameterValues(const float* values) noexcept
+{
+    // NaN marks a parameter the preset leaves alone; unchanged ones aren't sent to the host
+    for (size_t i = 0; i < mStateParams.size(); i++)
+    {
+        if (std::isnan(values[i]))
+            continue;
+        
+        auto* param = mStateParams[i];
+        const float normalised = param->convertTo0to1(values[i]);
+        
+        if (normalised != param->getValue())
+            param->setValueNotifyingHost(normalised);
+    }
+}
+
+void PitchShifterAudioProcessor::readParameters(ParameterSnapshot& snapshot) const noexcept
+{
+    snapshot.windowSizeMs = mWindowSizeParam->load();
+    snapshot.numVoices = (int) mNumVoicesParam->load();
+    snapshot.windowShape = (int) mWindowShapeParam->load();
+    snapshot.engine = (int) mEngineParam->load();
+    snapshot.fftOrder = PhaseVocoder::minOrder + (int) mFftSizeParam->load();
+    snapshot.fftOverlap = 4 << (int) mFftOverlapParam->load();
+    snapshot.mixPercent = mMixParam->load();
+    snapshot.outputGainDb = mOutputGainParam->load();
+    snapshot.lowLatency = mLowLatencyParam->load() >= 0.5f;
+    snapshot.interpolation = (int) mInterpolationParam->load();
+    
+    for (int voice = 0; voice < VoiceEngine::maxVoices; voice++)
+    {
+        snapshot.transpo[voice] = mTranspoParams[voice]->load();
+        snapshot.gainDb[voice] = mGainParams[voice]->load();
+    }
+    
+    applyMorph(snapshot);
+}
+
+void PitchShifterAudioProcessor::updateMorphTable()
+{
+    const int from = (int) mMorphFromParam->load();
+    const int to = (int) mMorphToParam->load();
+    
+    std::vector<float> values(mStateParams.size());
+    
+    // one end at a time; a block that reads between the two stores sees a blend that
+    // the next block corrects, which is as far as a torn update can go
+    auto fill = [this, &values] (int program, std::atomic<float>* dest)
+    {
+        if (program > 0)
+            mPresetBank.copyValues(program - 1, values.data());
+        else
+            std::fill(values.begin(), values.end(), std::numeric_limits<float>::quiet_NaN());
+        
+        for (int i = 0; i < numMorphValues; i++)
+            dest[i] = values[(size_t) mMorphValueParams[i]];
+    };
+    
+    fill(from, mMorphTable.from);
+    fill(to, mMorphTable.to);
+    mMorphTable.active = from > 0 || to > 0;
+}
+
+void PitchShifterAudioProcessor::applyMorph(ParameterSnapshot& snapshot) const noexcept
+{
+    if (! mMorphTable.active.load())
+        return;
+    
+    const float amount = mMorphParam->load() / 100.0f;
+    
+    // NaN means the program doesn't set that value, so the live parameter stands in
+    auto pick = [] (const std::atomic<float>& value, float live) noexcept
+    {
+        const float v = value.load();
+        return std::isnan(v) ? live : v;
+    };
+    
+    auto blend = [amount] (float from, float to) noexcept { return from + (to - from) * amount; };
+    
+    const float fromVoices = pick(mMorphTable.from[morphNumVoices], (float) snapshot.numVoices);
+    const float toVoices = pick(mMorphTable.to[morphNumVoices], (float) snapshot.numVoices);
+    
+    snapshot.windowSizeMs = blend(pick(mMorphTable.from[morphWindowSize], snapshot.windowSizeMs),
+                                  pick(mMorphTable.to[morphWindowSize], snapshot.windowSizeMs));
+    
+    // in between, every voice either end uses is running; a voice one end doesn't
+    // have sits at -60 dB there, so it fades in and out rather than popping
+    if (amount <= 0.0f)
+        snapshot.numVoices = juce::roundToInt(fromVoices);
+    else if (amount >= 1.0f)
+        snapshot.numVoices = juce::roundToInt(toVoices);
+    else
+        snapshot.numVoices = juce::roundToInt(juce::jmax(fromVoices, toVoices));
+    
+    for (int voice = 0; voice < VoiceEngine::maxVoices; voice++)
+    {
+        const float liveGain = snapshot.gainDb[voice];
+        const float fromGain = voice < juce::roundToInt(fromVoices) ? pick(mMorphTable.from[morphGain + voice], liveGain) : -60.0f;
+        const float toGain = voice < juce::roundToInt(toVoices) ? pick(mMorphTable.to[morphGain + voice], liveGain) : -60.0f;
+        
+        snapshot.transpo[voice] = blend(pick(mMorphTable.from[morphTranspo + voice], snapshot.transpo[voice]),
+                                        pick(mMorphTable.to[morphTranspo + voice], snapshot.transpo[voice]));
+        snapshot.gainDb[voice] = blend(fromGain, toGain);
+    }
+}
+
+void PitchShifterAudioProcessor::applyParameters(const ParameterSnapshot& snapshot) noexcept
+{
+    mPhaseVocoder.setFrameSize(snapshot.fftOrder, snapshot.fftOverlap);
+    
+    // the core only moves its targets here; the per-sample ramps happen as each run is planned
+    mCore.setNumVoices(snapshot.numVoices);
+    mCore.setInterpolation((Interpolation::Type) snapshot.interpolation);
+    mCore.setLowLatency(snapshot.lowLatency);
+    mCore.setWindowSize(snapshot.windowSizeMs);
+    mCore.setWindowShape((GrainWindow::Shape) snapshot.windowShape);
+    
+    for (int voice = 0; voice < VoiceEngine::maxVoices; voice++)
+    {
+        mCore.setTranspo(voice, mMidiNoteActive ? mMidiTranspo : snapshot.transpo[voice]);
+        mCore.setGain(voice, juce::Decibels::decibelsToGain(snapshot.gainDb[voice], -60.0f));
+    }
+    
+    mCore.setMix(snapshot.mixPercent / 100.0f);
+    mCore.setOutputGain(juce::Decibels::decibelsToGain(snapshot.outputGainDb));
+    
+    updateLatency(snapshot.engine);
+}
+
+void PitchShifterAudioProcessor::updateLatency(int engine) noexcept
+{
+    int latency;
+    double tailSamples;
+    
+    if (engine == phaseVocoderEngine)
+    {
+        // a frame comes out one frame late and then takes a frame to fade out
+        latency = mPhaseVocoder.getLatencySamples();
+        tailSamples = 2.0 * latency;
+    }
+    else
+    {
+        // the grain engine's delays are counted at the oversampled rate
+        const double filterLatency = getOversamplingLatency();
+        latency = juce::roundToInt(mCore.getLatencySamples() / mOversamplingFactor + filterLatency);
+        tailSamples = mCore.getTailSamples() / mOversamplingFactor + filterLatency;
+    }
+    
+    mTailSeconds = tailSamples / mSampleRate;
+    mDrainSamples = (int) std::ceil(tailSamples) + 1;
+    
+    // setLatencySamples only notifies the host when the value actually changes
+    if (latency != getLatencySamples())
+        setLatencySamples(latency);
+}
+
+double PitchShifterAudioProcessor::getOversamplingLatency() const noexcept
+{
+    if (mDoublePrecision)
+        return mDoubleState.oversampling != nullptr ? (double) mDoubleState.oversampling->getLatencyInSamples() : 0.0;
+    
+    return mFloatState.oversampling != nullptr ? (double) mFloatState.oversampling->getLatencyInSamples() : 0.0;
+}
+
+const juce::String PitchShifterAudioProcessor::getName() const
+{
+    return JucePlugin_Name;
+}
+
+bool PitchShifterAudioProcessor::acceptsMidi() const
+{
+   #if JucePlugin_WantsMidiInput
+    return true;
+   #else
+    return false;
+   #endif
+}
+
+bool PitchShifterAudioProcessor::producesMidi() const
+{
+   #if JucePlugin_ProducesMidiOutput
+    return true;
+   #else
+    return false;
+   #endif
+}
+
+bool PitchShifterAudioProcessor::isMidiEffect() const
+{
+   #if JucePlugin_IsMidiEffect
+    return true;
+   #else
+    return false;
+   #endif
+}
+
+double PitchShifterAudioProcessor::getTailLengthSeconds() const
+{
+    return mTailSeconds.load();
+}
+
+int PitchShifterAudioProcessor::getNumPrograms()
+{
+    // the factory presets alone keep this above 0, which some hosts need
+    return mPresetBank.getNumPresets();
+}
+
+int PitchShifterAudioProcessor::getCurrentProgram()
+{
+    return mCurrentPreset.load();
+}
+
+void PitchShifterAudioProcessor::setCurrentProgram (int index)
+{
+    if (! juce::isPositiveAndBelow(index, mPresetBank.getNumPresets()))
+        return;
+    
+    // picked up by the next processBlock, or by prepareToPlay if nothing is running yet
+    mCurrentPreset = index;
+    mPendingPreset = index;
+}
+
+const juce::String PitchShifterAudioProcessor::getProgramName (int index)
+{
+    return mPresetBank.getName(index);
+}
+
+void PitchShifterAudioProcessor::changeProgramName (int index, const juce::String& newName)
+{
+    mPresetBank.setName(index, newName);
+}
+
+//==============================================================================
+void PitchShifterAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
+{
+    mNumInputChannels = getTotalNumInputChannels();
+    mBlockSize = samplesPerBlock;
+    mSampleRate = sampleRate;
+    
+    mPreparedOversampling = (int) mOversamplingParam->load();
+    mPreparedOversamplingFilter = (int) mOversamplingFilterParam->load();
+    mOversamplingFactor = 1 << mPreparedOversampling;
+    
+    const double engineRate = mSampleRate * mOversamplingFactor;
+    const int engineBlockSize = samplesPerBlock * mOversamplingFactor;
+    
+    // the host picks the precision before preparing, so only that state holds any memory
+    mDoublePrecision = isUsingDoublePrecision();
+    
+    if (mDoublePrecision)
+    {
+        prepareRenderState(mDoubleState, samplesPerBlock);
+        mFloatState.oversampling.reset();
+    }
+    else
+    {
+        prepareRenderState(mFloatState, samplesPerBlock);
+        mDoubleState.oversampling.reset();
+    }
+    
+    // wide layouts get helper threads so channels render in parallel;
+    // mono and stereo stay on the audio thread where the hand-off would cost more than it saves
+    int numWorkers = 0;
+    
+    if (mChannelThreadsEnabled && mNumInputChannels >= channelThreadThreshold)
+        numWorkers = juce::jmin(mNumInputChannels - 1, juce::SystemStats::getNumCpus() - 1);
+    
+    mWorkerPool.start(juce::jmax(0, numWorkers), engineBlockSize, engineRate, mAudioWorkgroup);
+    
+    // the vocoder's dry path reads the same history, so it has to reach back a whole frame
+    mCore.prepare(mNumInputChannels, engineBlockSize, engineRate, mWorkerPool.getNumLanes(), mDoublePrecision,
+                  maxWindowMs, 1 << PhaseVocoder::maxOrder);
+    mPhaseVocoder.prepare(mNumInputChannels, mSampleRate);
+    mTelemetry.prepare(mSampleRate);
+    mVisualiserFeed.prepare(mSampleRate);
+    
+    // a program chosen while stopped is simply applied; there's nothing to fade yet
+    const int pendingPreset = mPendingPreset.exchange(-1);
+    
+    if (pendingPreset >= 0)
+    {
+        mPresetBank.copyValues(pendingPreset, mPresetValues.data());
+        setParameterValues(mPresetValues.data());
+    }
+    
+    mPresetFade = 1.0f;
+    mPresetFadeStart = 1.0f;
+    
+    readParameters(mSnapshot);
+    applyParameters(mSnapshot);
+    mCore.reset();
+    mSilentSamples = 0;
+    mRenderedEngine = (int) mEngineParam->load();
+    mPrepared = true;
+}
+
+template <typename SampleType>
+void PitchShifterAudioProcessor::prepareRenderState(RenderState<SampleType>& state, int samplesPerBlock)
+{
+    // the oversampler is only built when it's asked for, so 1x costs nothing
+    if (mPreparedOversampling > 0)
+    {
+        using Oversampling = juce::dsp::Oversampling<SampleType>;
+        
+        const auto filterType = mPreparedOversamplingFilter == 0 ? Oversampling::filterHalfBandPolyphaseIIR
+                                                                 : Oversampling::filterHalfBandFIREquiripple;
+        
+        state.oversampling = std::make_unique<Oversampling>((size_t) mNumInputChannels, (size_t) mPreparedOversampling,
+                                                            filterType, true, true);
+        state.oversampling->initProcessing((size_t) samplesPerBlock);
+    }
+    else
+    {
+        state.oversampling.reset();
+    }
+}
+
+void PitchShifterAudioProcessor::releaseResources()
+{
+    mPrepared = false;
+    mWorkerPool.stop();
+    mCore.release();
+    mFloatState.oversampling.reset();
+    mDoubleState.oversampling.reset();
+}
+
+void PitchShifterAudioProcessor::audioWorkgroupContextChanged(const juce::AudioWorkgroup& workgroup)
+{
+    // hosts report this before preparing, so the helper threads join it when prepareToPlay starts them
+    mAudioWorkgroup = workgroup;
+}
+
+void PitchShifterAudioProcessor::parameterChanged(const juce::String& parameterID, float newValue)
+{
+    // may arrive on the audio thread, so the rebuild is handed to the message thread
+    juce::ignoreUnused(parameterID, newValue);
+    triggerAsyncUpdate();
+}
+
+void PitchShifterAudioProcessor::handleAsyncUpdate()
+{
+    updateMorphTable();
+    
+    // a released plugin picks the settings up when it's next prepared
+    if (! mPrepared)
+        return;
+    
+    if ((int) mOversamplingParam->load() == mPreparedOversampling
+        && (int) mOversamplingFilterParam->load() == mPreparedOversamplingFilter)
+        return;
+    
+    // suspendProcessing waits for any processBlock in flight, then outputs silence until resumed
+    suspendProcessing(true);
+    prepareToPlay(getSampleRate(), getBlockSize());
+    suspendProcessing(false);
+}
+
+void PitchShifterAudioProcessor::setChannelThreadsEnabled(bool enabled)
+{
+    // takes effect at the next prepareToPlay
+    mChannelThreadsEnabled = enabled;
+}
+
+#ifndef JucePlugin_PreferredChannelConfigurations
+bool PitchShifterAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts) const
+{
+  #if JucePlugin_IsMidiEffect
+    juce::ignoreUnused (layouts);
+    return true;
+  #else
+    // Every channel is shifted independently, so any layout works: mono,
+    // stereo, 5.1, 7.1.4, higher-order ambisonics and so on, up to maxChannels.
+    // Some plugin hosts, such as certain GarageBand versions, will only
+    // load plugins that support stereo bus layouts, so stereo stays the default.
+    const auto& outputSet = layouts.getMainOutputChannelSet();
+    
+    if (outputSet.isDisabled() || outputSet.size() > maxChannels)
+        return false;
+
+    // This checks if the input layout matches the output layout
+   #if ! JucePlugin_IsSynth
+    if (layouts.getMainOutputChannelSet() != layouts.getMainInputChannelSet())
+        return false;
+   #endif
+
+    return true;
+  #endif
+}
+#endif
+
+bool PitchShifterAudioProcessor::supportsDoublePrecisionProcessing() const
+{
+    return true;
+}
+
+void PitchShifterAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
+{
+    processSamples(buffer, midiMessages);
+}
+
+void PitchShifterAudioProcessor::processBlock (juce::AudioBuffer<double>& buffer, juce::MidiBuffer& midiMessages)
+{
+    processSamples(buffer, midiMessages);
+}
+
+template <typename SampleType>
+void PitchShifterAudioProcessor::processSamples (juce::AudioBuffer<SampleType>& buffer, juce::MidiBuffer& midiMessages) noexcept
+{
+    juce::ScopedNoDenormals noDenormals;
+    auto totalNumInputChannels  = getTotalNumInputChannels();
+    auto totalNumOutputChannels = getTotalNumOutputChannels();
+    auto bufSize = buffer.getNumSamples();
+    
+    const DspTelemetry::ScopedBlock telemetryBlock(mTelemetry, bufSize);
+
+    // In case we have more outputs than inputs, this code clears any output
+    // channels that didn't contain input data, (because these aren't
+    // guaranteed to be empty - they may contain garbage).
+    // This is here to avoid people getting screaming feedback
+    // when they first compile a plugin, but obviously you don't need to keep
+    // this code if your algorithm always overwrites all the output channels.
+    for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
+        buffer.clear (i, 0, buffer.getNumSamples());
+    
+    updatePresetFade(bufSize);
+    
+    // once the input has been silent for longer than anything can ring on,
+    // the output is silent too and none of the engine needs to run. The silence
+    // before this block is what counts: this block's own samples still make a tail
+    const bool wasDrained = mSilentSamples >= mDrainSamples;
+    mSilentSamples = isInputSilent(buffer) ? juce::jmin(mSilentSamples + bufSize, std::numeric_limits<int>::max() / 2) : 0;
+    
+    if (wasDrained && mSilentSamples > 0)
+    {
+        for (int channel = 0; channel < mNumInputChannels; ++channel)
+            buffer.clear(channel, 0, bufSize);
+        
+        skipSilentBlock(bufSize, midiMessages);
+        feedVisualiser(buffer);
+        return;
+    }
+    
+    // nothing was written while idle, so the taps would read back audio from before the silence
+    if (mProcessingState == processingIdle)
+    {
+        mCore.clearHistory();
+        mPhaseVocoder.reset();
+    }
+    
+    auto& state = getRenderState<SampleType>();
+    juce::dsp::AudioBlock<SampleType> block(buffer.getArrayOfWritePointers(), (size_t) mNumInputChannels, (size_t) bufSize);
+    
+    // read once, so the whole block is rendered by the engine its history was written for
+    const int engine = (int) mEngineParam->load();
+    
+    if (engine != mRenderedEngine)
+        switchEngine(state, engine);
+    
+    // the phase vocoder has its own band-limiting, so only the grain engine is oversampled
+    if (state.oversampling != nullptr && engine == granularEngine)
+    {
+        juce::dsp::AudioBlock<SampleType> upBlock;
+        
+        {
+            const DspTelemetry::ScopedStage stage(mTelemetry, DspTelemetry::resamplingStage);
+            upBlock = state.oversampling->processSamplesUp(block);
+        }
+        
+        for (int channel = 0; channel < mNumInputChannels; ++channel)
+            state.channels[(size_t) channel] = upBlock.getChannelPointer((size_t) channel);
+        
+        processEngine(state, (int) upBlock.getNumSamples(), midiMessages, mOversamplingFactor);
+        
+        const DspTelemetry::ScopedStage stage(mTelemetry, DspTelemetry::resamplingStage);
+        state.oversampling->processSamplesDown(block);
+    }
+    else
+    {
+        for (int channel = 0; channel < mNumInputChannels; ++channel)
+            state.channels[(size_t) channel] = buffer.getWritePointer(channel);
+        
+        processEngine(state, bufSize, midiMessages, 1);
+    }
+    
+    feedVisualiser(buffer);
+}
+
+template <typename SampleType>
+void PitchShifterAudioProcessor::feedVisualiser(const juce::AudioBuffer<SampleType>& buffer) noexcept
+{
+    if (! mVisualiserFeed.isActive())
+        return;
+    
+    mVisualiserFeed.pushAudio(buffer.getReadPointer(0), buffer.getNumSamples());
+    
+    if (! mVisualiserFeed.isSnapshotDue(buffer.getNumSamples()))
+        return;
+    
+    // channel 0 stands for all of them; every channel's phasors move together
+    VisualiserFeed::Snapshot snapshot;
+    snapshot.granular = mSnapshot.engine == granularEngine;
+    const auto& voices = mCore.getVoiceEngine();
+    snapshot.numVoices = voices.getNumVoices();
+    snapshot.windowShape = mSnapshot.windowShape;
+    snapshot.windowMs = voices.getWindowSizeMs();
+    
+    for (int voice = 0; voice < snapshot.numVoices; voice++)
+    {
+        snapshot.phase[voice] = (float) voices.getPhase(0, voice);
+        snapshot.gain[voice] = voices.getGain(voice);
+    }
+    
+    mVisualiserFeed.pushSnapshot(snapshot);
+}
+
+void PitchShifterAudioProcessor::updatePresetFade(int numSamples) noexcept
+{
+    mPresetFadeStart = mPresetFade;
+    int pending = mPendingPreset.load();
+    
+    // swap once the wet signal has faded out, or at once if nothing is sounding
+    if (pending >= 0 && (mPresetFade <= 0.0f || mSilentSamples >= mDrainSamples))
+    {
+        // the bank is being edited: stay silent and try again next block
+        if (! mPresetBank.tryCopyValues(pending, mPresetValues.data()))
+            return;
+        
+        setParameterValues(mPresetValues.data());
+        mCurrentPreset = pending;
+        mPendingPreset.compare_exchange_strong(pending, -1);
+        
+        // land straight on the new settings rather than gliding to them under the fade-in
+        readParameters(mSnapshot);
+        applyParameters(mSnapshot);
+        mCore.reset();
+        
+        mPresetFade = 0.0f;
+        mPresetFadeStart = 0.0f;
+        pending = mPendingPreset.load();
+    }
+    
+    const auto step = (float) (numSamples / (presetFadeSeconds * mSampleRate));
+    mPresetFade = pending >= 0 ? juce::jmax(0.0f, mPresetFade - step) : juce::jmin(1.0f, mPresetFade + step);
+}
+
+template <typename SampleType>
+bool PitchShifterAudioProcessor::isInputSilent(const juce::AudioBuffer<SampleType>& buffer) const noexcept
+{
+    const auto threshold = (SampleType) juce::Decibels::decibelsToGain(silenceThresholdDb);
+    
+    for (int channel = 0; channel < mNumInputChannels; ++channel)
+        if (buffer.getMagnitude(channel, 0, buffer.getNumSamples()) > threshold)
+            return false;
+    
+    return true;
+}
+
+void PitchShifterAudioProcessor::skipSilentBlock(int numSamples, juce::MidiBuffer& midiMessages) noexcept
+{
+    // the history isn't written either; it's cleared when processing resumes.
+    // Notes and parameters are still followed, so latency and MIDI state stay current
+    {
+        const DspTelemetry::ScopedStage stage(mTelemetry, DspTelemetry::midiStage);
+        
+        for (const auto metadata : midiMessages)
+            handleMidiEvent(metadata.getMessage());
+    }
+    
+    readParameters(mSnapshot);
+    applyParameters(mSnapshot);
+    mCore.advanceLevels(numSamples * mOversamplingFactor);
+    
+    setProcessingState(processingIdle);
+}
+
+void PitchShifterAudioProcessor::setProcessingState(int state) noexcept
+{
+    mProcessingState = state;
+    mTelemetry.setProcessingState(state);
+}
+
+template <typename SampleType>
+void PitchShifterAudioProcessor::processEngine(RenderState<SampleType>& state, int numSamples, juce::MidiBuffer& midiMessages, int midiScale) noexcept
+{
+    {
+        const DspTelemetry::ScopedStage stage(mTelemetry, DspTelemetry::historyStage);
+        mCore.writeHistory(state.channels.data(), numSamples);
+    }
+    
+    if (mRenderedEngine == phaseVocoderEngine)
+    {
+        processPhaseVocoder(state, numSamples, midiMessages);
+        setProcessingState(processingFull);
+        
+        const DspTelemetry::ScopedStage stage(mTelemetry, DspTelemetry::outputStage);
+        mixDry(state, numSamples, mPhaseVocoder.getLatencySamples());
+        return;
+    }
+    
+    renderGranular(numSamples, midiMessages, midiScale);
+    setProcessingState(mCore.getVoiceEngine().isStatic() ? processingPureDelay : processingFull);
+}
+
+template <typename SampleType>
+void PitchShifterAudioProcessor::switchEngine(RenderState<SampleType>& state, int engine) noexcept
+{
+    // with oversampling the grain engine writes the history at the oversampled rate and
+    // the vocoder at the host rate, so neither can read what the other left behind
+    if (mOversamplingFactor > 1)
+    {
+        mCore.clearHistory();
+        
+        if (state.oversampling != nullptr)
+            state.oversampling->reset();
+    }
+    
+    // the vocoder's frames stopped being fed when it was switched away from
+    if (engine == phaseVocoderEngine)
+        mPhaseVocoder.reset();
+    
+    mRenderedEngine = engine;
+}
+
+void PitchShifterAudioProcessor::renderGranular(int numSamples, juce::MidiBuffer& midiMessages, int midiScale) noexcept
+{
+    const DspTelemetry::ScopedStage stage(mTelemetry, DspTelemetry::kernelStage);
+    
+    // no clearing: the sub-blocks cover the whole block and the first voice overwrites
+    mBlockLength = numSamples;
+    
+    // split the block at every MIDI event so note changes land on their exact
+    // sample, and at least every ShifterCore::runLength samples so automation
+    // timing doesn't depend on the host buffer size
+    int subBlockStart = 0;
+    
+    for (const auto metadata : midiMessages)
+    {
+        const int eventPos = juce::jlimit(0, numSamples, metadata.samplePosition * midiScale);
+        
+        renderSubBlocks(subBlockStart, eventPos);
+        subBlockStart = juce::jmax(subBlockStart, eventPos);
+        
+        const DspTelemetry::ScopedStage midiStage(mTelemetry, DspTelemetry::midiStage);
+        handleMidiEvent(metadata.getMessage());
+    }
+    
+    renderSubBlocks(subBlockStart, numSamples);
+    renderSegments();
+}
+
+template <typename SampleType>
+void PitchShifterAudioProcessor::mixDry(RenderState<SampleType>& state, int numSamples, double dryDelay) noexcept
+{
+    // the core's levels ramp at the engine rate, which the vocoder doesn't run at
+    const auto levels = mCore.advanceLevels(numSamples * mOversamplingFactor);
+    const auto startWet = (SampleType) levels.wetStart;
+    const auto wetStep = ((SampleType) levels.wetEnd - startWet) / (SampleType) numSamples;
+    
+    // the preset crossfade only ever touches the wet signal
+    const auto startFade = (SampleType) mPresetFadeStart;
+    const auto fadeStep = ((SampleType) mPresetFade - startFade) / (SampleType) numSamples;
+    
+    if (levels.dryStart == 0.0f && levels.dryEnd == 0.0f)
+    {
+        for (int channel = 0; channel < mNumInputChannels; ++channel)
+        {
+            auto* data = state.channels[(size_t) channel];
+            
+            if (startFade == 1 && fadeStep == 0 && wetStep == 0)
+            {
+                juce::FloatVectorOperations::multiply(data, startWet, numSamples);
+                continue;
+            }
+            
+            for (int i = 0; i < numSamples; i++)
+                data[i] *= (startFade + fadeStep * (SampleType) i) * (startWet + wetStep * (SampleType) i);
+        }
+        
+        return;
+    }
+    
+    // the history was written before rendering, so delay 0 is this block's input;
+    // dryDelay is the engine's own latency, so the dry signal lines up before any resampling
+    const auto& history = mCore.getHistory<SampleType>();
+    const auto startDry = (SampleType) levels.dryStart;
+    const auto dryStep = ((SampleType) levels.dryEnd - startDry) / (SampleType) numSamples;
+    
+    // while the vocoder crossfades frame sizes, the dry signal crossfades between their latencies
+    const bool crossfading = mPhaseVocoder.isCrossfading();
+    const double fadingDelay = mPhaseVocoder.getFadingLatencySamples();
+    
+    for (int channel = 0; channel < mNumInputChannels; ++channel)
+    {
+        auto* data = state.channels[(size_t) channel];
+        
+        for (int i = 0; i < numSamples; i++)
+        {
+            auto drySample = history.readInterpSample(channel, i, dryDelay);
+            
+            if (crossfading)
+                drySample = drySample * (SampleType) mPhaseVocoder.getFadeGain(i, false)
+                          + history.readInterpSample(channel, i, fadingDelay) * (SampleType) mPhaseVocoder.getFadeGain(i, true);
+            
+            const auto wet = (startWet + wetStep * (SampleType) i) * (startFade + fadeStep * (SampleType) i);
+            const auto dry = (startDry + dryStep * (SampleType) i) * drySample;
+            data[i] = data[i] * wet + dry;
+        }
+    }
+}
+
+template <typename SampleType>
+void PitchShifterAudioProcessor::processPhaseVocoder(RenderState<SampleType>& state, int numSamples, juce::MidiBuffer& midiMessages) noexcept
+{
+    const DspTelemetry::ScopedStage stage(mTelemetry, DspTelemetry::kernelStage);
+    
+    // the vocoder only changes pitch once per hop, so events are simply applied up front
+    {
+        const DspTelemetry::ScopedStage midiStage(mTelemetry, DspTelemetry::midiStage);
+        
+        for (const auto metadata : midiMessages)
+            handleMidiEvent(metadata.getMessage());
+    }
+    
+    readParameters(mSnapshot);
+    applyParameters(mSnapshot);
+    
+    float transpo[VoiceEngine::maxVoices];
+    float gains[VoiceEngine::maxVoices];
+    
+    for (int voice = 0; voice < VoiceEngine::maxVoices; voice++)
+    {
+        transpo[voice] = mMidiNoteActive ? (float) mMidiTranspo : mSnapshot.transpo[voice];
+        gains[voice] = juce::Decibels::decibelsToGain(mSnapshot.gainDb[voice], -60.0f);
+    }
+    
+    mPhaseVocoder.setVoices(mSnapshot.numVoices, transpo, gains);
+    
+    for (int channel = 0; channel < mNumInputChannels; ++channel)
+        mPhaseVocoder.process(channel, state.channels[(size_t) channel], numSamples);
+}
+
+void PitchShifterAudioProcessor::handleMidiEvent(const juce::MidiMessage& message) noexcept
+{
+    if (message.isNoteOn())
+    {
+        mMidiNoteActive = true;
+        mMidiNote = message.getNoteNumber();
+        mMidiTranspo = mMidiNote - 60.0f;
+    }
+    else if (message.isNoteOff() && message.getNoteNumber() == mMidiNote)
+    {
+        // releasing the held note hands transposition back to the parameters
+        mMidiNoteActive = false;
+    }
+    else if (message.isAllNotesOff())
+    {
+        mMidiNoteActive = false;
+    }
+}
+
+void PitchShifterAudioProcessor::renderSubBlocks(int startSample, int endSample) noexcept
+{
+    while (startSample < endSample)
+    {
+        const int numSamples = juce::jmin(ShifterCore::runLength, endSample - startSample);
+        
+        if (mCore.isFull())
+            renderSegments();
+        
+        readParameters(mSnapshot);
+        applyParameters(mSnapshot);
+        
+        // the core ramps the mix and output gain across the run itself;
+        // the preset fade runs along its own straight line over the whole block
+        const float fadeStep = (mPresetFade - mPresetFadeStart) / (float) juce::jmax(1, mBlockLength);
+        const float startFade = mPresetFadeStart + fadeStep * (float) startSample;
+        const float endFade = mPresetFadeStart + fadeStep * (float) (startSample + numSamples);
+        
+        mCore.addRun(startSample, numSamples, startFade, endFade);
+        startSample += numSamples;
+    }
+}
+
+void PitchShifterAudioProcessor::renderSegments() noexcept
+{
+    if (mCore.getNumRuns() == 0)
+        return;
+    
+    if (mWorkerPool.getNumLanes() > 1)
+    {
+        mWorkerPool.run(*this, mNumInputChannels);
+    }
+    else
+    {
+        for (int channel = 0; channel < mNumInputChannels; ++channel)
+            runJob(channel, 0);
+    }
+    
+    mCore.clearRuns();
+}
+
+void PitchShifterAudioProcessor::runJob(int channel, int lane) noexcept
+{
+    // the precision is fixed per block, so this is the only place it's branched on
+    if (mDoublePrecision)
+        mCore.renderChannel(channel, lane, mDoubleState.channels[(size_t) channel]);
+    else
+        mCore.renderChannel(channel, lane, mFloatState.channels[(size_t) channel]);
+}
+
+//==============================================================================
+bool PitchShifterAudioProcessor::hasEditor() const
+{
+    return true; // (change this to false if you choose to not supply an editor)
+}
+
+juce::AudioProcessorEditor* PitchShifterAudioProcessor::createEditor()
+{
+    return new PitchShifterAudioProcessorEditor (*this);
+}
+
+//==============================================================================
+void PitchShifterAudioProcessor::getStateInformation (juce::MemoryBlock& destData)
+{
+    juce::MemoryOutputStream stream(destData, false);
+    stream.writeInt(stateMagic);
+    stream.writeInt(stateVersion);
+    
+    std::vector<float> values(mStateParams.size());
+    getParameterValues(values.data());
+    writeValues(stream, values.data());
+    
+    stream.writeInt(mCurrentPreset.load());
+    
+    const int numFactory = mPresetBank.getNumFactoryPresets();
+    const int numPresets = mPresetBank.getNumPresets();
+    stream.writeInt(numPresets - numFactory);
+    
+    for (int index = numFactory; index < numPresets; index++)
+    {
+        mPresetBank.copyValues(index, values.data());
+        stream.writeString(mPresetBank.getName(index));
+        writeValues(stream, values.data());
+    }
+}
+
+void PitchShifterAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
+{
+    juce::MemoryInputStream stream(data, (size_t) juce::jmax(0, sizeInBytes), false);
+    
+    if (sizeInBytes < 8 || stream.readInt() != stateMagic)
+        return;
+    
+    // every version so far only appends, so a newer state is read as far as this one understands it
+    const int version = stream.readInt();
+    juce::ignoreUnused(version);
+    
+    std::vector<float> values(mStateParams.size(), std::numeric_limits<float>::quiet_NaN());
+    
+    if (! readValues(stream, values.data()))
+        return;
+    
+    // anything the session doesn't mention goes back to its default, so a load
+    // ends in the same place whatever was set before
+    for (size_t i = 0; i < mStateParams.size(); i++)
+        if (std::isnan(values[i]))
+            values[i] = mStateParams[i]->convertFrom0to1(mStateParams[i]->getDefaultValue());
+    
+    mPendingPreset = -1;
+    setParameterValues(values.data());
+    
+    const int currentPreset = stream.readInt();
+    const int numUserPresets = stream.readInt();
+    
+    mPresetBank.clearUserPresets();
+    
+    for (int preset = 0; preset < numUserPresets && ! stream.isExhausted(); preset++)
+    {
+        const auto name = stream.readString();
+        std::fill(values.begin(), values.end(), std::numeric_limits<float>::quiet_NaN());
+        
+        if (! readValues(stream, values.data()))
+            break;
+        
+        // older sessions stored every parameter in a preset
+        keepPresetValues(values.data());
+        mPresetBank.storeUserPreset(name, values.data());
+    }
+    
+    mCurrentPreset = juce::jlimit(0, mPresetBank.getNumPresets() - 1, currentPreset);
+    updateMorphTable();
+    updateHostDisplay();
+}
+
+void PitchShifterAudioProcessor::writeValues(juce::OutputStream& stream, const float* values) const
+{
+    int numValues = 0;
+    
+    for (size_t i = 0; i < mStateParams.size(); i++)
+        numValues += std::isnan(values[i]) ? 0 : 1;
+    
+    stream.writeInt(numValues);
+    
+    for (size_t i = 0; i < mStateParams.size(); i++)
+    {
+        if (std::isnan(values[i]))
+            continue;
+        
+        stream.writeInt(mStateParams[i]->paramID.hashCode());
+        stream.writeFloat(values[i]);
+    }
+}
+
+bool PitchShifterAudioProcessor::readValues(juce::InputStream& stream, float* values) const
+{
+    const int numValues = stream.readInt();
+    
+    if (numValues < 0 || stream.getNumBytesRemaining() < (juce::int64) numValues * 8)
+        return false;
+    
+    // IDs this version doesn't know are skipped
+    for (int i = 0; i < numValues; i++)
+    {
+        const int index = findStateParam(stream.readInt());
+        const float value = stream.readFloat();
+        
+        if (index >= 0)
+            values[index] = value;
+    }
+    
+    return true;
+}
+
+//==============================================================================
+// This creates new instances of the plugin..
+juce::AudioProcessor* JUCE_CALLTYPE createPluginFilter()
+{
+    return new PitchShifterAudioProcessor();
+}
@@ -1,87 +1,354 @@
-/*
-  ==============================================================================
-
-    This file contains the basic framework code for a JUCE plugin processor.
-
-  ==============================================================================
-*/
-
-#pragma once
-
-#include <JuceHeader.h>
-
-enum presetType
-{
-    nice = 1,
-    weird,
-    scary
-};
-
-//==============================================================================
-/**
-*/
-class PitchShifterAudioProcessor  : public juce::AudioProcessor
-{
-public:
-    //==============================================================================
-    PitchShifterAudioProcessor();
-    ~PitchShifterAudioProcessor() override;
-
-    //==============================================================================
-    void prepareToPlay (double sampleRate, int samplesPerBlock) override;
-    void releaseResources() override;
-
-   #ifndef JucePlugin_PreferredChannelConfigurations
-    bool isBusesLayoutSupported (const BusesLayout& layouts) const override;
-   #endif
-
-    void processBlock (juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
-
-    //==============================================================================
-    juce::AudioProcessorEditor* createEditor() override;
-    bool hasEditor() const override;
-
-    //==============================================================================
-    const juce::String getName() const override;
-
-    bool acceptsMidi() const override;
-    bool producesMidi() const override;
-    bool isMidiEffect() const override;
-    double getTailLengthSeconds() const override;
-
-    //==============================================================================
-    int getNumPrograms() override;
-    int getCurrentProgram() override;
-    void setCurrentProgram (int index) override;
-    const juce::String getProgramName (int index) override;
-    void changeProgramName (int index, const juce::String& newName) override;
-
-    //==============================================================================
-    void getStateInformation (juce::MemoryBlock& destData) override;
-    void setStateInformation (const void* data, int sizeInBytes) override;
-    
-    int mNumInputChannels;
-    double mSampleRate;
-    double mBlockSize;
-    
-    double mWindowSizeSamps;
-    double mWindowSizeMs;
-    double mTranspoOne;
-    double mTranspoTwo;
-    int mPresetFlag;
-    
-    void setPhasorFreqOne(double f);
-    void setPhasorFreqTwo(double f);
-    
-private:
-    
-    atec::RingBuffer mRingBuf;
-    atec::LFO mPhasorOne[2];
-    atec::LFO mPhasorTwo[2];
-    void setPhasorDebug(bool d);
-    void setPhasorType(atec::LFO::LfoType d);
-    void initPhasor();
-    
-    //==============================================================================
-    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PitchShifterAudioProcessor)
-};
+/*
+  ==============================================================================
+
+    This file contains the basic framework code for a JUCE plugin processor.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "ShifterCore.h"
+#include "ChannelWorkerPool.h"
+#include "PhaseVocoder.h"
+#include "PresetBank.h"
+#include "DspTelemetry.h"
+#include "VisualiserFeed.h"
+
+// the factory presets, numbered from 1; program index = preset - 1
+enum presetType
+{
+    nice = 1,
+    weird,
+    scary
+};
+
+namespace ParamIDs
+{
+    constexpr const char* windowSize = "windowSize";
+    constexpr const char* numVoices = "numVoices";
+    constexpr const char* windowShape = "windowShape";
+    constexpr const char* engine = "engine";
+    constexpr const char* fftSize = "fftSize";
+    constexpr const char* fftOverlap = "fftOverlap";
+    constexpr const char* mix = "mix";
+    constexpr const char* lowLatency = "lowLatency";
+    constexpr const char* interpolation = "interpolation";
+    constexpr const char* oversampling = "oversampling";
+    constexpr const char* oversamplingFilter = "oversamplingFilter";
+    constexpr const char* morph = "morph";
+    constexpr const char* morphFrom = "morphFrom";
+    constexpr const char* morphTo = "morphTo";
+    constexpr const char* outputGain = "outputGain";
+}
+
+enum processingState
+{
+    processingFull = 0,     // grains moving, full kernel
+    processingPureDelay,    // every voice at zero transposition: delayed copies only
+    processingIdle          // input silent and the tail drained: nothing rendered
+};
+
+enum engineType
+{
+    granularEngine = 0,
+    phaseVocoderEngine
+};
+
+//==============================================================================
+/**
+*/
+class PitchShifterAudioProcessor  : public juce::AudioProcessor,
+                                    private ChannelWorkerPool::Job,
+                                    private juce::AudioProcessorValueTreeState::Listener,
+                                    private juce::AsyncUpdater
+{
+public:
+    //==============================================================================
+    PitchShifterAudioProcessor();
+    ~PitchShifterAudioProcessor() override;
+
+    //==============================================================================
+    void prepareToPlay (double sampleRate, int samplesPerBlock) override;
+    void releaseResources() override;
+    void audioWorkgroupContextChanged (const juce::AudioWorkgroup& workgroup) override;
+
+   #ifndef JucePlugin_PreferredChannelConfigurations
+    bool isBusesLayoutSupported (const BusesLayout& layouts) const override;
+   #endif
+
+    void processBlock (juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
+    void processBlock (juce::AudioBuffer<double>&, juce::MidiBuffer&) override;
+    bool supportsDoublePrecisionProcessing() const override;
+
+    //==============================================================================
+    juce::AudioProcessorEditor* createEditor() override;
+    bool hasEditor() const override;
+
+    //==============================================================================
+    const juce::String getName() const override;
+
+    bool acceptsMidi() const override;
+    bool producesMidi() const override;
+    bool isMidiEffect() const override;
+    double getTailLengthSeconds() const override;
+
+    //==============================================================================
+    int getNumPrograms() override;
+    int getCurrentProgram() override;
+    void setCurrentProgram (int index) override;
+    const juce::String getProgramName (int index) override;
+    void changeProgramName (int index, const juce::String& newName) override;
+
+    //==============================================================================
+    void getStateInformation (juce::MemoryBlock& destData) override;
+    void setStateInformation (const void* data, int sizeInBytes) override;
+    
+    //==============================================================================
+    static juce::AudioProcessorValueTreeState::ParameterLayout createParameterLayout();
+    static juce::String transpoParamId(int voice);
+    static juce::String gainParamId(int voice);
+    
+    // host-visible parameters; the editor attaches to these instead of poking members
+    juce::AudioProcessorValueTreeState mParameters;
+    
+    int mNumInputChannels;
+    double mSampleRate;
+    double mBlockSize;
+    
+    // recalls a presetType preset straight away, for offline use before prepareToPlay.
+    // Hosts and the editor go through setCurrentProgram, which crossfades on the audio thread
+    void applyPreset(int preset);
+    
+    // stores the current musical parameters as a new user preset and selects it;
+    // returns its program index, or -1 when the bank is full
+    int storeUserPreset(const juce::String& name);
+    const PresetBank& getPresetBank() const noexcept { return mPresetBank; }
+    
+    // sets a parameter from its real-world value and tells the host
+    void setParameterValue(const juce::String& paramId, float value);
+    
+    // lets wide layouts render their channels on helper threads (on by default)
+    void setChannelThreadsEnabled(bool enabled);
+    
+    // what the last block actually did, as a processingState; safe to read from any thread
+    int getProcessingState() const noexcept { return mProcessingState.load(); }
+    
+    // per-block stage timings; the editor is the one reader
+    DspTelemetry& getTelemetry() noexcept { return mTelemetry; }
+    
+    // voice positions and output audio for the editor's view; costs nothing while no view is open
+    VisualiserFeed& getVisualiserFeed() noexcept { return mVisualiserFeed; }
+    
+    // widest layout accepted, enough for 7th-order ambisonics
+    static constexpr int maxChannels = 64;
+    
+    // top of the window size range; sets how much history has to be kept
+    static constexpr float maxWindowMs = 300.0f;
+    
+private:
+    
+    // one consistent view of every parameter, taken once at the top of each block
+    struct ParameterSnapshot
+    {
+        float windowSizeMs;
+        int numVoices;
+        int windowShape;
+        int engine;
+        int fftOrder;
+        int fftOverlap;
+        float mixPercent;
+        float outputGainDb;
+        bool lowLatency;
+        int interpolation;
+        float transpo[VoiceEngine::maxVoices];
+        float gainDb[VoiceEngine::maxVoices];
+    };
+    
+    void readParameters(ParameterSnapshot& snapshot) const noexcept;
+    void applyParameters(const ParameterSnapshot& snapshot) noexcept;
+    
+    // every parameter in host order, with its ID hash for the saved state and presets
+    std::vector<juce::RangedAudioParameter*> mStateParams;
+    std::vector<std::pair<int, int>> mStateParamsByHash;
+    
+    int findStateParam(int idHash) const noexcept;
+    void getParameterValues(float* values) const noexcept;
+    void setParameterValues(const float* values) noexcept;
+    
+    // which parameters a user preset stores; the rest are left as NaN so recalling one never
+    // switches oversampling (a re-prepare) or rewrites the morph that may be pointing at it
+    std::vector<bool> mPresetParams;
+    void keepPresetValues(float* values) const noexcept;
+    
+    // the state is "PSst", a version, then the parameters, the selected preset and the user
+    // presets. Values are stored as (ID hash, real-world value) pairs, so later versions can
+    // add, drop or reorder parameters and still read older sessions
+    static constexpr int stateMagic = 0x74735350;
+    static constexpr int stateVersion = 1;
+    
+    void writeValues(juce::OutputStream& stream, const float* values) const;
+    bool readValues(juce::InputStream& stream, float* values) const;
+    
+    // a program change is queued for the audio thread, which fades the wet signal out,
+    // swaps the parameters while it's silent and fades back in
+    static constexpr double presetFadeSeconds = 0.02;
+    PresetBank mPresetBank;
+    std::vector<float> mPresetValues;
+    std::atomic<int> mCurrentPreset;
+    std::atomic<int> mPendingPreset;
+    float mPresetFade;
+    float mPresetFadeStart;
+    
+    void addFactoryPresets();
+    void updatePresetFade(int numSamples) noexcept;
+    
+    // morphing blends window size, voice count, transpositions and gains between two
+    // programs (0 = the live parameters). Both ends are copied out of the bank on the
+    // message thread whenever the pair or the bank changes; the audio thread only
+    // reads these atomics and interpolates, once per sub-block
+    static constexpr int morphWindowSize = 0;
+    static constexpr int morphNumVoices = 1;
+    static constexpr int morphTranspo = 2;
+    static constexpr int morphGain = morphTranspo + VoiceEngine::maxVoices;
+    static constexpr int numMorphValues = morphGain + VoiceEngine::maxVoices;
+    
+    struct MorphTable
+    {
+        std::atomic<bool> active { false };
+        std::atomic<float> from[numMorphValues];
+        std::atomic<float> to[numMorphValues];
+    };
+    
+    MorphTable mMorphTable;
+    int mMorphValueParams[numMorphValues];
+    std::atomic<float>* mMorphParam;
+    std::atomic<float>* mMorphFromParam;
+    std::atomic<float>* mMorphToParam;
+    
+    void updateMorphTable();
+    void applyMorph(ParameterSnapshot& snapshot) const noexcept;
+    
+    std::atomic<float>* mWindowSizeParam;
+    std::atomic<float>* mNumVoicesParam;
+    std::atomic<float>* mWindowShapeParam;
+    std::atomic<float>* mEngineParam;
+    std::atomic<float>* mFftSizeParam;
+    std::atomic<float>* mFftOverlapParam;
+    std::atomic<float>* mMixParam;
+    std::atomic<float>* mOutputGainParam;
+    std::atomic<float>* mLowLatencyParam;
+    std::atomic<float>* mInterpolationParam;
+    std::atomic<float>* mTranspoParams[VoiceEngine::maxVoices];
+    std::atomic<float>* mGainParams[VoiceEngine::maxVoices];
+    ParameterSnapshot mSnapshot;
+    
+    // a held MIDI note overrides every voice's transposition
+    bool mMidiNoteActive;
+    int mMidiNote;
+    double mMidiTranspo;
+    
+    void handleMidiEvent(const juce::MidiMessage& message) noexcept;
+    
+    // the resampling around the engine, once per precision; prepareToPlay only allocates
+    // the one the host will call, and each block renders with a single instantiation
+    template <typename SampleType>
+    struct RenderState
+    {
+        std::unique_ptr<juce::dsp::Oversampling<SampleType>> oversampling;
+        std::array<SampleType*, maxChannels> channels {};
+    };
+    
+    RenderState<float> mFloatState;
+    RenderState<double> mDoubleState;
+    bool mDoublePrecision;
+    
+    template <typename SampleType> RenderState<SampleType>& getRenderState() noexcept;
+    template <typename SampleType> void prepareRenderState(RenderState<SampleType>& state, int samplesPerBlock);
+    template <typename SampleType> void processSamples(juce::AudioBuffer<SampleType>& buffer, juce::MidiBuffer& midiMessages) noexcept;
+    template <typename SampleType> void processEngine(RenderState<SampleType>& state, int numSamples, juce::MidiBuffer& midiMessages, int midiScale) noexcept;
+    void renderGranular(int numSamples, juce::MidiBuffer& midiMessages, int midiScale) noexcept;
+    
+    // input below this counts as silence; once it has lasted longer than the tail the kernel is skipped
+    static constexpr float silenceThresholdDb = -120.0f;
+    int mSilentSamples;
+    int mDrainSamples;
+    std::atomic<int> mProcessingState;
+    DspTelemetry mTelemetry;
+    
+    void setProcessingState(int state) noexcept;
+    
+    VisualiserFeed mVisualiserFeed;
+    
+    template <typename SampleType> void feedVisualiser(const juce::AudioBuffer<SampleType>& buffer) noexcept;
+    
+    template <typename SampleType> bool isInputSilent(const juce::AudioBuffer<SampleType>& buffer) const noexcept;
+    void skipSilentBlock(int numSamples, juce::MidiBuffer& midiMessages) noexcept;
+    double getOversamplingLatency() const noexcept;
+    void renderSubBlocks(int startSample, int endSample) noexcept;
+    void renderSegments() noexcept;
+    void runJob(int channel, int lane) noexcept override;
+    
+    // sub-blocks are planned on the audio thread, then rendered channel by channel;
+    // the preset fade is spread across the whole block, so it needs the block length
+    int mBlockLength;
+    
+    // fewest channels worth handing to helper threads
+    static constexpr int channelThreadThreshold = 6;
+    bool mChannelThreadsEnabled;
+    ChannelWorkerPool mWorkerPool;
+    
+    // the host's audio workgroup, joined by the helper threads when they next start
+    juce::AudioWorkgroup mAudioWorkgroup;
+    
+    // the grain engine with its history and output stage, the same code the C API wraps;
+    // the processor only adds parameters, programs, MIDI, resampling and threads around it
+    ShifterCore mCore;
+    PhaseVocoder mPhaseVocoder;
+    
+    template <typename SampleType>
+    void processPhaseVocoder(RenderState<SampleType>& state, int numSamples, juce::MidiBuffer& midiMessages) noexcept;
+    
+    // the engine the last block was rendered with; a switch clears what the other left behind
+    int mRenderedEngine;
+    
+    template <typename SampleType>
+    void switchEngine(RenderState<SampleType>& state, int engine) noexcept;
+    
+    // reports the active engine's delay to the host whenever it moves
+    void updateLatency(int engine) noexcept;
+    std::atomic<double> mTailSeconds;
+    
+    // the phase vocoder's output stage, a separate pass since it renders in place: the core's
+    // levels, with the dry input read from its history at the vocoder's latency
+    template <typename SampleType>
+    void mixDry(RenderState<SampleType>& state, int numSamples, double dryDelay) noexcept;
+    
+    // the oversampler only exists while oversampling is above 1x; the grain engine then runs
+    // at the higher rate. Changing the setting re-prepares from the message thread
+    int mOversamplingFactor;
+    int mPreparedOversampling;
+    int mPreparedOversamplingFilter;
+    bool mPrepared;
+    std::atomic<float>* mOversamplingParam;
+    std::atomic<float>* mOversamplingFilterParam;
+    
+    void parameterChanged(const juce::String& parameterID, float newValue) override;
+    void handleAsyncUpdate() override;
+    
+    //==============================================================================
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PitchShifterAudioProcessor)
+};
+
+template <>
+inline PitchShifterAudioProcessor::RenderState<float>& PitchShifterAudioProcessor::getRenderState<float>() noexcept
+{
+    return mFloatState;
+}
+
+template <>
+inline PitchShifterAudioProcessor::RenderState<double>& PitchShifterAudioProcessor::getRenderState<double>() noexcept
+{
+    return mDoubleState;
+}
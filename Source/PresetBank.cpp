@@ -0,0 +1,102 @@
+/*
+  ==============================================================================
+
+    PresetBank.cpp
+
+  ==============================================================================
+*/
+
+#include "PresetBank.h"
+
+void PresetBank::prepare (int newNumValues)
+{
+    const juce::SpinLock::ScopedLockType sl (lock);
+
+    numValues = newNumValues;
+    numFactoryPresets = 0;
+    numPresets = 0;
+    values.assign ((size_t) maxPresets * (size_t) numValues, std::numeric_limits<float>::quiet_NaN());
+
+    names.clear();
+    for (int i = 0; i < maxPresets; ++i)
+        names.add ({});
+}
+
+float* PresetBank::addFactoryPreset (const juce::String& name)
+{
+    // factory presets go in before any user ones and are never moved
+    jassert (numFactoryPresets == numPresets.load() && numFactoryPresets < maxPresets);
+
+    const juce::SpinLock::ScopedLockType sl (lock);
+
+    const int index = numFactoryPresets++;
+    names.set (index, name);
+    numPresets = numFactoryPresets;
+
+    return getSlot (index);
+}
+
+int PresetBank::storeUserPreset (const juce::String& name, const float* newValues)
+{
+    const juce::SpinLock::ScopedLockType sl (lock);
+
+    const int index = numPresets.load();
+
+    if (index >= maxPresets)
+        return -1;
+
+    std::copy (newValues, newValues + numValues, getSlot (index));
+    names.set (index, name);
+    numPresets = index + 1;
+
+    return index;
+}
+
+void PresetBank::clearUserPresets()
+{
+    const juce::SpinLock::ScopedLockType sl (lock);
+
+    for (int index = numFactoryPresets; index < numPresets.load(); ++index)
+        names.set (index, {});
+
+    numPresets = numFactoryPresets;
+}
+
+juce::String PresetBank::getName (int index) const
+{
+    const juce::SpinLock::ScopedLockType sl (lock);
+    return juce::isPositiveAndBelow (index, numPresets.load()) ? names[index] : juce::String();
+}
+
+void PresetBank::setName (int index, const juce::String& name)
+{
+    const juce::SpinLock::ScopedLockType sl (lock);
+
+    if (index >= numFactoryPresets && index < numPresets.load())
+        names.set (index, name);
+}
+
+bool PresetBank::tryCopyValues (int index, float* dest) const noexcept
+{
+    const juce::SpinLock::ScopedTryLockType sl (lock);
+
+    if (! sl.isLocked())
+        return false;
+
+    copyUnlocked (index, dest);
+    return true;
+}
+
+void PresetBank::copyValues (int index, float* dest) const noexcept
+{
+    const juce::SpinLock::ScopedLockType sl (lock);
+    copyUnlocked (index, dest);
+}
+
+void PresetBank::copyUnlocked (int index, float* dest) const noexcept
+{
+    if (juce::isPositiveAndBelow (index, numPresets.load()))
+        std::copy (getSlot (index), getSlot (index) + numValues, dest);
+    else
+        std::fill (dest, dest + numValues, std::numeric_limits<float>::quiet_NaN());
+}
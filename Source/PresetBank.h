@@ -0,0 +1,78 @@
+/*
+  ==============================================================================
+
+    PresetBank.h
+    The processor's presets: the factory ones followed by user slots.
+
+    A preset is one real-world value per parameter, in the processor's
+    parameter order. Values left as NaN are not part of the preset and leave
+    that parameter alone, which is how the factory presets only touch the
+    transpositions and user presets leave the engine set-up as it is.
+
+    Every slot is allocated up front. Presets are stored and renamed on the
+    message thread under a spin lock; the audio thread only ever try-locks it
+    to copy one preset out, so recalling a preset never blocks or allocates.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+class PresetBank
+{
+public:
+    static constexpr int maxPresets = 64;
+
+    PresetBank() = default;
+
+    /** Sizes every slot for numValues parameters and empties the bank. Not real-time safe. */
+    void prepare (int numValues);
+
+    /** Adds a preset that can't be overwritten; values not set stay NaN.
+        Returns the new preset's values to fill in.
+    */
+    float* addFactoryPreset (const juce::String& name);
+
+    /** Appends a user preset holding numValues values. Returns its index, or -1
+        when the bank is full. Message thread only.
+    */
+    int storeUserPreset (const juce::String& name, const float* values);
+
+    /** Drops every user preset, keeping the factory ones. Message thread only. */
+    void clearUserPresets();
+
+    int getNumPresets() const noexcept              { return numPresets.load(); }
+    int getNumFactoryPresets() const noexcept       { return numFactoryPresets; }
+    int getNumValues() const noexcept               { return numValues; }
+
+    juce::String getName (int index) const;
+
+    /** Renames a user preset; factory names are fixed. Message thread only. */
+    void setName (int index, const juce::String& name);
+
+    /** Copies a preset's values to dest. Safe from the audio thread: returns
+        false, without waiting, if the bank is being edited.
+    */
+    bool tryCopyValues (int index, float* dest) const noexcept;
+
+    /** Copies a preset's values to dest, waiting for any edit. Message thread only. */
+    void copyValues (int index, float* dest) const noexcept;
+
+private:
+    void copyUnlocked (int index, float* dest) const noexcept;
+
+    float* getSlot (int index) noexcept                 { return values.data() + (size_t) index * (size_t) numValues; }
+    const float* getSlot (int index) const noexcept     { return values.data() + (size_t) index * (size_t) numValues; }
+
+    int numValues = 0;
+    int numFactoryPresets = 0;
+    std::atomic<int> numPresets { 0 };
+
+    std::vector<float> values;
+    juce::StringArray names;
+    mutable juce::SpinLock lock;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PresetBank)
+};
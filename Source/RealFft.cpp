@@ -0,0 +1,150 @@
+/*
+  ==============================================================================
+
+    RealFft.cpp
+
+  ==============================================================================
+*/
+
+#include "RealFft.h"
+
+#include <cmath>
+#include <utility>
+
+RealFft::RealFft (int order)
+    : size (1 << order), half (size / 2)
+{
+    constexpr double twoPi = 6.283185307179586476925;
+
+    for (int i = 0, j = 0; i < half; ++i)
+    {
+        if (i < j)
+        {
+            swaps.push_back (i);
+            swaps.push_back (j);
+        }
+
+        int bit = half >> 1;
+
+        for (; (j & bit) != 0; bit >>= 1)
+            j ^= bit;
+
+        j |= bit;
+    }
+
+    for (int j = 0; j < half / 2; ++j)
+    {
+        twiddleRe.push_back ((float) std::cos (twoPi * j / half));
+        twiddleIm.push_back ((float) -std::sin (twoPi * j / half));
+    }
+
+    for (int k = 0; k <= half / 2; ++k)
+    {
+        splitRe.push_back ((float) std::cos (twoPi * k / size));
+        splitIm.push_back ((float) -std::sin (twoPi * k / size));
+    }
+}
+
+void RealFft::transform (float* data, bool inverse) const noexcept
+{
+    for (size_t i = 0; i < swaps.size(); i += 2)
+    {
+        const int a = 2 * swaps[i], b = 2 * swaps[i + 1];
+        std::swap (data[a], data[b]);
+        std::swap (data[a + 1], data[b + 1]);
+    }
+
+    // the inverse runs the same butterflies with conjugate twiddles
+    const float sign = inverse ? -1.0f : 1.0f;
+
+    for (int span = 1; span < half; span *= 2)
+    {
+        const int stride = half / (2 * span);
+
+        for (int start = 0; start < half; start += 2 * span)
+        {
+            for (int j = 0; j < span; ++j)
+            {
+                const float wr = twiddleRe[(size_t) (j * stride)];
+                const float wi = sign * twiddleIm[(size_t) (j * stride)];
+
+                float* a = data + 2 * (start + j);
+                float* b = a + 2 * span;
+
+                const float tr = b[0] * wr - b[1] * wi;
+                const float ti = b[0] * wi + b[1] * wr;
+
+                b[0] = a[0] - tr;
+                b[1] = a[1] - ti;
+                a[0] += tr;
+                a[1] += ti;
+            }
+        }
+    }
+}
+
+void RealFft::forward (float* data) const noexcept
+{
+    // even samples are the real parts, odd ones the imaginary parts
+    transform (data, false);
+
+    // X[k] = E[k] + W^k O[k], where E and O are the spectra of the even and
+    // odd samples, recovered from Z[k] and Z[half - k] in pairs
+    const float z0r = data[0], z0i = data[1];
+    data[0] = z0r + z0i;
+    data[1] = 0.0f;
+    data[2 * half] = z0r - z0i;
+    data[2 * half + 1] = 0.0f;
+
+    for (int k = 1; k <= half / 2; ++k)
+    {
+        float* zk = data + 2 * k;
+        float* zm = data + 2 * (half - k);
+
+        const float er = 0.5f * (zk[0] + zm[0]), ei = 0.5f * (zk[1] - zm[1]);
+        const float orr = 0.5f * (zk[1] + zm[1]), oi = -0.5f * (zk[0] - zm[0]);
+
+        const float wr = splitRe[(size_t) k], wi = splitIm[(size_t) k];
+        const float tr = orr * wr - oi * wi, ti = orr * wi + oi * wr;
+
+        // bin half - k is the mirror image: E and O conjugate, W^(half - k) = -conj (W^k)
+        zk[0] = er + tr;
+        zk[1] = ei + ti;
+        zm[0] = er - tr;
+        zm[1] = ti - ei;
+    }
+}
+
+void RealFft::inverse (float* data) const noexcept
+{
+    // undo the split: E[k] = (X[k] + conj X[half - k]) / 2, O[k] = (X[k] - conj X[half - k]) / (2 W^k)
+    const float x0 = data[0], xh = data[2 * half];
+    data[0] = 0.5f * (x0 + xh);
+    data[1] = 0.5f * (x0 - xh);
+
+    for (int k = 1; k <= half / 2; ++k)
+    {
+        float* xk = data + 2 * k;
+        float* xm = data + 2 * (half - k);
+
+        const float er = 0.5f * (xk[0] + xm[0]), ei = 0.5f * (xk[1] - xm[1]);
+        const float dr = 0.5f * (xk[0] - xm[0]), di = 0.5f * (xk[1] + xm[1]);
+
+        // dividing by W^k is multiplying by its conjugate
+        const float wr = splitRe[(size_t) k], wi = -splitIm[(size_t) k];
+        const float orr = dr * wr - di * wi, oi = dr * wi + di * wr;
+
+        // Z[k] = E[k] + i O[k]; Z[half - k] = conj E[k] + i conj O[k]
+        xk[0] = er - oi;
+        xk[1] = ei + orr;
+        xm[0] = er + oi;
+        xm[1] = orr - ei;
+    }
+
+    transform (data, true);
+
+    const float scale = 1.0f / (float) half;
+
+    for (int i = 0; i < size; ++i)
+        data[i] *= scale;
+}
@@ -0,0 +1,50 @@
+/*
+  ==============================================================================
+
+    RealFft.h
+    An in-place real FFT whose plan is read-only, for the phase vocoder.
+
+    juce::dsp::FFT can't be shared between threads: its portable engine
+    holds a lock for every transform and IPP keeps its work buffer in the
+    plan. Here the plan is just the bit-reversal and twiddle tables, and a
+    transform works entirely in the caller's buffer, so one plan per size
+    serves every instance in the process at once without locking.
+
+    A length-N real transform runs as a length-N/2 complex one on the
+    even/odd samples packed as pairs, followed by one pass that splits the
+    result into the N/2 + 1 bins of the real signal.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <vector>
+
+class RealFft
+{
+public:
+    /** Builds the tables for 2^order points. Not real-time safe. */
+    explicit RealFft (int order);
+
+    int getSize() const noexcept        { return size; }
+
+    /** size real samples in, size / 2 + 1 interleaved (re, im) bins out, in
+        place, the same layout juce::dsp::FFT::performRealOnlyForwardTransform
+        gives. data must hold size + 2 floats.
+    */
+    void forward (float* data) const noexcept;
+
+    /** The bins forward() produces in, size real samples out, in place and
+        scaled so that inverse (forward (x)) is x again.
+    */
+    void inverse (float* data) const noexcept;
+
+private:
+    void transform (float* data, bool inverse) const noexcept;
+
+    int size, half;
+    std::vector<int> swaps;             // index pairs the bit-reversal permutation exchanges
+    std::vector<float> twiddleRe, twiddleIm;        // e^(-2 pi i j / half), j < half / 2
+    std::vector<float> splitRe, splitIm;            // e^(-2 pi i k / size), k <= half / 2
+};
@@ -0,0 +1,70 @@
+/*
+  ==============================================================================
+
+    SharedResources.cpp
+
+  ==============================================================================
+*/
+
+#include "SharedResources.h"
+
+#include <map>
+#include <mutex>
+#include <tuple>
+#include <typeindex>
+
+namespace SharedResources
+{
+    namespace
+    {
+        using Key = std::tuple<std::type_index, double, int>;
+
+        struct Cache
+        {
+            // recursive, so a builder can ask the cache for the resources it's made from
+            std::recursive_mutex lock;
+            std::map<Key, std::weak_ptr<const void>> entries;
+
+            void removeExpired()
+            {
+                for (auto it = entries.begin(); it != entries.end();)
+                    it = it->second.expired() ? entries.erase (it) : std::next (it);
+            }
+        };
+
+        Cache& getCache()
+        {
+            static Cache cache;
+            return cache;
+        }
+    }
+
+    std::shared_ptr<const void> getOrBuild (const std::type_info& type, double sampleRate, int size,
+                                            const std::function<std::shared_ptr<const void>()>& build)
+    {
+        auto& cache = getCache();
+        const std::lock_guard<std::recursive_mutex> guard (cache.lock);
+
+        const Key key { std::type_index (type), sampleRate, size };
+
+        if (auto found = cache.entries.find (key); found != cache.entries.end())
+            if (auto resource = found->second.lock())
+                return resource;
+
+        // building is the slow part, so the map only gets tidied on a miss
+        cache.removeExpired();
+
+        auto resource = build();
+        cache.entries[key] = resource;
+        return resource;
+    }
+
+    int getNumLive()
+    {
+        auto& cache = getCache();
+        const std::lock_guard<std::recursive_mutex> guard (cache.lock);
+
+        cache.removeExpired();
+        return (int) cache.entries.size();
+    }
+}
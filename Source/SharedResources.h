@@ -0,0 +1,50 @@
+/*
+  ==============================================================================
+
+    SharedResources.h
+    A process-wide cache of read-only resources shared between instances.
+
+    A resource is keyed by its type, a sample rate and a size, built the
+    first time an instance asks for it and handed out as a shared_ptr to
+    const. It lives as long as some instance holds it: once the last holder
+    lets go it is freed, and the next request builds it again.
+
+    Look resources up when preparing, never from the audio thread: a miss
+    builds under the cache's lock.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <typeinfo>
+
+namespace SharedResources
+{
+    /** Returns the live resource for (sampleRate, size), or builds one with
+        build(), which returns a std::unique_ptr<Resource>. Pass 0 for either
+        key when the resource doesn't depend on it.
+    */
+    template <typename Resource, typename Builder>
+    std::shared_ptr<const Resource> get (double sampleRate, int size, Builder&& build);
+
+    /** Number of resources currently alive, for diagnostics. */
+    int getNumLive();
+
+    //==============================================================================
+    std::shared_ptr<const void> getOrBuild (const std::type_info& type, double sampleRate, int size,
+                                            const std::function<std::shared_ptr<const void>()>& build);
+
+    template <typename Resource, typename Builder>
+    std::shared_ptr<const Resource> get (double sampleRate, int size, Builder&& build)
+    {
+        auto resource = getOrBuild (typeid (Resource), sampleRate, size, [&build]() -> std::shared_ptr<const void>
+        {
+            return std::shared_ptr<const Resource> (build());
+        });
+
+        return std::static_pointer_cast<const Resource> (resource);
+    }
+}
@@ -0,0 +1,238 @@
+/*
+  ==============================================================================
+
+    ShifterCore.cpp
+
+  ==============================================================================
+*/
+
+#include "ShifterCore.h"
+
+#include <cmath>
+
+ShifterCore::ShifterCore()
+{
+    window = GrainWindow::getTable (GrainWindow::sine);
+}
+
+void ShifterCore::prepare (int newNumChannels, int newMaxBlockSize, double newSampleRate, int numLanes,
+                           bool doublePrecision, double maxWindowMs, int minHistorySamples)
+{
+    numChannels = newNumChannels;
+    maxBlockSize = newMaxBlockSize > 0 ? newMaxBlockSize : 1;
+    sampleRate = newSampleRate;
+
+    voices.prepare (numChannels, maxBlockSize, sampleRate, numLanes, doublePrecision);
+
+    // the longest tap sits a window behind the write head plus a full sweep
+    const int maxGrainDelay = (int) std::ceil (2.0 * maxWindowMs / 1000.0 * sampleRate);
+    const int historySamples = maxGrainDelay > minHistorySamples ? maxGrainDelay : minHistorySamples;
+
+    if (doublePrecision)
+    {
+        doubleHistory.prepare (numChannels, historySamples, maxBlockSize);
+        floatHistory.release();
+    }
+    else
+    {
+        floatHistory.prepare (numChannels, historySamples, maxBlockSize);
+        doubleHistory.release();
+    }
+
+    runs.resize (maxRuns);
+    dryRamps.resize (maxRuns);
+
+    setSmoothingTime (smoothingSeconds);
+    reset();
+}
+
+void ShifterCore::release()
+{
+    floatHistory.release();
+    doubleHistory.release();
+}
+
+void ShifterCore::reset() noexcept
+{
+    voices.reset();
+    lastMix = mix;
+    outputGain.snap();
+    numRuns = 0;
+}
+
+void ShifterCore::clearHistory() noexcept
+{
+    floatHistory.reset();
+    doubleHistory.reset();
+}
+
+void ShifterCore::setWindowShape (GrainWindow::Shape newShape) noexcept
+{
+    window = GrainWindow::getTable (newShape);
+}
+
+void ShifterCore::setLowLatency (bool shouldBeLowLatency) noexcept
+{
+    // the taps have to stay behind everything the interpolator looks ahead at
+    lowLatency = shouldBeLowLatency;
+    voices.setLowLatency (lowLatency, Interpolation::getLookahead (interpolation) + 1);
+}
+
+void ShifterCore::setInterpolation (Interpolation::Type newType) noexcept
+{
+    interpolation = newType;
+    voices.setLowLatency (lowLatency, Interpolation::getLookahead (interpolation) + 1);
+}
+
+void ShifterCore::setMix (float newMix) noexcept
+{
+    mix = newMix < 0.0f ? 0.0f : (newMix > 1.0f ? 1.0f : newMix);
+}
+
+void ShifterCore::setOutputGain (float newGain) noexcept
+{
+    outputGain.setTarget (newGain, smoothingSamples);
+}
+
+void ShifterCore::setSmoothingTime (double seconds) noexcept
+{
+    smoothingSeconds = seconds;
+    smoothingSamples = (int) (seconds * sampleRate);
+    voices.setSmoothingTime (seconds);
+}
+
+void ShifterCore::Ramp::setTarget (float newTarget, int length) noexcept
+{
+    if (newTarget == target)
+        return;
+
+    target = newTarget;
+
+    if (length <= 0)
+    {
+        snap();
+        return;
+    }
+
+    left = length;
+    step = (target - current) / (float) length;
+}
+
+float ShifterCore::Ramp::advance (int numSamples) noexcept
+{
+    if (numSamples >= left)
+    {
+        snap();
+        return current;
+    }
+
+    current += step * (float) numSamples;
+    left -= numSamples;
+    return current;
+}
+
+ShifterCore::Levels ShifterCore::advanceLevels (int numSamples) noexcept
+{
+    static const float wetTrim = std::pow (10.0f, wetTrimDb / 20.0f);
+
+    const float startMix = lastMix;
+    const float endMix = mix;
+    lastMix = mix;
+
+    const float startOutput = outputGain.current;
+    const float endOutput = outputGain.advance (numSamples);
+
+    return { wetTrim * startOutput * startMix, wetTrim * endOutput * endMix,
+             startOutput * (1.0f - startMix), endOutput * (1.0f - endMix) };
+}
+
+template <typename SampleType>
+void ShifterCore::writeHistory (const SampleType* const* channelData, int numSamples) noexcept
+{
+    getWritableHistory<SampleType>().write (channelData, numChannels, numSamples);
+}
+
+void ShifterCore::addRun (int startSample, int numSamples, float wetFadeStart, float wetFadeEnd) noexcept
+{
+    if (numRuns == maxRuns || numSamples <= 0)
+        return;
+
+    const auto levels = advanceLevels (numSamples);
+
+    // the ramps for this run are recorded now and replayed for every channel later
+    const auto& run = runs[(size_t) numRuns];
+    voices.beginBlock (startSample, numSamples, window, runs[(size_t) numRuns],
+                       levels.wetStart * wetFadeStart, levels.wetEnd * wetFadeEnd);
+
+    // the dry signal is read at the wet signal's latency, so the two line up, window glides included
+    auto& dry = dryRamps[(size_t) numRuns++];
+    dry.gain = levels.dryStart;
+    dry.gainStep = (levels.dryEnd - levels.dryStart) / (float) numSamples;
+    dry.delay = run.baseDelay + 0.5 * run.windowSamps;
+    dry.delayStep = run.baseDelayStep + 0.5 * run.windowStep;
+}
+
+template <typename SampleType>
+void ShifterCore::renderChannel (int channel, int lane, SampleType* dest) noexcept
+{
+    // each voice reads at two different positions A & B and crossfades the results;
+    // all voices of a channel share this one reader over the same history
+    const auto& history = getHistory<SampleType>();
+    const auto type = interpolation;
+
+    auto readTaps = [&history, type] (int ch, double baseReadPos, const SampleType* delays, SampleType* out, int num)
+    {
+        history.readInterpBlock (ch, baseReadPos, delays, out, num, type);
+    };
+
+    for (int r = 0; r < numRuns; ++r)
+    {
+        const auto& run = runs[(size_t) r];
+        voices.process (channel, lane, dest, run, readTaps);
+
+        // the dry part goes in straight after, while this run is still in cache
+        const auto& dry = dryRamps[(size_t) r];
+
+        if (dry.gain == 0.0f && dry.gainStep == 0.0f)
+            continue;
+
+        for (int i = 0; i < run.numSamples; ++i)
+        {
+            const int pos = run.startSample + i;
+            dest[pos] += (SampleType) (dry.gain + dry.gainStep * (float) i) * history.readInterpSample (channel, pos, dry.delay + dry.delayStep * i);
+        }
+    }
+}
+
+template <typename SampleType>
+void ShifterCore::renderRuns (SampleType* const* output) noexcept
+{
+    for (int channel = 0; channel < numChannels; ++channel)
+        renderChannel (channel, 0, output[channel]);
+
+    clearRuns();
+}
+
+template <typename SampleType>
+void ShifterCore::process (const SampleType* const* input, SampleType* const* output, int numSamples) noexcept
+{
+    numSamples = numSamples < maxBlockSize ? numSamples : maxBlockSize;
+    writeHistory (input, numSamples);
+
+    for (int start = 0; start < numSamples; start += runLength)
+    {
+        if (isFull())
+            renderRuns (output);
+
+        addRun (start, numSamples - start < runLength ? numSamples - start : runLength);
+    }
+
+    renderRuns (output);
+}
+
+template void ShifterCore::writeHistory<float> (const float* const*, int) noexcept;
+template void ShifterCore::writeHistory<double> (const double* const*, int) noexcept;
+template void ShifterCore::renderChannel<float> (int, int, float*) noexcept;
+template void ShifterCore::renderChannel<double> (int, int, double*) noexcept;
+template void ShifterCore::process<float> (const float* const*, float* const*, int) noexcept;
+template void ShifterCore::process<double> (const double* const*, double* const*, int) noexcept;
@@ -0,0 +1,200 @@
+/*
+  ==============================================================================
+
+    ShifterCore.h
+    The grain pitch shifter without a plugin around it.
+
+    Owns the input history, the voice engine and the output stage: the wet
+    trim, dry/wet mix and a smoothed output gain, all folded into the one
+    write pass. It depends on nothing but the standard library, so the same
+    code runs inside the plugin and behind the C API in PitchShifterApi.h.
+
+    Setters only move targets; every run of up to runLength samples picks
+    them up with its own ramps. A block is rendered in three steps:
+    writeHistory() with the block's input, addRun() for each run of it, then
+    renderChannel() for every channel. The plugin splits the steps so MIDI
+    events land between runs and channels can go to helper threads; process()
+    does all three on the calling thread.
+
+    Everything is allocated in prepare(); nothing after that allocates, locks
+    or waits.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "DelayLine.h"
+#include "GrainWindow.h"
+#include "VoiceEngine.h"
+
+#include <vector>
+
+class ShifterCore
+{
+public:
+    /** Longest run of samples rendered with one set of parameter ramps. */
+    static constexpr int runLength = 64;
+
+    /** Runs planned before the channels have to be rendered. */
+    static constexpr int maxRuns = 256;
+
+    /** Trim on the wet signal, which sums two overlapping taps per voice. */
+    static constexpr float wetTrimDb = -3.0f;
+
+    ShifterCore();
+
+    /** Sizes the history for windows up to maxWindowMs, or minHistorySamples if
+        that's longer, and allocates the engine for blocks of up to maxBlockSize.
+        numLanes is how many threads may call renderChannel() at once. Only the
+        precision asked for holds any memory. Not real-time safe.
+    */
+    void prepare (int numChannels, int maxBlockSize, double sampleRate, int numLanes = 1,
+                  bool doublePrecision = false, double maxWindowMs = 300.0, int minHistorySamples = 0);
+
+    /** Frees the history. */
+    void release();
+
+    /** Restarts the grains and lands every ramp on its target. The history is kept. */
+    void reset() noexcept;
+
+    /** Fills the history with silence. */
+    void clearHistory() noexcept;
+
+    int getNumChannels() const noexcept             { return numChannels; }
+    int getMaxBlockSize() const noexcept            { return maxBlockSize; }
+
+    //==============================================================================
+    void setNumVoices (int newNumVoices) noexcept            { voices.setNumVoices (newNumVoices); }
+    void setTranspo (int voice, double semitones) noexcept  { voices.setTranspo (voice, semitones); }
+    void setGain (int voice, float newGain) noexcept        { voices.setGain (voice, newGain); }
+    void setWindowSize (double windowMs) noexcept           { voices.setWindowSize (windowMs); }
+    void setWindowShape (GrainWindow::Shape newShape) noexcept;
+    void setLowLatency (bool shouldBeLowLatency) noexcept;
+    void setInterpolation (Interpolation::Type newType) noexcept;
+
+    /** Wet proportion, 0 to 1. Moves in one run. */
+    void setMix (float newMix) noexcept;
+
+    /** Linear gain on the whole output, ramped over the smoothing time. */
+    void setOutputGain (float newGain) noexcept;
+
+    /** Length of every parameter ramp. Defaults to 50 ms. */
+    void setSmoothingTime (double seconds) noexcept;
+
+    const VoiceEngine& getVoiceEngine() const noexcept      { return voices; }
+    double getLatencySamples() const noexcept               { return voices.getLatencySamples(); }
+    double getTailSamples() const noexcept                  { return voices.getTailSamples(); }
+
+    //==============================================================================
+    /** Output-stage gains at the start and end of some samples. wet includes the
+        trim, mix and output gain; dry the rest of the mix and the output gain.
+    */
+    struct Levels
+    {
+        float wetStart, wetEnd;
+        float dryStart, dryEnd;
+    };
+
+    /** Moves the mix and output gain on by numSamples and returns where they went.
+        addRun() does this itself; callers with an engine of their own use it to
+        share the same output stage.
+    */
+    Levels advanceLevels (int numSamples) noexcept;
+
+    /** Appends a block to the history. Runs and reads are relative to its first sample. */
+    template <typename SampleType>
+    void writeHistory (const SampleType* const* channelData, int numSamples) noexcept;
+
+    /** Plans samples [startSample, startSample + numSamples) of the block, at most
+        runLength long, with the current targets. wetFadeStart and wetFadeEnd ramp
+        the wet signal only, on top of everything else. Render before adding more
+        once isFull() says so.
+    */
+    void addRun (int startSample, int numSamples, float wetFadeStart = 1.0f, float wetFadeEnd = 1.0f) noexcept;
+
+    bool isFull() const noexcept                    { return numRuns == maxRuns; }
+    int getNumRuns() const noexcept                 { return numRuns; }
+
+    /** Writes every planned run of one channel into dest, which is indexed from
+        the block start; dest may be the channel's input. Different channels may
+        be rendered at once from different lanes.
+    */
+    template <typename SampleType>
+    void renderChannel (int channel, int lane, SampleType* dest) noexcept;
+
+    /** Forgets the planned runs once every channel has been rendered. */
+    void clearRuns() noexcept                       { numRuns = 0; }
+
+    /** The whole block on the calling thread: input and output may be the same
+        channels. numSamples must not exceed the prepared block size.
+    */
+    template <typename SampleType>
+    void process (const SampleType* const* input, SampleType* const* output, int numSamples) noexcept;
+
+    /** The input history, for reading a dry signal at some delay. */
+    template <typename SampleType>
+    const DelayLine<SampleType>& getHistory() const noexcept;
+
+private:
+    template <typename SampleType>
+    DelayLine<SampleType>& getWritableHistory() noexcept;
+
+    template <typename SampleType>
+    void renderRuns (SampleType* const* output) noexcept;
+
+    struct DryRamp
+    {
+        float gain;
+        float gainStep;
+        double delay;
+        double delayStep;
+    };
+
+    // a linear ramp towards a target, the same shape the voice gains use
+    struct Ramp
+    {
+        float current = 1.0f;
+        float target = 1.0f;
+        float step = 0.0f;
+        int left = 0;
+
+        void setTarget (float newTarget, int length) noexcept;
+        void snap() noexcept                        { current = target; left = 0; }
+        float advance (int numSamples) noexcept;
+    };
+
+    int numChannels = 0;
+    int maxBlockSize = 0;
+    int smoothingSamples = 0;
+    double smoothingSeconds = 0.05;
+    double sampleRate = 44100.0;
+
+    VoiceEngine voices;
+    DelayLine<float> floatHistory;
+    DelayLine<double> doubleHistory;
+
+    const float* window = nullptr;
+    bool lowLatency = false;
+    Interpolation::Type interpolation = Interpolation::linear;
+
+    float mix = 1.0f;
+    float lastMix = 1.0f;
+    Ramp outputGain;
+
+    std::vector<VoiceEngine::Segment> runs;
+    std::vector<DryRamp> dryRamps;
+    int numRuns = 0;
+};
+
+template <>
+inline const DelayLine<float>& ShifterCore::getHistory<float>() const noexcept     { return floatHistory; }
+
+template <>
+inline const DelayLine<double>& ShifterCore::getHistory<double>() const noexcept   { return doubleHistory; }
+
+template <>
+inline DelayLine<float>& ShifterCore::getWritableHistory<float>() noexcept         { return floatHistory; }
+
+template <>
+inline DelayLine<double>& ShifterCore::getWritableHistory<double>() noexcept       { return doubleHistory; }
@@ -0,0 +1,470 @@
+/*
+  ==============================================================================
+
+    SimdOps.h
+    Thin SIMD wrapper used by the grain kernel, the delay line and the
+    phase vocoder's polar conversions.
+
+    Picks AVX, SSE2 or NEON at compile time and falls back to plain scalar
+    code everywhere else. Define PITCHSHIFTER_FORCE_SCALAR to build the
+    scalar reference path on any target (handy when checking the vector code).
+
+    AVX is only used when the compiler is already targeting it (-mavx or
+    /arch:AVX, which PITCHSHIFTER_ENABLE_AVX turns on in the CMake build).
+    It isn't the default because the whole binary then needs an AVX CPU, and
+    a plugin that fails to load is worse than one running at half width.
+
+    FloatVec and DoubleVec share one interface, and Vec<SampleType> picks
+    between them, so the kernels are written once as templates and each
+    precision gets its own full-width instantiation.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+
+#if ! defined (PITCHSHIFTER_FORCE_SCALAR)
+ #if defined (__AVX__)
+  #include <immintrin.h>
+  #define PITCHSHIFTER_SIMD_AVX 1
+ #elif defined (__SSE2__) || defined (_M_X64) || (defined (_M_IX86_FP) && _M_IX86_FP >= 2)
+  #include <emmintrin.h>
+  #define PITCHSHIFTER_SIMD_SSE 1
+ #elif defined (__ARM_NEON) || defined (__ARM_NEON__) || defined (_M_ARM64)
+  #include <arm_neon.h>
+  #define PITCHSHIFTER_SIMD_NEON 1
+  #if defined (__aarch64__) || defined (_M_ARM64)
+   #define PITCHSHIFTER_SIMD_NEON64 1
+  #endif
+ #endif
+#endif
+
+namespace SimdOps
+{
+    //==============================================================================
+    /** Eight packed floats with AVX, four with SSE2 or NEON, one on the scalar path. */
+    struct FloatVec
+    {
+       #if PITCHSHIFTER_SIMD_AVX
+        static constexpr int size = 8;
+        __m256 v;
+
+        static FloatVec load (const float* p) noexcept          { return { _mm256_loadu_ps (p) }; }
+        static FloatVec fill (float x) noexcept                 { return { _mm256_set1_ps (x) }; }
+        static FloatVec ramp (float x, float step) noexcept
+        {
+            return { _mm256_add_ps (_mm256_set1_ps (x), _mm256_mul_ps (_mm256_set1_ps (step), _mm256_setr_ps (0, 1, 2, 3, 4, 5, 6, 7))) };
+        }
+        void store (float* p) const noexcept                    { _mm256_storeu_ps (p, v); }
+
+        FloatVec operator+ (FloatVec o) const noexcept          { return { _mm256_add_ps (v, o.v) }; }
+        FloatVec operator- (FloatVec o) const noexcept          { return { _mm256_sub_ps (v, o.v) }; }
+        FloatVec operator* (FloatVec o) const noexcept          { return { _mm256_mul_ps (v, o.v) }; }
+        FloatVec operator/ (FloatVec o) const noexcept          { return { _mm256_div_ps (v, o.v) }; }
+
+        FloatVec abs() const noexcept                           { return { _mm256_andnot_ps (_mm256_set1_ps (-0.0f), v) }; }
+        FloatVec sqrt() const noexcept                          { return { _mm256_sqrt_ps (v) }; }
+        static FloatVec min (FloatVec a, FloatVec b) noexcept   { return { _mm256_min_ps (a.v, b.v) }; }
+        static FloatVec max (FloatVec a, FloatVec b) noexcept   { return { _mm256_max_ps (a.v, b.v) }; }
+
+        FloatVec whereAtLeast (FloatVec limit, FloatVec x) const noexcept
+        {
+            return { _mm256_and_ps (_mm256_cmp_ps (v, limit.v, _CMP_GE_OQ), x.v) };
+        }
+
+        FloatVec whereBelow (FloatVec limit, FloatVec x) const noexcept
+        {
+            return { _mm256_and_ps (_mm256_cmp_ps (v, limit.v, _CMP_LT_OQ), x.v) };
+        }
+
+        float sum() const noexcept
+        {
+            const __m128 quad = _mm_add_ps (_mm256_castps256_ps128 (v), _mm256_extractf128_ps (v, 1));
+            const __m128 pairs = _mm_add_ps (quad, _mm_movehl_ps (quad, quad));
+            return _mm_cvtss_f32 (_mm_add_ss (pairs, _mm_shuffle_ps (pairs, pairs, 1)));
+        }
+       #elif PITCHSHIFTER_SIMD_SSE
+        static constexpr int size = 4;
+        __m128 v;
+
+        static FloatVec load (const float* p) noexcept          { return { _mm_loadu_ps (p) }; }
+        static FloatVec fill (float x) noexcept                 { return { _mm_set1_ps (x) }; }
+        static FloatVec ramp (float x, float step) noexcept     { return { _mm_setr_ps (x, x + step, x + 2.0f * step, x + 3.0f * step) }; }
+        void store (float* p) const noexcept                    { _mm_storeu_ps (p, v); }
+
+        FloatVec operator+ (FloatVec o) const noexcept          { return { _mm_add_ps (v, o.v) }; }
+        FloatVec operator- (FloatVec o) const noexcept          { return { _mm_sub_ps (v, o.v) }; }
+        FloatVec operator* (FloatVec o) const noexcept          { return { _mm_mul_ps (v, o.v) }; }
+        FloatVec operator/ (FloatVec o) const noexcept          { return { _mm_div_ps (v, o.v) }; }
+
+        FloatVec abs() const noexcept                           { return { _mm_andnot_ps (_mm_set1_ps (-0.0f), v) }; }
+        FloatVec sqrt() const noexcept                          { return { _mm_sqrt_ps (v) }; }
+        static FloatVec min (FloatVec a, FloatVec b) noexcept   { return { _mm_min_ps (a.v, b.v) }; }
+        static FloatVec max (FloatVec a, FloatVec b) noexcept   { return { _mm_max_ps (a.v, b.v) }; }
+
+        /** Returns x wherever this >= limit, zero elsewhere. */
+        FloatVec whereAtLeast (FloatVec limit, FloatVec x) const noexcept
+        {
+            return { _mm_and_ps (_mm_cmpge_ps (v, limit.v), x.v) };
+        }
+
+        /** Returns x wherever this < limit, zero elsewhere. */
+        FloatVec whereBelow (FloatVec limit, FloatVec x) const noexcept
+        {
+            return { _mm_and_ps (_mm_cmplt_ps (v, limit.v), x.v) };
+        }
+
+        /** Adds the lanes together. */
+        float sum() const noexcept
+        {
+            const __m128 pairs = _mm_add_ps (v, _mm_movehl_ps (v, v));
+            return _mm_cvtss_f32 (_mm_add_ss (pairs, _mm_shuffle_ps (pairs, pairs, 1)));
+        }
+       #elif PITCHSHIFTER_SIMD_NEON
+        static constexpr int size = 4;
+        float32x4_t v;
+
+        static FloatVec load (const float* p) noexcept          { return { vld1q_f32 (p) }; }
+        static FloatVec fill (float x) noexcept                 { return { vdupq_n_f32 (x) }; }
+        static FloatVec ramp (float x, float step) noexcept
+        {
+            const float lanes[4] = { x, x + step, x + 2.0f * step, x + 3.0f * step };
+            return { vld1q_f32 (lanes) };
+        }
+        void store (float* p) const noexcept                    { vst1q_f32 (p, v); }
+
+        FloatVec operator+ (FloatVec o) const noexcept          { return { vaddq_f32 (v, o.v) }; }
+        FloatVec operator- (FloatVec o) const noexcept          { return { vsubq_f32 (v, o.v) }; }
+        FloatVec operator* (FloatVec o) const noexcept          { return { vmulq_f32 (v, o.v) }; }
+
+        FloatVec abs() const noexcept                           { return { vabsq_f32 (v) }; }
+        static FloatVec min (FloatVec a, FloatVec b) noexcept   { return { vminq_f32 (a.v, b.v) }; }
+        static FloatVec max (FloatVec a, FloatVec b) noexcept   { return { vmaxq_f32 (a.v, b.v) }; }
+
+       #if PITCHSHIFTER_SIMD_NEON64
+        FloatVec operator/ (FloatVec o) const noexcept          { return { vdivq_f32 (v, o.v) }; }
+        FloatVec sqrt() const noexcept                          { return { vsqrtq_f32 (v) }; }
+       #else
+        // 32-bit NEON only has estimates, so these go a lane at a time to stay exact
+        FloatVec operator/ (FloatVec o) const noexcept
+        {
+            float a[4], b[4];
+            vst1q_f32 (a, v);
+            vst1q_f32 (b, o.v);
+
+            for (int i = 0; i < 4; ++i)
+                a[i] /= b[i];
+
+            return { vld1q_f32 (a) };
+        }
+
+        FloatVec sqrt() const noexcept
+        {
+            float a[4];
+            vst1q_f32 (a, v);
+
+            for (auto& x : a)
+                x = std::sqrt (x);
+
+            return { vld1q_f32 (a) };
+        }
+       #endif
+
+        FloatVec whereAtLeast (FloatVec limit, FloatVec x) const noexcept
+        {
+            return { vreinterpretq_f32_u32 (vandq_u32 (vcgeq_f32 (v, limit.v), vreinterpretq_u32_f32 (x.v))) };
+        }
+
+        FloatVec whereBelow (FloatVec limit, FloatVec x) const noexcept
+        {
+            return { vreinterpretq_f32_u32 (vandq_u32 (vcltq_f32 (v, limit.v), vreinterpretq_u32_f32 (x.v))) };
+        }
+
+        float sum() const noexcept
+        {
+            const float32x2_t pairs = vadd_f32 (vget_low_f32 (v), vget_high_f32 (v));
+            return vget_lane_f32 (vpadd_f32 (pairs, pairs), 0);
+        }
+       #else
+        static constexpr int size = 1;
+        float v;
+
+        static FloatVec load (const float* p) noexcept          { return { *p }; }
+        static FloatVec fill (float x) noexcept                 { return { x }; }
+        static FloatVec ramp (float x, float) noexcept          { return { x }; }
+        void store (float* p) const noexcept                    { *p = v; }
+
+        FloatVec operator+ (FloatVec o) const noexcept          { return { v + o.v }; }
+        FloatVec operator- (FloatVec o) const noexcept          { return { v - o.v }; }
+        FloatVec operator* (FloatVec o) const noexcept          { return { v * o.v }; }
+        FloatVec operator/ (FloatVec o) const noexcept          { return { v / o.v }; }
+
+        FloatVec abs() const noexcept                           { return { std::abs (v) }; }
+        FloatVec sqrt() const noexcept                          { return { std::sqrt (v) }; }
+        static FloatVec min (FloatVec a, FloatVec b) noexcept   { return { a.v < b.v ? a.v : b.v }; }
+        static FloatVec max (FloatVec a, FloatVec b) noexcept   { return { a.v > b.v ? a.v : b.v }; }
+
+        FloatVec whereAtLeast (FloatVec limit, FloatVec x) const noexcept
+        {
+            return { v >= limit.v ? x.v : 0.0f };
+        }
+
+        FloatVec whereBelow (FloatVec limit, FloatVec x) const noexcept
+        {
+            return { v < limit.v ? x.v : 0.0f };
+        }
+
+        float sum() const noexcept                              { return v; }
+       #endif
+    };
+
+    //==============================================================================
+    /** Packed doubles: four per AVX register, two per SSE2 or AArch64 NEON register, one elsewhere. */
+    struct DoubleVec
+    {
+       #if PITCHSHIFTER_SIMD_AVX
+        static constexpr int size = 4;
+        __m256d v;
+
+        static DoubleVec load (const double* p) noexcept        { return { _mm256_loadu_pd (p) }; }
+        static DoubleVec fill (double x) noexcept               { return { _mm256_set1_pd (x) }; }
+        static DoubleVec ramp (double x, double step) noexcept  { return { _mm256_setr_pd (x, x + step, x + 2.0 * step, x + 3.0 * step) }; }
+        void store (double* p) const noexcept                   { _mm256_storeu_pd (p, v); }
+
+        DoubleVec operator+ (DoubleVec o) const noexcept        { return { _mm256_add_pd (v, o.v) }; }
+        DoubleVec operator- (DoubleVec o) const noexcept        { return { _mm256_sub_pd (v, o.v) }; }
+        DoubleVec operator* (DoubleVec o) const noexcept        { return { _mm256_mul_pd (v, o.v) }; }
+        DoubleVec operator/ (DoubleVec o) const noexcept        { return { _mm256_div_pd (v, o.v) }; }
+
+        DoubleVec abs() const noexcept                          { return { _mm256_andnot_pd (_mm256_set1_pd (-0.0), v) }; }
+        DoubleVec sqrt() const noexcept                         { return { _mm256_sqrt_pd (v) }; }
+        static DoubleVec min (DoubleVec a, DoubleVec b) noexcept { return { _mm256_min_pd (a.v, b.v) }; }
+        static DoubleVec max (DoubleVec a, DoubleVec b) noexcept { return { _mm256_max_pd (a.v, b.v) }; }
+
+        DoubleVec whereAtLeast (DoubleVec limit, DoubleVec x) const noexcept
+        {
+            return { _mm256_and_pd (_mm256_cmp_pd (v, limit.v, _CMP_GE_OQ), x.v) };
+        }
+
+        DoubleVec whereBelow (DoubleVec limit, DoubleVec x) const noexcept
+        {
+            return { _mm256_and_pd (_mm256_cmp_pd (v, limit.v, _CMP_LT_OQ), x.v) };
+        }
+
+        double sum() const noexcept
+        {
+            const __m128d pair = _mm_add_pd (_mm256_castpd256_pd128 (v), _mm256_extractf128_pd (v, 1));
+            return _mm_cvtsd_f64 (_mm_add_sd (pair, _mm_unpackhi_pd (pair, pair)));
+        }
+       #elif PITCHSHIFTER_SIMD_SSE
+        static constexpr int size = 2;
+        __m128d v;
+
+        static DoubleVec load (const double* p) noexcept        { return { _mm_loadu_pd (p) }; }
+        static DoubleVec fill (double x) noexcept               { return { _mm_set1_pd (x) }; }
+        static DoubleVec ramp (double x, double step) noexcept  { return { _mm_setr_pd (x, x + step) }; }
+        void store (double* p) const noexcept                   { _mm_storeu_pd (p, v); }
+
+        DoubleVec operator+ (DoubleVec o) const noexcept        { return { _mm_add_pd (v, o.v) }; }
+        DoubleVec operator- (DoubleVec o) const noexcept        { return { _mm_sub_pd (v, o.v) }; }
+        DoubleVec operator* (DoubleVec o) const noexcept        { return { _mm_mul_pd (v, o.v) }; }
+        DoubleVec operator/ (DoubleVec o) const noexcept        { return { _mm_div_pd (v, o.v) }; }
+
+        DoubleVec abs() const noexcept                          { return { _mm_andnot_pd (_mm_set1_pd (-0.0), v) }; }
+        DoubleVec sqrt() const noexcept                         { return { _mm_sqrt_pd (v) }; }
+        static DoubleVec min (DoubleVec a, DoubleVec b) noexcept { return { _mm_min_pd (a.v, b.v) }; }
+        static DoubleVec max (DoubleVec a, DoubleVec b) noexcept { return { _mm_max_pd (a.v, b.v) }; }
+
+        DoubleVec whereAtLeast (DoubleVec limit, DoubleVec x) const noexcept
+        {
+            return { _mm_and_pd (_mm_cmpge_pd (v, limit.v), x.v) };
+        }
+
+        DoubleVec whereBelow (DoubleVec limit, DoubleVec x) const noexcept
+        {
+            return { _mm_and_pd (_mm_cmplt_pd (v, limit.v), x.v) };
+        }
+
+        double sum() const noexcept                             { return _mm_cvtsd_f64 (_mm_add_sd (v, _mm_unpackhi_pd (v, v))); }
+       #elif PITCHSHIFTER_SIMD_NEON64
+        static constexpr int size = 2;
+        float64x2_t v;
+
+        static DoubleVec load (const double* p) noexcept        { return { vld1q_f64 (p) }; }
+        static DoubleVec fill (double x) noexcept               { return { vdupq_n_f64 (x) }; }
+        static DoubleVec ramp (double x, double step) noexcept
+        {
+            const double lanes[2] = { x, x + step };
+            return { vld1q_f64 (lanes) };
+        }
+        void store (double* p) const noexcept                   { vst1q_f64 (p, v); }
+
+        DoubleVec operator+ (DoubleVec o) const noexcept        { return { vaddq_f64 (v, o.v) }; }
+        DoubleVec operator- (DoubleVec o) const noexcept        { return { vsubq_f64 (v, o.v) }; }
+        DoubleVec operator* (DoubleVec o) const noexcept        { return { vmulq_f64 (v, o.v) }; }
+        DoubleVec operator/ (DoubleVec o) const noexcept        { return { vdivq_f64 (v, o.v) }; }
+
+        DoubleVec abs() const noexcept                          { return { vabsq_f64 (v) }; }
+        DoubleVec sqrt() const noexcept                         { return { vsqrtq_f64 (v) }; }
+        static DoubleVec min (DoubleVec a, DoubleVec b) noexcept { return { vminq_f64 (a.v, b.v) }; }
+        static DoubleVec max (DoubleVec a, DoubleVec b) noexcept { return { vmaxq_f64 (a.v, b.v) }; }
+
+        DoubleVec whereAtLeast (DoubleVec limit, DoubleVec x) const noexcept
+        {
+            return { vreinterpretq_f64_u64 (vandq_u64 (vcgeq_f64 (v, limit.v), vreinterpretq_u64_f64 (x.v))) };
+        }
+
+        DoubleVec whereBelow (DoubleVec limit, DoubleVec x) const noexcept
+        {
+            return { vreinterpretq_f64_u64 (vandq_u64 (vcltq_f64 (v, limit.v), vreinterpretq_u64_f64 (x.v))) };
+        }
+
+        double sum() const noexcept                             { return vaddvq_f64 (v); }
+       #else
+        static constexpr int size = 1;
+        double v;
+
+        static DoubleVec load (const double* p) noexcept        { return { *p }; }
+        static DoubleVec fill (double x) noexcept               { return { x }; }
+        static DoubleVec ramp (double x, double) noexcept       { return { x }; }
+        void store (double* p) const noexcept                   { *p = v; }
+
+        DoubleVec operator+ (DoubleVec o) const noexcept        { return { v + o.v }; }
+        DoubleVec operator- (DoubleVec o) const noexcept        { return { v - o.v }; }
+        DoubleVec operator* (DoubleVec o) const noexcept        { return { v * o.v }; }
+        DoubleVec operator/ (DoubleVec o) const noexcept        { return { v / o.v }; }
+
+        DoubleVec abs() const noexcept                          { return { std::abs (v) }; }
+        DoubleVec sqrt() const noexcept                         { return { std::sqrt (v) }; }
+        static DoubleVec min (DoubleVec a, DoubleVec b) noexcept { return { a.v < b.v ? a.v : b.v }; }
+        static DoubleVec max (DoubleVec a, DoubleVec b) noexcept { return { a.v > b.v ? a.v : b.v }; }
+
+        DoubleVec whereAtLeast (DoubleVec limit, DoubleVec x) const noexcept
+        {
+            return { v >= limit.v ? x.v : 0.0 };
+        }
+
+        DoubleVec whereBelow (DoubleVec limit, DoubleVec x) const noexcept
+        {
+            return { v < limit.v ? x.v : 0.0 };
+        }
+
+        double sum() const noexcept                             { return v; }
+       #endif
+    };
+
+    //==============================================================================
+    template <typename SampleType> struct VecType;
+    template <> struct VecType<float>   { using Type = FloatVec; };
+    template <> struct VecType<double>  { using Type = DoubleVec; };
+
+    /** The vector type holding SampleType lanes. */
+    template <typename SampleType>
+    using Vec = typename VecType<SampleType>::Type;
+
+    /** Number of leading samples that can be handled in whole vectors. */
+    template <typename SampleType = float>
+    inline int vectorisedLength (int numSamples) noexcept
+    {
+        return numSamples - (numSamples % Vec<SampleType>::size);
+    }
+
+    //==============================================================================
+    /** Four-quadrant arctangent of y / x, within 3e-7 radians. */
+    inline FloatVec atan2 (FloatVec y, FloatVec x) noexcept
+    {
+        const auto zero = FloatVec::fill (0.0f);
+        const auto ax = x.abs(), ay = y.abs();
+
+        // the series runs on the smaller over the larger, so its argument stays in [0, 1]
+        const auto a = FloatVec::min (ax, ay) / FloatVec::max (FloatVec::max (ax, ay), FloatVec::fill (1.0e-30f));
+        const auto s = a * a;
+
+        // Abramowitz and Stegun 4.4.49, good to 2e-8
+        auto r = FloatVec::fill (0.0028662257f);
+        r = r * s + FloatVec::fill (-0.0161657367f);
+        r = r * s + FloatVec::fill (0.0429096138f);
+        r = r * s + FloatVec::fill (-0.0752896400f);
+        r = r * s + FloatVec::fill (0.1065626393f);
+        r = r * s + FloatVec::fill (-0.1420889944f);
+        r = r * s + FloatVec::fill (0.1999355085f);
+        r = r * s + FloatVec::fill (-0.3333314528f);
+        r = a + a * s * r;
+
+        // then back out to the octant and quadrant the point is in
+        r = r + ax.whereBelow (ay, FloatVec::fill (1.57079633f) - r - r);
+        r = r + x.whereBelow (zero, FloatVec::fill (3.14159265f) - r - r);
+        return r - y.whereBelow (zero, r + r);
+    }
+
+    /** Sine of x, within 4e-7 for the few turns either side of zero a vocoder's phases cover. */
+    inline FloatVec sin (FloatVec x) noexcept
+    {
+        const auto halfPi = FloatVec::fill (1.57079633f);
+        const auto pi = FloatVec::fill (3.14159265f);
+
+        // adding 1.5 * 2^23 and taking it away again rounds to a whole number of turns,
+        // which are removed in two parts so the reduction itself stays exact
+        const auto magic = FloatVec::fill (12582912.0f);
+        const auto turns = (x * FloatVec::fill (0.159154943f) + magic) - magic;
+        x = x - turns * FloatVec::fill (6.28318548f) - turns * FloatVec::fill (-1.74845553e-7f);
+
+        // sin is symmetric about +-pi/2, so fold [-pi, pi] into [-pi/2, pi/2]
+        x = x + x.whereAtLeast (halfPi, pi - x - x) + x.whereBelow (FloatVec::fill (0.0f) - halfPi, FloatVec::fill (0.0f) - pi - x - x);
+
+        // Taylor series to x^11, which is within 6e-8 at pi/2
+        const auto s = x * x;
+        auto r = FloatVec::fill (-2.50521084e-8f);
+        r = r * s + FloatVec::fill (2.75573192e-6f);
+        r = r * s + FloatVec::fill (-1.98412698e-4f);
+        r = r * s + FloatVec::fill (8.33333333e-3f);
+        r = r * s + FloatVec::fill (-1.66666667e-1f);
+        return x + x * s * r;
+    }
+
+    inline FloatVec cos (FloatVec x) noexcept
+    {
+        return sin (x + FloatVec::fill (1.57079633f));
+    }
+
+    /** magnitude = |re + i im| and phase = arg (re + i im) for numBins bins. */
+    inline void cartesianToPolar (const float* re, const float* im, float* magnitude, float* phase, int numBins) noexcept
+    {
+        const int numVectorised = vectorisedLength (numBins);
+
+        for (int k = 0; k < numVectorised; k += FloatVec::size)
+        {
+            const auto x = FloatVec::load (re + k), y = FloatVec::load (im + k);
+            (x * x + y * y).sqrt().store (magnitude + k);
+            atan2 (y, x).store (phase + k);
+        }
+
+        for (int k = numVectorised; k < numBins; ++k)
+        {
+            magnitude[k] = std::sqrt (re[k] * re[k] + im[k] * im[k]);
+            phase[k] = std::atan2 (im[k], re[k]);
+        }
+    }
+
+    /** re + i im = magnitude * e^(i phase) for numBins bins. */
+    inline void polarToCartesian (const float* magnitude, const float* phase, float* re, float* im, int numBins) noexcept
+    {
+        const int numVectorised = vectorisedLength (numBins);
+
+        for (int k = 0; k < numVectorised; k += FloatVec::size)
+        {
+            const auto m = FloatVec::load (magnitude + k), p = FloatVec::load (phase + k);
+            (m * cos (p)).store (re + k);
+            (m * sin (p)).store (im + k);
+        }
+
+        for (int k = numVectorised; k < numBins; ++k)
+        {
+            re[k] = magnitude[k] * std::cos (phase[k]);
+            im[k] = magnitude[k] * std::sin (phase[k]);
+        }
+    }
+}
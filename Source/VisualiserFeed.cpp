@@ -0,0 +1,86 @@
+/*
+  ==============================================================================
+
+    VisualiserFeed.cpp
+
+  ==============================================================================
+*/
+
+#include "VisualiserFeed.h"
+
+void VisualiserFeed::prepare (double newSampleRate) noexcept
+{
+    sampleRate = newSampleRate;
+    samplesToSnapshot = 0;
+    snapshotFifo.reset();
+    audioFifo.reset();
+}
+
+bool VisualiserFeed::isSnapshotDue (int numSamples) noexcept
+{
+    samplesToSnapshot -= numSamples;
+
+    if (samplesToSnapshot > 0)
+        return false;
+
+    samplesToSnapshot = (int) (sampleRate.load() / snapshotRateHz);
+    return true;
+}
+
+void VisualiserFeed::pushSnapshot (const Snapshot& snapshot) noexcept
+{
+    int start1, size1, start2, size2;
+    snapshotFifo.prepareToWrite (1, start1, size1, start2, size2);
+
+    if (size1 + size2 == 0)
+        return;
+
+    snapshots[size1 > 0 ? start1 : start2] = snapshot;
+    snapshotFifo.finishedWrite (1);
+}
+
+template <typename SampleType>
+void VisualiserFeed::pushAudio (const SampleType* data, int numSamples) noexcept
+{
+    int start1, size1, start2, size2;
+    audioFifo.prepareToWrite (numSamples, start1, size1, start2, size2);
+
+    for (int i = 0; i < size1; ++i)
+        audio[start1 + i] = (float) data[i];
+
+    for (int i = 0; i < size2; ++i)
+        audio[start2 + i] = (float) data[size1 + i];
+
+    audioFifo.finishedWrite (size1 + size2);
+}
+
+bool VisualiserFeed::pullSnapshot (Snapshot& dest) noexcept
+{
+    const int numReady = snapshotFifo.getNumReady();
+
+    if (numReady == 0)
+        return false;
+
+    int start1, size1, start2, size2;
+    snapshotFifo.prepareToRead (numReady, start1, size1, start2, size2);
+
+    dest = snapshots[size2 > 0 ? start2 + size2 - 1 : start1 + size1 - 1];
+    snapshotFifo.finishedRead (size1 + size2);
+
+    return true;
+}
+
+int VisualiserFeed::pullAudio (float* dest, int maxSamples) noexcept
+{
+    int start1, size1, start2, size2;
+    audioFifo.prepareToRead (maxSamples, start1, size1, start2, size2);
+
+    std::copy (audio + start1, audio + start1 + size1, dest);
+    std::copy (audio + start2, audio + start2 + size2, dest + size1);
+
+    audioFifo.finishedRead (size1 + size2);
+    return size1 + size2;
+}
+
+template void VisualiserFeed::pushAudio<float> (const float*, int) noexcept;
+template void VisualiserFeed::pushAudio<double> (const double*, int) noexcept;
@@ -0,0 +1,77 @@
+/*
+  ==============================================================================
+
+    VisualiserFeed.h
+    What the audio thread hands the editor's grain and spectrum view.
+
+    Two wait-free single-producer single-consumer queues: one of voice
+    snapshots, pushed at most snapshotRateHz times a second, and one of
+    output samples from the first channel. Nothing is pushed unless a view
+    has registered, so a processor without an open editor pays one atomic
+    load per block. A full queue drops the newest data rather than wait.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "VoiceEngine.h"
+
+class VisualiserFeed
+{
+public:
+    static constexpr int snapshotRateHz = 60;
+    static constexpr int audioQueueSize = 8192;
+
+    /** Where every grain voice was at the end of a block. */
+    struct Snapshot
+    {
+        bool granular = true;
+        int numVoices = 0;
+        int windowShape = 0;
+        double windowMs = 0.0;
+        float phase[VoiceEngine::maxVoices] = {};
+        float gain[VoiceEngine::maxVoices] = {};
+    };
+
+    VisualiserFeed() = default;
+
+    /** Empties both queues. Call while the audio thread isn't running. */
+    void prepare (double sampleRate) noexcept;
+    double getSampleRate() const noexcept           { return sampleRate.load(); }
+
+    /** Views register while they're showing; pushes are skipped when none are. */
+    void addViewer() noexcept                       { ++numViewers; }
+    void removeViewer() noexcept                    { --numViewers; }
+    bool isActive() const noexcept                  { return numViewers.load() > 0; }
+
+    /** True once enough samples have gone by since the last snapshot. Audio thread. */
+    bool isSnapshotDue (int numSamples) noexcept;
+
+    void pushSnapshot (const Snapshot& snapshot) noexcept;
+
+    template <typename SampleType>
+    void pushAudio (const SampleType* data, int numSamples) noexcept;
+
+    /** Takes the newest queued snapshot, discarding older ones. Reader side only. */
+    bool pullSnapshot (Snapshot& dest) noexcept;
+
+    /** Takes up to maxSamples queued output samples, oldest first. Reader side only. */
+    int pullAudio (float* dest, int maxSamples) noexcept;
+
+private:
+    static constexpr int snapshotQueueSize = 16;
+
+    std::atomic<int> numViewers { 0 };
+    std::atomic<double> sampleRate { 44100.0 };
+    int samplesToSnapshot = 0;
+
+    juce::AbstractFifo snapshotFifo { snapshotQueueSize };
+    Snapshot snapshots[snapshotQueueSize];
+
+    juce::AbstractFifo audioFifo { audioQueueSize };
+    float audio[audioQueueSize] = {};
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (VisualiserFeed)
+};
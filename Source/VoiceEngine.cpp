@@ -0,0 +1,270 @@
+/*
+  ==============================================================================
+
+    VoiceEngine.cpp
+
+  ==============================================================================
+*/
+
+#include "VoiceEngine.h"
+
+#include <cmath>
+
+VoiceEngine::VoiceEngine()
+{
+    transpo.fill (0.0);
+    gain.fill (1.0f);
+    targetIncrement.fill (0.0);
+    currentIncrement.fill (0.0);
+    currentGain.fill (0.0f);
+    incrementRampLeft.fill (0);
+    gainRampLeft.fill (0);
+}
+
+void VoiceEngine::prepare (int newNumChannels, int newMaxBlockSize, double newSampleRate, int newNumLanes, bool doublePrecision)
+{
+    numChannels = newNumChannels;
+    numLanes = newNumLanes > 0 ? newNumLanes : 1;
+    maxBlockSize = newMaxBlockSize > 0 ? newMaxBlockSize : 1;
+    sampleRate = newSampleRate;
+
+    phase.assign ((size_t) numChannels * maxVoices, 0.0);
+    const auto scratchSize = (size_t) numLanes * numScratch * (size_t) maxBlockSize;
+    scratch.assign (doublePrecision ? 0 : scratchSize, 0.0f);
+    scratchDouble.assign (doublePrecision ? scratchSize : 0, 0.0);
+
+    setSmoothingTime (smoothingSeconds);
+    setWindowSize (requestedWindowMs);
+    snapWindow();
+}
+
+void VoiceEngine::reset() noexcept
+{
+    for (auto& p : phase)
+        p = 0.0;
+
+    for (int v = 0; v < maxVoices; ++v)
+    {
+        currentIncrement[(size_t) v] = targetIncrement[(size_t) v];
+        currentGain[(size_t) v] = v < numVoices ? gain[(size_t) v] : 0.0f;
+        incrementRampLeft[(size_t) v] = 0;
+        gainRampLeft[(size_t) v] = 0;
+    }
+
+    snapWindow();
+}
+
+void VoiceEngine::snapWindow() noexcept
+{
+    currentWindowSamps = windowSamps;
+    currentBaseDelay = baseDelay;
+    windowRampLeft = 0;
+}
+
+void VoiceEngine::setSmoothingTime (double seconds) noexcept
+{
+    smoothingSeconds = seconds;
+    smoothingSamples = (int) (seconds * sampleRate);
+}
+
+void VoiceEngine::setNumVoices (int newNumVoices) noexcept
+{
+    newNumVoices = newNumVoices < 1 ? 1 : (newNumVoices > maxVoices ? maxVoices : newNumVoices);
+
+    if (newNumVoices == numVoices)
+        return;
+
+    // voices joining or leaving fade in or out rather than switching
+    for (int v = 0; v < maxVoices; ++v)
+        if ((v < numVoices) != (v < newNumVoices))
+            gainRampLeft[(size_t) v] = smoothingSamples;
+
+    numVoices = newNumVoices;
+}
+
+void VoiceEngine::setTranspo (int voice, double semitones) noexcept
+{
+    if (transpo[(size_t) voice] == semitones)
+        return;
+
+    transpo[(size_t) voice] = semitones;
+    updateIncrement (voice);
+}
+
+void VoiceEngine::setGain (int voice, float newGain) noexcept
+{
+    if (gain[(size_t) voice] == newGain)
+        return;
+
+    gain[(size_t) voice] = newGain;
+    gainRampLeft[(size_t) voice] = smoothingSamples;
+}
+
+void VoiceEngine::setWindowSize (double newWindowMs) noexcept
+{
+    requestedWindowMs = newWindowMs;
+    windowMs = lowLatency && newWindowMs > lowLatencyMaxWindowMs ? lowLatencyMaxWindowMs : newWindowMs;
+
+    const double newWindowSamps = windowMs / 1000.0 * sampleRate;
+    const double newBaseDelay = lowLatency ? lowLatencyGuard : newWindowSamps;
+
+    // the taps glide to the new window over the smoothing time, or for as long as it
+    // takes to get there without any tap drifting faster than maxGlideRate. The
+    // phasors cancel the drift at mid-window (see beginBlock), which leaves at
+    // most half the window's change
+    if (newWindowSamps != windowSamps || newBaseDelay != baseDelay)
+    {
+        const double drift = 0.5 * std::abs (newWindowSamps - currentWindowSamps);
+        const double glideSamples = std::ceil (drift / maxGlideRate);
+        windowRampLeft = smoothingSamples > 0 && glideSamples > (double) smoothingSamples ? (int) glideSamples : smoothingSamples;
+    }
+
+    windowSamps = newWindowSamps;
+    baseDelay = newBaseDelay;
+
+    // the glide carries the phasors to their new rate as the window goes (see
+    // beginBlock), and a ramp of its own would only drag behind it
+    for (int v = 0; v < maxVoices; ++v)
+        updateIncrement (v, false);
+}
+
+void VoiceEngine::setLowLatency (bool shouldBeLowLatency, double guardSamples) noexcept
+{
+    if (lowLatency == shouldBeLowLatency && lowLatencyGuard == guardSamples)
+        return;
+
+    lowLatency = shouldBeLowLatency;
+    lowLatencyGuard = guardSamples;
+    setWindowSize (requestedWindowMs);
+
+    // switching mode changes the latency the host compensates for, so there's no gliding across it
+    snapWindow();
+}
+
+bool VoiceEngine::isStatic() const noexcept
+{
+    for (int v = 0; v < maxVoices; ++v)
+    {
+        const auto i = (size_t) v;
+        const bool audible = v < numVoices || currentGain[i] > 0.0f || gainRampLeft[i] > 0;
+
+        if (audible && (targetIncrement[i] != 0.0 || currentIncrement[i] != 0.0 || incrementRampLeft[i] > 0))
+            return false;
+    }
+
+    return true;
+}
+
+void VoiceEngine::updateIncrement (int voice, bool shouldRamp) noexcept
+{
+    auto target = GrainKernel::transpoToPhasorFreq (transpo[(size_t) voice], windowMs) / sampleRate;
+
+    if (targetIncrement[(size_t) voice] == target)
+        return;
+
+    targetIncrement[(size_t) voice] = target;
+
+    if (shouldRamp)
+        incrementRampLeft[(size_t) voice] = smoothingSamples;
+}
+
+void VoiceEngine::beginBlock (int startSample, int numSamples, const float* window, Segment& segment,
+                              float outputGainStart, float outputGainEnd) noexcept
+{
+    segment.startSample = startSample;
+    segment.numSamples = numSamples > 0 ? numSamples : 0;
+    segment.windowSamps = currentWindowSamps;
+    segment.windowStep = 0.0;
+    segment.baseDelay = currentBaseDelay;
+    segment.baseDelayStep = 0.0;
+    segment.window = window;
+
+    if (numSamples <= 0)
+    {
+        segment.audible.fill (false);
+        return;
+    }
+
+    // the window glides the same way the voice ramps below do
+    const bool windowGliding = windowRampLeft > 0;
+
+    if (windowGliding)
+    {
+        const int len = windowRampLeft > numSamples ? windowRampLeft : numSamples;
+        segment.windowStep = (windowSamps - currentWindowSamps) / len;
+        segment.baseDelayStep = (baseDelay - currentBaseDelay) / len;
+        windowRampLeft = windowRampLeft > numSamples ? windowRampLeft - numSamples : 0;
+
+        currentWindowSamps = windowRampLeft > 0 ? currentWindowSamps + segment.windowStep * numSamples : windowSamps;
+        currentBaseDelay = windowRampLeft > 0 ? currentBaseDelay + segment.baseDelayStep * numSamples : baseDelay;
+    }
+    else
+    {
+        // with no smoothing a new size never starts a glide, so catch up here
+        snapWindow();
+        segment.windowSamps = windowSamps;
+        segment.baseDelay = baseDelay;
+    }
+
+    // a tap's delay is baseDelay + phasor * windowSamps, so on average the glide moves it this much per sample
+    const double glideDrift = (segment.baseDelayStep + 0.5 * segment.windowStep) / currentWindowSamps;
+
+    for (int v = 0; v < maxVoices; ++v)
+    {
+        const auto i = (size_t) v;
+        const float targetGain = v < numVoices ? gain[i] : 0.0f;
+
+        // a ramp that would finish mid-run is stretched to the end of the run,
+        // so each segment needs a single start value and a single step
+        segment.increment[i] = currentIncrement[i];
+        segment.incrementStep[i] = 0.0;
+
+        // the target increment belongs to the target window; while the window
+        // glides it's scaled to where the window will be at the end of this
+        // run, and the phasors run against the glide's drift at mid-window,
+        // so the taps read at the rate the transposition asks for on average
+        const double target = windowGliding ? targetIncrement[i] * windowSamps / currentWindowSamps - glideDrift
+                                            : targetIncrement[i];
+
+        if (incrementRampLeft[i] > 0 || windowGliding)
+        {
+            const int len = incrementRampLeft[i] > numSamples ? incrementRampLeft[i] : numSamples;
+            segment.incrementStep[i] = (target - currentIncrement[i]) / len;
+            incrementRampLeft[i] = incrementRampLeft[i] > numSamples ? incrementRampLeft[i] - numSamples : 0;
+        }
+        else
+        {
+            segment.increment[i] = targetIncrement[i];
+        }
+
+        currentIncrement[i] = incrementRampLeft[i] > 0 ? segment.increment[i] + segment.incrementStep[i] * numSamples
+                                                       : target;
+
+        segment.gain[i] = currentGain[i];
+        segment.gainStep[i] = 0.0f;
+
+        if (gainRampLeft[i] > 0)
+        {
+            const int len = gainRampLeft[i] > numSamples ? gainRampLeft[i] : numSamples;
+            segment.gainStep[i] = (targetGain - currentGain[i]) / (float) len;
+            gainRampLeft[i] = gainRampLeft[i] > numSamples ? gainRampLeft[i] - numSamples : 0;
+        }
+        else
+        {
+            segment.gain[i] = targetGain;
+        }
+
+        currentGain[i] = gainRampLeft[i] > 0 ? segment.gain[i] + segment.gainStep[i] * (float) numSamples
+                                             : targetGain;
+
+        // the product of the two ramps is bent, but over one run the straight line is inaudibly close
+        if (outputGainStart != 1.0f || outputGainEnd != 1.0f)
+        {
+            const float endGain = (segment.gain[i] + segment.gainStep[i] * (float) numSamples) * outputGainEnd;
+            segment.gain[i] *= outputGainStart;
+            segment.gainStep[i] = (endGain - segment.gain[i]) / (float) numSamples;
+        }
+
+        segment.audible[i] = segment.gain[i] != 0.0f || segment.gainStep[i] != 0.0f;
+    }
+}
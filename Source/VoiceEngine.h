@@ -0,0 +1,339 @@
+/*
+  ==============================================================================
+
+    VoiceEngine.h
+    N-voice grain harmoniser.
+
+    Every voice is a sawtooth phasor with two taps into the shared input
+    history. Voice parameters are kept as structure-of-arrays so the per-block
+    setup is a tight loop over plain arrays, and all voices of a channel are
+    rendered against the same history read position, window table and output
+    row before moving on to the next channel.
+
+    Each tap normally reads a full window behind the write head plus its own
+    sweep. In low-latency mode the taps sweep straight back from the write
+    head instead, and the window is capped, so the delay is set by the grain
+    length alone.
+
+    A voice at zero transposition has a phasor that stands still, so its taps
+    are fixed delays at fixed envelope levels. process() renders those as
+    plain delayed copies and skips any tap whose envelope is zero; after a
+    reset that leaves a single tap half a window back.
+
+    Parameter setters only move targets. beginBlock() turns those targets into
+    per-sample linear ramps for the coming run of samples and records them in a
+    Segment, so every channel sees the same smoothed trajectory and nothing is
+    allocated on the audio thread. That includes the window length: a new size
+    glides the taps' sweep and base delay instead of making every tap jump,
+    so window sweeps don't click. The phasors follow the window as it goes,
+    so the transposition holds, and the glide takes the smoothing time or,
+    for a big jump, long enough that no tap drifts faster than maxGlideRate.
+    A run with no glide in progress takes the same path as before.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "GrainKernel.h"
+#include "GrainWindow.h"
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+class VoiceEngine
+{
+public:
+    static constexpr int maxVoices = 16;
+
+    /** Longest window used in low-latency mode. */
+    static constexpr double lowLatencyMaxWindowMs = 12.0;
+
+    /** Fastest a tap may drift from its proper read rate while the window
+        glides, in samples per sample. The drift bends the tap's pitch by the
+        same fraction, so 1/8 keeps it within about two semitones.
+    */
+    static constexpr double maxGlideRate = 0.125;
+
+    VoiceEngine();
+
+    /** Allocates per-channel phase state and block scratch. Not real-time safe.
+        numLanes is the number of threads that may call process() at once; each
+        gets its own scratch rows. Scratch is only allocated for the precision
+        process() will be called with.
+    */
+    void prepare (int numChannels, int maxBlockSize, double sampleRate, int numLanes = 1, bool doublePrecision = false);
+
+    /** Restarts every phasor at zero and snaps all ramps to their targets. */
+    void reset() noexcept;
+
+    /** Length of the parameter ramps. Defaults to 50 ms. */
+    void setSmoothingTime (double seconds) noexcept;
+
+    void setNumVoices (int newNumVoices) noexcept;
+    int getNumVoices() const noexcept               { return numVoices; }
+
+    void setTranspo (int voice, double semitones) noexcept;
+    double getTranspo (int voice) const noexcept    { return transpo[(size_t) voice]; }
+
+    void setGain (int voice, float newGain) noexcept;
+    float getGain (int voice) const noexcept        { return gain[(size_t) voice]; }
+
+    void setWindowSize (double windowMs) noexcept;
+    double getWindowSizeMs() const noexcept         { return windowMs; }
+
+    /** Where a voice's first tap is in its grain, in [0, 1). Only meaningful between blocks. */
+    double getPhase (int channel, int voice) const noexcept     { return phase[(size_t) channel * maxVoices + (size_t) voice]; }
+
+    /** True when every voice that can be heard has a standing phasor, i.e. the
+        engine is rendering plain delayed copies.
+    */
+    bool isStatic() const noexcept;
+    double getWindowSizeSamples() const noexcept    { return windowSamps; }
+
+    /** guardSamples is how far behind the write head the taps start in
+        low-latency mode; it must cover the tap reader's lookahead.
+    */
+    void setLowLatency (bool shouldBeLowLatency, double guardSamples = 2.0) noexcept;
+    bool isLowLatency() const noexcept              { return lowLatency; }
+
+    /** Window-weighted mean delay of the taps, which is what the host should
+        compensate for. The windows are symmetric, so that's the centre of the sweep.
+        Reports where a window glide is heading, not where it is.
+    */
+    double getLatencySamples() const noexcept       { return baseDelay + 0.5 * windowSamps; }
+
+    /** Longest delay any tap reads at, i.e. how long input keeps sounding.
+        While the window glides shorter the taps still reach as far back as
+        where it is now, not where it's heading.
+    */
+    double getTailSamples() const noexcept
+    {
+        const double target = baseDelay + windowSamps;
+        const double current = currentBaseDelay + currentWindowSamps;
+        return current > target ? current : target;
+    }
+
+    /** One run of samples rendered with a single set of parameter ramps.
+        beginBlock() fills it in and process() replays it for each channel, so
+        channels can be rendered in any order and on any thread.
+    */
+    struct Segment
+    {
+        int startSample = 0;
+        int numSamples = 0;
+        double windowSamps = 0.0;
+        double windowStep = 0.0;        // per sample, while the window glides
+        double baseDelay = 0.0;
+        double baseDelayStep = 0.0;
+        const float* window = nullptr;
+
+        bool isGliding() const noexcept     { return windowStep != 0.0 || baseDelayStep != 0.0; }
+
+        std::array<double, maxVoices> increment;
+        std::array<double, maxVoices> incrementStep;
+        std::array<float, maxVoices> gain;
+        std::array<float, maxVoices> gainStep;
+        std::array<bool, maxVoices> audible;
+    };
+
+    /** Advances the parameter ramps by numSamples and records this run's
+        trajectory in segment. Call once per run, from one thread. The output
+        gain ramp, which goes from outputGainStart to outputGainEnd across
+        the run, is folded into every voice's gain, so process() writes the
+        final level in its one pass.
+    */
+    void beginBlock (int startSample, int numSamples, const float* window, Segment& segment,
+                     float outputGainStart = 1.0f, float outputGainEnd = 1.0f) noexcept;
+
+    /** Writes the sum of every audible voice of a segment for one channel to
+        dest[segment.startSample ... segment.startSample + segment.numSamples).
+        The first voice overwrites whatever was there, so dest needn't be cleared.
+
+        readTaps is called as readTaps (channel, baseReadPos, delays, out, numSamples)
+        and must fill out[i] with the history sample at baseReadPos + i, a further
+        delays[i] samples back. Read positions are relative to the start of the
+        host block, so sub-blocks line up with the history that was written.
+        It is called twice per voice per chunk.
+
+        Different channels may be processed concurrently as long as each thread
+        uses its own lane. SampleType must match the precision given to prepare().
+    */
+    template <typename SampleType, typename TapReader>
+    void process (int channel, int lane, SampleType* dest, const Segment& segment, TapReader&& readTaps) noexcept
+    {
+        auto* phasorA = getScratch<SampleType> (lane, phasorAScratch);
+        auto* phasorB = getScratch<SampleType> (lane, phasorBScratch);
+        auto* envA    = getScratch<SampleType> (lane, envAScratch);
+        auto* envB    = getScratch<SampleType> (lane, envBScratch);
+        auto* delayA  = getScratch<SampleType> (lane, delayAScratch);
+        auto* delayB  = getScratch<SampleType> (lane, delayBScratch);
+        auto* tapA    = getScratch<SampleType> (lane, tapAScratch);
+        auto* tapB    = getScratch<SampleType> (lane, tapBScratch);
+
+        auto* channelPhase = phase.data() + (size_t) channel * maxVoices;
+        const int numSamples = segment.numSamples;
+
+        for (int start = 0; start < numSamples; start += maxBlockSize)
+        {
+            const int num = numSamples - start < maxBlockSize ? numSamples - start : maxBlockSize;
+            const int blockPos = segment.startSample + start;
+            const double baseReadPos = blockPos - (segment.baseDelay + segment.baseDelayStep * start);
+            const double windowSamps = segment.windowSamps + segment.windowStep * start;
+
+            auto* out = dest + blockPos;
+            bool written = false;
+
+            for (int v = 0; v < maxVoices; ++v)
+            {
+                const auto i = (size_t) v;
+
+                if (! segment.audible[i])
+                    continue;
+
+                const auto inc  = segment.increment[i] + segment.incrementStep[i] * start;
+                const auto gain = (SampleType) (segment.gain[i] + segment.gainStep[i] * (float) start);
+
+                if (inc == 0.0 && segment.incrementStep[i] == 0.0)
+                {
+                    const double phaseA = channelPhase[v];
+                    const double phaseB = phaseA + 0.5 < 1.0 ? phaseA + 0.5 : phaseA - 0.5;
+
+                    written |= addStaticTap (out, ! written, channel, baseReadPos, phaseA, windowSamps, segment, gain, segment.gainStep[i], delayA, tapA, num, readTaps);
+                    written |= addStaticTap (out, ! written, channel, baseReadPos, phaseB, windowSamps, segment, gain, segment.gainStep[i], delayB, tapB, num, readTaps);
+                    continue;
+                }
+
+                channelPhase[v] = GrainKernel::fillPhasor (phasorA, channelPhase[v], inc, segment.incrementStep[i], num);
+                GrainKernel::offsetPhasor (phasorB, phasorA, num);
+
+                GrainWindow::fill (envA, phasorA, num, segment.window);
+                GrainWindow::fill (envB, phasorB, num, segment.window);
+
+                if (segment.isGliding())
+                {
+                    GrainKernel::glideDelay (delayA, phasorA, windowSamps, segment.windowStep, segment.baseDelayStep, num);
+                    GrainKernel::glideDelay (delayB, phasorB, windowSamps, segment.windowStep, segment.baseDelayStep, num);
+                }
+                else
+                {
+                    GrainKernel::scale (delayA, phasorA, (SampleType) windowSamps, num);
+                    GrainKernel::scale (delayB, phasorB, (SampleType) windowSamps, num);
+                }
+
+                readTaps (channel, baseReadPos, delayA, tapA, num);
+                readTaps (channel, baseReadPos, delayB, tapB, num);
+
+                GrainKernel::mixTaps (out, tapA, envA, tapB, envB, gain, (SampleType) segment.gainStep[i], num, ! written);
+                written = true;
+            }
+
+            // nothing audible: the run is silence, which still has to be written
+            if (! written)
+                for (int n = 0; n < num; ++n)
+                    out[n] = (SampleType) 0;
+        }
+    }
+
+private:
+    /** One tap of a voice whose phasor isn't moving: a delayed copy at the
+        envelope level for its phase, or nothing at all where that level is zero.
+        Returns whether it wrote anything.
+    */
+    template <typename SampleType, typename TapReader>
+    static bool addStaticTap (SampleType* dest, bool overwrite, int channel, double baseReadPos, double phase, double windowSamps,
+                              const Segment& segment, SampleType gain, float gainStep, SampleType* delays, SampleType* taps,
+                              int numSamples, TapReader& readTaps) noexcept
+    {
+        const auto level = (SampleType) GrainWindow::lookup (segment.window, phase);
+
+        if (level <= (SampleType) 0)
+            return false;
+
+        // a gliding window still moves a standing tap, since its delay is a fraction of the window
+        const auto delay = phase * windowSamps;
+        const auto delayStep = phase * segment.windowStep + segment.baseDelayStep;
+
+        for (int i = 0; i < numSamples; ++i)
+            delays[i] = (SampleType) (delay + delayStep * i);
+
+        readTaps (channel, baseReadPos, delays, taps, numSamples);
+        GrainKernel::addScaled (dest, taps, gain * level, (SampleType) gainStep * level, numSamples, overwrite);
+        return true;
+    }
+
+    enum Scratch
+    {
+        phasorAScratch = 0,
+        phasorBScratch,
+        envAScratch,
+        envBScratch,
+        delayAScratch,
+        delayBScratch,
+        tapAScratch,
+        tapBScratch,
+        numScratch
+    };
+
+    void updateIncrement (int voice, bool shouldRamp = true) noexcept;
+    void snapWindow() noexcept;
+
+    template <typename SampleType>
+    SampleType* getScratch (int lane, int row) noexcept;
+
+    static size_t getScratchOffset (int lane, int row, int blockSize) noexcept
+    {
+        return ((size_t) lane * numScratch + (size_t) row) * (size_t) blockSize;
+    }
+
+    int numChannels = 0;
+    int numLanes = 1;
+    int numVoices = 2;
+    int maxBlockSize = 0;
+    int smoothingSamples = 0;
+    double smoothingSeconds = 0.05;
+    double sampleRate = 44100.0;
+    double requestedWindowMs = 50.0;
+    double windowMs = 50.0;
+    double windowSamps = 0.0;
+    double baseDelay = 0.0;
+    double lowLatencyGuard = 2.0;
+    bool lowLatency = false;
+
+    // where the window glide is; windowSamps and baseDelay are its targets
+    double currentWindowSamps = 0.0;
+    double currentBaseDelay = 0.0;
+    int windowRampLeft = 0;
+
+    // per-voice targets, structure-of-arrays
+    std::array<double, maxVoices> transpo;
+    std::array<float, maxVoices> gain;
+    std::array<double, maxVoices> targetIncrement;
+
+    // per-voice ramp state; current* is where the last block ended up
+    std::array<double, maxVoices> currentIncrement;
+    std::array<float, maxVoices> currentGain;
+    std::array<int, maxVoices> incrementRampLeft;
+    std::array<int, maxVoices> gainRampLeft;
+
+    // phase per channel per voice, laid out [channel * maxVoices + voice]
+    std::vector<double> phase;
+
+    // numLanes sets of numScratch rows, each maxBlockSize long, in whichever
+    // precision was prepared
+    std::vector<float> scratch;
+    std::vector<double> scratchDouble;
+};
+
+template <>
+inline float* VoiceEngine::getScratch<float> (int lane, int row) noexcept
+{
+    return scratch.data() + getScratchOffset (lane, row, maxBlockSize);
+}
+
+template <>
+inline double* VoiceEngine::getScratch<double> (int lane, int row) noexcept
+{
+    return scratchDouble.data() + getScratchOffset (lane, row, maxBlockSize);
+}
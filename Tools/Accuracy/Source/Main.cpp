@@ -0,0 +1,470 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+    pitchshifter-accuracy - checks the optimised engine against Reference.h.
+
+    Renders the same test signal through every optimised path and through
+    the naive reference, across the factory presets, window sizes, block
+    sizes, window shapes, interpolators and latency modes, and prints one
+    CSV row per configuration:
+
+        path,preset,window_ms,block,shape,interp,low_latency,mix,max_err,rms_err,snr_db,result
+
+    The paths are ShifterCore in float and double, float rendered one
+    channel per lane as the processor's worker pool does, and the C API.
+    Errors are against the reference, relative to full scale; snr_db is
+    reference power over error power. A row fails when the SNR or the
+    largest error is outside the path's tolerance, and any failure makes
+    the exit code non-zero, so sign-off on performance work is a clean
+    exit from both pitchshifter-accuracy and pitchshifter-accuracy-scalar,
+    which is the same check built with PITCHSHIFTER_FORCE_SCALAR.
+
+    After the table, every interpolator in both precisions reads the history
+    a hair short of each whole sample and is checked against the read at the
+    whole sample, where the fraction rounds up to 1 in float. Run under
+    AddressSanitizer, this also catches a read past the sinc table.
+
+        pitchshifter-accuracy [--seconds <s>] [--quick] [--out <file.csv>]
+
+  ==============================================================================
+*/
+
+#include "Reference.h"
+#include "../../../Source/ShifterCore.h"
+#include "../../../Source/PitchShifterApi.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <type_traits>
+
+//==============================================================================
+struct Tolerance
+{
+    double minSnrDb;
+    double maxError;
+};
+
+// Double is limited by the window tables. Float also loses delay precision on
+// long windows, where a tap sits thousands of samples back; at 300 ms that
+// brings the upper partials of the test signal down to about 78 dB.
+static constexpr Tolerance floatTolerance  { 72.0, 5.0e-4 };
+static constexpr Tolerance doubleTolerance { 100.0, 2.0e-5 };
+
+enum Path
+{
+    floatPath = 0,
+    doublePath,
+    lanePath,
+    apiPath
+};
+
+static const char* getPathName (Path path)
+{
+    switch (path)
+    {
+        case doublePath:    return "double";
+        case lanePath:      return "lanes";
+        case apiPath:       return "c_api";
+        case floatPath:
+        default:            return "float";
+    }
+}
+
+struct Preset
+{
+    const char* name;
+    double transpoOne;
+    double transpoTwo;
+};
+
+// the processor's factory presets, which only set the first two transpositions
+static const Preset presets[] = {
+    { "nice", 0.0, 7.5 },
+    { "weird", -12.0, 12.0 },
+    { "scary", 0.0, -6.5 }
+};
+
+struct Config
+{
+    Path path;
+    int preset;
+    ShifterSettings settings;
+    int blockSize;      // 0 cycles through uneven sizes, as some hosts send
+};
+
+static constexpr int maxBlockSize = 4096;
+static constexpr int numChannels = 2;
+
+//==============================================================================
+static Signal makeTestSignal (double sampleRate, double seconds)
+{
+    const auto numSamples = (size_t) (seconds * sampleRate);
+    Signal signal ((size_t) numChannels, std::vector<double> (numSamples));
+
+    // a few partials from bass to near the top of the band, and some noise for the interpolators
+    const double freqs[numChannels][4] = { { 110.0, 440.0, 1760.0, 7040.0 }, { 97.0, 523.0, 2637.0, 11025.0 } };
+    uint32_t noise = 12345;
+
+    for (size_t n = 0; n < numSamples; ++n)
+    {
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            double value = 0.0;
+
+            for (int k = 0; k < 4; ++k)
+                value += 0.2 / (k + 1) * std::sin (2.0 * 3.14159265358979323846 * freqs[channel][k] * (double) n / sampleRate);
+
+            noise = noise * 1664525u + 1013904223u;
+            value += 0.05 * ((double) (noise >> 8) / (double) (1u << 24) - 0.5);
+
+            signal[(size_t) channel][n] = value;
+        }
+    }
+
+    return signal;
+}
+
+static int getBlockSize (int pattern, int blockIndex)
+{
+    static const int uneven[] = { 1, 37, 512, 64, 4096, 333, 7, 2048, 129 };
+    return pattern > 0 ? pattern : uneven[(size_t) blockIndex % (sizeof (uneven) / sizeof (uneven[0]))];
+}
+
+//==============================================================================
+static void applySettings (ShifterCore& core, const ShifterSettings& settings)
+{
+    core.setNumVoices (settings.numVoices);
+    core.setWindowSize (settings.windowMs);
+    core.setWindowShape ((GrainWindow::Shape) settings.windowShape);
+    core.setInterpolation ((Interpolation::Type) settings.interpolation);
+    core.setLowLatency (settings.lowLatency);
+    core.setMix ((float) settings.mix);
+    core.setOutputGain ((float) settings.outputGain);
+
+    for (int voice = 0; voice < ShifterSettings::maxVoices; ++voice)
+    {
+        core.setTranspo (voice, settings.transpo[voice]);
+        core.setGain (voice, (float) settings.gain[voice]);
+    }
+
+    // land every ramp, as prepareToPlay does
+    core.reset();
+}
+
+template <typename SampleType>
+static Signal renderCore (const Config& config, const Signal& input, int numLanes)
+{
+    const auto numSamples = input[0].size();
+
+    ShifterCore core;
+    core.prepare (numChannels, maxBlockSize, config.settings.sampleRate, numLanes, std::is_same<SampleType, double>::value);
+    applySettings (core, config.settings);
+
+    std::vector<std::vector<SampleType>> buffers ((size_t) numChannels, std::vector<SampleType> ((size_t) maxBlockSize));
+    SampleType* channels[numChannels];
+    Signal output ((size_t) numChannels, std::vector<double> (numSamples));
+
+    for (int channel = 0; channel < numChannels; ++channel)
+        channels[channel] = buffers[(size_t) channel].data();
+
+    size_t pos = 0;
+
+    for (int blockIndex = 0; pos < numSamples; ++blockIndex)
+    {
+        const int blockSize = (int) std::min ((size_t) getBlockSize (config.blockSize, blockIndex), numSamples - pos);
+
+        for (int channel = 0; channel < numChannels; ++channel)
+            for (int i = 0; i < blockSize; ++i)
+                channels[channel][i] = (SampleType) input[(size_t) channel][pos + (size_t) i];
+
+        if (numLanes == 1)
+        {
+            core.process (channels, channels, blockSize);
+        }
+        else
+        {
+            // planned once, then each channel rendered from its own lane
+            core.writeHistory (channels, blockSize);
+
+            for (int start = 0; start < blockSize; start += ShifterCore::runLength)
+                core.addRun (start, std::min (ShifterCore::runLength, blockSize - start));
+
+            for (int channel = 0; channel < numChannels; ++channel)
+                core.renderChannel (channel, channel % numLanes, channels[channel]);
+
+            core.clearRuns();
+        }
+
+        for (int channel = 0; channel < numChannels; ++channel)
+            for (int i = 0; i < blockSize; ++i)
+                output[(size_t) channel][pos + (size_t) i] = (double) channels[channel][i];
+
+        pos += (size_t) blockSize;
+    }
+
+    return output;
+}
+
+static Signal renderApi (const Config& config, const Signal& input)
+{
+    const auto numSamples = input[0].size();
+    const auto& settings = config.settings;
+
+    auto* shifter = pitchshifter_create();
+    pitchshifter_prepare (shifter, settings.sampleRate, numChannels, maxBlockSize);
+    pitchshifter_set_num_voices (shifter, settings.numVoices);
+    pitchshifter_set_window_size (shifter, (float) settings.windowMs);
+    pitchshifter_set_window_shape (shifter, settings.windowShape);
+    pitchshifter_set_interpolation (shifter, settings.interpolation);
+    pitchshifter_set_low_latency (shifter, settings.lowLatency ? 1 : 0);
+    pitchshifter_set_mix (shifter, (float) (settings.mix * 100.0));
+    pitchshifter_set_output_gain (shifter, (float) (20.0 * std::log10 (settings.outputGain)));
+
+    for (int voice = 0; voice < ShifterSettings::maxVoices; ++voice)
+        pitchshifter_set_voice (shifter, voice, (float) settings.transpo[voice], (float) (20.0 * std::log10 (settings.gain[voice])));
+
+    pitchshifter_reset (shifter);
+
+    // the API chunks to its own block size, so the whole signal goes in at once
+    std::vector<float> interleaved (numSamples * numChannels);
+
+    for (size_t n = 0; n < numSamples; ++n)
+        for (int channel = 0; channel < numChannels; ++channel)
+            interleaved[n * numChannels + (size_t) channel] = (float) input[(size_t) channel][n];
+
+    pitchshifter_process_interleaved (shifter, interleaved.data(), interleaved.data(), (int) numSamples);
+    pitchshifter_destroy (shifter);
+
+    Signal output ((size_t) numChannels, std::vector<double> (numSamples));
+
+    for (size_t n = 0; n < numSamples; ++n)
+        for (int channel = 0; channel < numChannels; ++channel)
+            output[(size_t) channel][n] = (double) interleaved[n * numChannels + (size_t) channel];
+
+    return output;
+}
+
+//==============================================================================
+struct Result
+{
+    double maxError;
+    double rmsError;
+    double snrDb;
+    bool passed;
+};
+
+static Result compare (const Config& config, const Signal& reference, const Signal& output)
+{
+    double maxError = 0.0, errorPower = 0.0, signalPower = 0.0;
+    size_t count = 0;
+
+    for (size_t channel = 0; channel < reference.size(); ++channel)
+    {
+        for (size_t n = 0; n < reference[channel].size(); ++n)
+        {
+            const double error = output[channel][n] - reference[channel][n];
+            maxError = std::max (maxError, std::abs (error));
+            errorPower += error * error;
+            signalPower += reference[channel][n] * reference[channel][n];
+            ++count;
+        }
+    }
+
+    const auto tolerance = config.path == doublePath ? doubleTolerance : floatTolerance;
+
+    Result result;
+    result.maxError = maxError;
+    result.rmsError = std::sqrt (errorPower / (double) std::max<size_t> (1, count));
+    result.snrDb = errorPower > 0.0 ? 10.0 * std::log10 (signalPower / errorPower) : 999.0;
+    result.passed = result.snrDb >= tolerance.minSnrDb && maxError <= tolerance.maxError;
+    return result;
+}
+
+//==============================================================================
+template <typename SampleType>
+static double checkWholeSampleEdge (Interpolation::Type type)
+{
+    constexpr int blockSize = 256;
+    DelayLine<SampleType> line;
+    line.prepare (1, blockSize, blockSize);
+
+    std::vector<SampleType> block ((size_t) blockSize);
+
+    for (int n = 0; n < blockSize; ++n)
+        block[(size_t) n] = (SampleType) std::sin (0.05 * n);
+
+    const SampleType* channels[] = { block.data() };
+    line.write (channels, 1, blockSize);
+
+    const SampleType noDelay = 0;
+    double maxError = 0.0;
+
+    // far enough inside the block for the widest interpolator either side
+    for (int whole = 32; whole < blockSize - 32; ++whole)
+    {
+        SampleType justBelow, at;
+        line.readInterpBlock (0, std::nextafter ((double) whole, 0.0), &noDelay, &justBelow, 1, type);
+        line.readInterpBlock (0, (double) whole, &noDelay, &at, 1, type);
+        maxError = std::max (maxError, std::abs ((double) justBelow - (double) at));
+    }
+
+    return maxError;
+}
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    double secondsOfAudio = 1.0;
+    bool quick = false;
+    const char* outputPath = nullptr;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp (argv[i], "--seconds") == 0 && i + 1 < argc)    secondsOfAudio = std::atof (argv[++i]);
+        else if (std::strcmp (argv[i], "--quick") == 0)                 quick = true;
+        else if (std::strcmp (argv[i], "--out") == 0 && i + 1 < argc)   outputPath = argv[++i];
+        else
+        {
+            std::fprintf (stderr, "usage: pitchshifter-accuracy [--seconds <s>] [--quick] [--out <file.csv>]\n");
+            return 1;
+        }
+    }
+
+    if (quick)
+        secondsOfAudio = std::min (secondsOfAudio, 0.25);
+
+    const double sampleRate = 48000.0;
+    const auto input = makeTestSignal (sampleRate, secondsOfAudio);
+
+    std::vector<int> windows { 5, 50, 150, 300 };
+    std::vector<int> blockSizes { 1, 64, 441, 4096, 0 };
+
+    if (quick)
+    {
+        windows = { 5, 300 };
+        blockSizes = { 1, 441, 0 };
+    }
+
+    auto makeConfig = [sampleRate] (Path path, int preset, double windowMs, int blockSize)
+    {
+        Config config { path, preset, {}, blockSize };
+        config.settings.sampleRate = sampleRate;
+        config.settings.windowMs = windowMs;
+        config.settings.transpo[0] = presets[preset].transpoOne;
+        config.settings.transpo[1] = presets[preset].transpoTwo;
+        return config;
+    };
+
+    std::vector<Config> configs;
+
+    // every preset, window and block size through the two main precisions
+    for (auto path : { floatPath, doublePath })
+        for (int preset = 0; preset < 3; ++preset)
+            for (auto windowMs : windows)
+                for (auto blockSize : blockSizes)
+                    configs.push_back (makeConfig (path, preset, windowMs, blockSize));
+
+    // every shape, interpolator and latency mode at one setting
+    for (auto path : { floatPath, doublePath })
+        for (int shape = 0; shape < GrainWindow::numShapes; ++shape)
+            for (int interpolation = 0; interpolation < Interpolation::numTypes; ++interpolation)
+                for (bool lowLatency : { false, true })
+                {
+                    auto config = makeConfig (path, 0, 50.0, 441);
+                    config.settings.windowShape = shape;
+                    config.settings.interpolation = interpolation;
+                    config.settings.lowLatency = lowLatency;
+                    configs.push_back (config);
+                }
+
+    // the other ways in, and a half-wet mix with output gain, which brings in the dry path
+    for (auto path : { floatPath, doublePath, lanePath, apiPath })
+        for (int preset = 0; preset < 3; ++preset)
+            for (double mix : { 1.0, 0.5 })
+            {
+                if (mix == 1.0 && (path == floatPath || path == doublePath))
+                    continue;
+
+                auto config = makeConfig (path, preset, 50.0, path == apiPath ? maxBlockSize : 0);
+                config.settings.mix = mix;
+                config.settings.outputGain = mix < 1.0 ? 0.5 : 1.0;
+                configs.push_back (config);
+            }
+
+    FILE* csv = outputPath != nullptr ? std::fopen (outputPath, "w") : nullptr;
+    const char* header = "path,preset,window_ms,block,shape,interp,low_latency,mix,max_err,rms_err,snr_db,result";
+
+    std::printf ("%s\n", header);
+
+    if (csv != nullptr)
+        std::fprintf (csv, "%s\n", header);
+
+    int numFailed = 0;
+    double worstSnr = 1.0e9;
+
+    for (const auto& config : configs)
+    {
+        const auto reference = Reference::render (config.settings, input);
+        Signal output;
+
+        switch (config.path)
+        {
+            case doublePath:    output = renderCore<double> (config, input, 1); break;
+            case lanePath:      output = renderCore<float> (config, input, 2); break;
+            case apiPath:       output = renderApi (config, input); break;
+            case floatPath:
+            default:            output = renderCore<float> (config, input, 1); break;
+        }
+
+        const auto result = compare (config, reference, output);
+        numFailed += result.passed ? 0 : 1;
+        worstSnr = std::min (worstSnr, result.snrDb);
+
+        const auto& settings = config.settings;
+        char row[512];
+        std::snprintf (row, sizeof (row), "%s,%s,%.0f,%s,%s,%s,%d,%.2f,%.3e,%.3e,%.1f,%s",
+                       getPathName (config.path), presets[config.preset].name, settings.windowMs,
+                       config.blockSize > 0 ? std::to_string (config.blockSize).c_str() : "uneven",
+                       GrainWindow::getName ((GrainWindow::Shape) settings.windowShape),
+                       Interpolation::getName ((Interpolation::Type) settings.interpolation),
+                       settings.lowLatency ? 1 : 0, settings.mix,
+                       result.maxError, result.rmsError, result.snrDb, result.passed ? "pass" : "FAIL");
+
+        std::printf ("%s\n", row);
+
+        if (csv != nullptr)
+            std::fprintf (csv, "%s\n", row);
+    }
+
+    if (csv != nullptr)
+        std::fclose (csv);
+
+    int numEdgeChecks = 0;
+
+    for (int interpolation = 0; interpolation < Interpolation::numTypes; ++interpolation)
+    {
+        const auto type = (Interpolation::Type) interpolation;
+
+        for (auto path : { floatPath, doublePath })
+        {
+            const double maxError = path == doublePath ? checkWholeSampleEdge<double> (type) : checkWholeSampleEdge<float> (type);
+            const bool passed = maxError <= (path == doublePath ? doubleTolerance : floatTolerance).maxError;
+
+            std::printf ("whole-sample edge,%s,%s,%.3e,%s\n", getPathName (path), Interpolation::getName (type),
+                         maxError, passed ? "pass" : "FAIL");
+
+            numFailed += passed ? 0 : 1;
+            ++numEdgeChecks;
+        }
+    }
+
+    std::printf ("%d of %d configurations within tolerance, worst SNR %.1f dB\n",
+                 (int) configs.size() + numEdgeChecks - numFailed, (int) configs.size() + numEdgeChecks, worstSnr);
+
+    return numFailed == 0 ? 0 : 1;
+}
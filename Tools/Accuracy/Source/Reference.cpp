@@ -0,0 +1,151 @@
+/*
+  ==============================================================================
+
+    Reference.cpp
+
+  ==============================================================================
+*/
+
+#include "Reference.h"
+
+#include <cmath>
+
+namespace
+{
+    constexpr double pi = 3.14159265358979323846;
+
+    double window (int shape, double p)
+    {
+        const double edge = p < 0.5 ? p : 1.0 - p;
+
+        switch (shape)
+        {
+            case 1:     return 0.5 - 0.5 * std::cos (2.0 * pi * p);                                    // Hann
+            case 2:     return edge >= 0.25 ? 1.0 : 0.5 - 0.5 * std::cos (pi * edge / 0.25);            // Tukey, 25% tapers
+            case 3:     return edge >= 0.25 ? 1.0 : edge / 0.25;                                        // trapezoid, 25% ramps
+            default:    return std::sin (pi * p);                                                       // sine
+        }
+    }
+
+    // how far past the read position each interpolator looks
+    int getLookahead (int interpolation)
+    {
+        switch (interpolation)
+        {
+            case 1:
+            case 2:     return 2;
+            case 3:     return 8;
+            default:    return 1;
+        }
+    }
+
+    double sampleAt (const std::vector<double>& x, long index)
+    {
+        return index >= 0 && index < (long) x.size() ? x[(size_t) index] : 0.0;
+    }
+
+    double interpolate (int interpolation, const std::vector<double>& x, double pos)
+    {
+        const double whole = std::floor (pos);
+        const double f = pos - whole;
+        const long i = (long) whole;
+
+        const double xm1 = sampleAt (x, i - 1), x0 = sampleAt (x, i), x1 = sampleAt (x, i + 1), x2 = sampleAt (x, i + 2);
+
+        switch (interpolation)
+        {
+            case 1:
+            {
+                // Catmull-Rom
+                return x0 + 0.5 * f * (x1 - xm1
+                                       + f * (2.0 * xm1 - 5.0 * x0 + 4.0 * x1 - x2
+                                              + f * (3.0 * (x0 - x1) + x2 - xm1)));
+            }
+
+            case 2:
+            {
+                // third-order Lagrange through -1, 0, 1, 2
+                return xm1 * (f * (f - 1.0) * (f - 2.0)) / -6.0
+                     + x0 * ((f + 1.0) * (f - 1.0) * (f - 2.0)) / 2.0
+                     + x1 * ((f + 1.0) * f * (f - 2.0)) / -2.0
+                     + x2 * ((f + 1.0) * f * (f - 1.0)) / 6.0;
+            }
+
+            case 3:
+            {
+                // 16-tap Blackman-windowed sinc at 0.9 of Nyquist, normalised to unity at DC
+                double sum = 0.0, weights = 0.0;
+
+                for (int k = -7; k <= 8; ++k)
+                {
+                    const double t = k - f;
+                    const double arg = pi * 0.9 * t;
+                    const double w = (t + 8.0) / 16.0;
+                    const double h = (t == 0.0 ? 1.0 : std::sin (arg) / arg)
+                                   * (0.42 - 0.5 * std::cos (2.0 * pi * w) + 0.08 * std::cos (4.0 * pi * w));
+
+                    sum += h * sampleAt (x, i + k);
+                    weights += h;
+                }
+
+                return sum / weights;
+            }
+
+            default:
+                return x0 + f * (x1 - x0);
+        }
+    }
+}
+
+Signal Reference::render (const ShifterSettings& settings, const Signal& input)
+{
+    const double windowMs = settings.lowLatency ? std::fmin (settings.windowMs, 12.0) : settings.windowMs;
+    const double windowSamples = windowMs / 1000.0 * settings.sampleRate;
+
+    // normally the taps start a whole window back; in low-latency mode just clear of the interpolator
+    const double baseDelay = settings.lowLatency ? getLookahead (settings.interpolation) + 1.0 : windowSamples;
+    const double latency = baseDelay + 0.5 * windowSamples;
+    const double wetGain = std::pow (10.0, -3.0 / 20.0) * settings.mix * settings.outputGain;
+    const double dryGain = (1.0 - settings.mix) * settings.outputGain;
+
+    // a pitch ratio r needs the tap delay to change at 1 - r samples per sample
+    double increment[ShifterSettings::maxVoices];
+
+    for (int v = 0; v < settings.numVoices; ++v)
+        increment[v] = (1.0 - std::pow (2.0, settings.transpo[v] / 12.0)) / windowSamples;
+
+    Signal output (input.size());
+
+    for (size_t channel = 0; channel < input.size(); ++channel)
+    {
+        const auto& x = input[channel];
+        auto& y = output[channel];
+        y.assign (x.size(), 0.0);
+
+        double phase[ShifterSettings::maxVoices] = {};
+
+        for (size_t n = 0; n < x.size(); ++n)
+        {
+            double wet = 0.0;
+
+            for (int v = 0; v < settings.numVoices; ++v)
+            {
+                const double phases[2] = { phase[v], phase[v] + 0.5 < 1.0 ? phase[v] + 0.5 : phase[v] - 0.5 };
+
+                for (double p : phases)
+                {
+                    const double readPos = (double) n - baseDelay - p * windowSamples;
+                    wet += settings.gain[v] * window (settings.windowShape, p)
+                                            * interpolate (settings.interpolation, x, readPos);
+                }
+
+                phase[v] += increment[v];
+                phase[v] -= std::floor (phase[v]);
+            }
+
+            y[n] = wetGain * wet + dryGain * interpolate (0, x, (double) n - latency);
+        }
+    }
+
+    return output;
+}
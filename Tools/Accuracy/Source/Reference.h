@@ -0,0 +1,47 @@
+/*
+  ==============================================================================
+
+    Reference.h
+    The grain shifter written out the slow, obvious way.
+
+    One sample at a time, in double, straight from the definitions: every
+    voice is a phasor with two taps half a cycle apart, each tap reads the
+    input a window plus its own sweep behind the write head and is weighted
+    by the window shape at its phase. Windows and interpolators are evaluated
+    from their formulas rather than tables, and nothing is vectorised, split
+    into runs or ramped. It shares no code with the engine, so the two only
+    agree when the engine is right.
+
+    Parameters are fixed for the whole render, as they are after a reset, so
+    there's nothing to smooth.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <vector>
+
+struct ShifterSettings
+{
+    static constexpr int maxVoices = 16;
+
+    double sampleRate = 48000.0;
+    int numVoices = 2;
+    double transpo[maxVoices] = {};     // semitones
+    double gain[maxVoices] = { 1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0 };
+    double windowMs = 50.0;
+    int windowShape = 0;                // GrainWindow::Shape
+    int interpolation = 0;              // Interpolation::Type
+    bool lowLatency = false;
+    double mix = 1.0;
+    double outputGain = 1.0;
+};
+
+using Signal = std::vector<std::vector<double>>;   // [channel][sample]
+
+namespace Reference
+{
+    /** Shifts every channel of input from silence. */
+    Signal render (const ShifterSettings& settings, const Signal& input);
+}
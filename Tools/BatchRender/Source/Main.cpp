@@ -0,0 +1,356 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+    BatchRender - streams audio files through PitchShifterAudioProcessor
+    offline, many files at once.
+
+    BatchRender [options] <file|folder>...
+
+        --out <folder>              where to write results (default: next to each input)
+        --transpo <st,st,...>       transposition per voice; also sets the voice count
+        --window <ms>               grain window size, 5 to 300 ms
+        --preset nice|weird|scary   start from one of the plugin presets
+        --shape sine|hann|tukey|trapezoid
+        --interp linear|hermite|lagrange|sinc
+        --oversample 1|2|4|8        run the grain engine oversampled
+        --block <samples>           processing block size (default 512)
+        --threads <n>               worker threads (default: one per core)
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../../../Source/PluginProcessor.h"
+
+//==============================================================================
+struct RenderSettings
+{
+    juce::File outputFolder;
+    juce::Array<float> transpo;
+    float windowSizeMs = -1.0f;
+    int preset = 0;
+    int windowShape = -1;
+    int interpolation = -1;
+    int oversampling = -1;
+    int blockSize = 512;
+};
+
+//==============================================================================
+/** Renders one file. Jobs are queued on a juce::ThreadPool and each idle worker
+    takes the next file, so long and short files balance themselves across cores.
+*/
+class RenderJob  : public juce::ThreadPoolJob
+{
+public:
+    RenderJob (const juce::File& in, const RenderSettings& s, std::atomic<int>& failureCount)
+        : juce::ThreadPoolJob (in.getFileName()), input (in), settings (s), failures (failureCount)
+    {
+    }
+
+    JobStatus runJob() override
+    {
+        juce::String error = render();
+
+        if (error.isNotEmpty())
+        {
+            ++failures;
+            log (input.getFullPathName() + ": " + error);
+        }
+        else
+        {
+            log (input.getFullPathName() + " -> " + getOutputFile().getFullPathName());
+        }
+
+        return jobHasFinished;
+    }
+
+private:
+    juce::File getOutputFile() const
+    {
+        auto folder = settings.outputFolder == juce::File() ? input.getParentDirectory() : settings.outputFolder;
+        return folder.getChildFile (input.getFileNameWithoutExtension() + "_shifted.wav");
+    }
+
+    std::unique_ptr<juce::AudioFormatReader> createReader (juce::AudioFormatManager& formats) const
+    {
+        // WAV and AIFF can be mapped straight into memory, which saves a copy
+        // through the stream layer; anything else falls back to a normal reader
+        if (auto* format = formats.findFormatForFileExtension (input.getFileExtension()))
+        {
+            std::unique_ptr<juce::MemoryMappedAudioFormatReader> mapped (format->createMemoryMappedReader (input));
+
+            if (mapped != nullptr && mapped->mapEntireFile())
+                return std::move (mapped);
+        }
+
+        return std::unique_ptr<juce::AudioFormatReader> (formats.createReaderFor (input));
+    }
+
+    void applySettings (PitchShifterAudioProcessor& processor) const
+    {
+        if (settings.preset != 0)
+            processor.applyPreset (settings.preset);
+
+        if (settings.transpo.size() > 0)
+        {
+            processor.setParameterValue (ParamIDs::numVoices, (float) settings.transpo.size());
+
+            for (int voice = 0; voice < settings.transpo.size(); ++voice)
+                processor.setParameterValue (PitchShifterAudioProcessor::transpoParamId (voice), settings.transpo[voice]);
+        }
+
+        if (settings.windowSizeMs > 0.0f)
+            processor.setParameterValue (ParamIDs::windowSize, settings.windowSizeMs);
+
+        if (settings.windowShape >= 0)
+            processor.setParameterValue (ParamIDs::windowShape, (float) settings.windowShape);
+
+        if (settings.interpolation >= 0)
+            processor.setParameterValue (ParamIDs::interpolation, (float) settings.interpolation);
+
+        if (settings.oversampling >= 0)
+            processor.setParameterValue (ParamIDs::oversampling, (float) settings.oversampling);
+    }
+
+    juce::String render()
+    {
+        juce::AudioFormatManager formats;
+        formats.registerBasicFormats();
+
+        auto reader = createReader (formats);
+
+        if (reader == nullptr)
+            return "unsupported or unreadable file";
+
+        const auto sampleRate = reader->sampleRate;
+        const int numChannels = juce::jmin (PitchShifterAudioProcessor::maxChannels, (int) reader->numChannels);
+        const int blockSize = settings.blockSize;
+
+        PitchShifterAudioProcessor processor;
+
+        juce::AudioProcessor::BusesLayout layout;
+        auto channelSet = juce::AudioChannelSet::canonicalChannelSet (numChannels);
+
+        if (channelSet.isDisabled())
+            channelSet = juce::AudioChannelSet::discreteChannels (numChannels);
+        layout.inputBuses.add (channelSet);
+        layout.outputBuses.add (channelSet);
+
+        if (! processor.setBusesLayout (layout))
+            return "unsupported channel layout";
+
+        applySettings (processor);
+        processor.setRateAndBufferSizeDetails (sampleRate, blockSize);
+        processor.prepareToPlay (sampleRate, blockSize);
+
+        auto outputFile = getOutputFile();
+        outputFile.deleteFile();
+
+        std::unique_ptr<juce::FileOutputStream> stream (outputFile.createOutputStream());
+
+        if (stream == nullptr)
+            return "can't write " + outputFile.getFullPathName();
+
+        juce::WavAudioFormat wav;
+        std::unique_ptr<juce::AudioFormatWriter> writer (wav.createWriterFor (stream.get(), sampleRate,
+                                                                              (unsigned int) numChannels,
+                                                                              24, {}, 0));
+
+        if (writer == nullptr)
+            return "can't create a WAV writer";
+
+        stream.release();
+
+        // run on past the end of the input so the delayed grains aren't cut off,
+        // and drop the reported latency from the front so the output lines up
+        const auto latency = (juce::int64) processor.getLatencySamples();
+        const auto tail = (juce::int64) std::ceil (processor.getTailLengthSeconds() * sampleRate);
+        const auto inputLength = reader->lengthInSamples;
+        const auto totalLength = inputLength + latency + tail;
+
+        juce::AudioBuffer<float> buffer (numChannels, blockSize);
+        juce::MidiBuffer midi;
+        auto toSkip = latency;
+
+        for (juce::int64 pos = 0; pos < totalLength; pos += blockSize)
+        {
+            if (shouldExit())
+                return "cancelled";
+
+            const int num = (int) juce::jmin ((juce::int64) blockSize, totalLength - pos);
+
+            buffer.setSize (numChannels, num, false, false, true);
+            buffer.clear();
+
+            if (pos < inputLength)
+                reader->read (&buffer, 0, (int) juce::jmin ((juce::int64) num, inputLength - pos), pos, true, numChannels > 1);
+
+            processor.processBlock (buffer, midi);
+
+            const int skip = (int) juce::jmin (toSkip, (juce::int64) num);
+            toSkip -= skip;
+
+            if (skip < num && ! writer->writeFromAudioSampleBuffer (buffer, skip, num - skip))
+                return "write failed";
+        }
+
+        processor.releaseResources();
+        return {};
+    }
+
+    static void log (const juce::String& message)
+    {
+        static juce::CriticalSection lock;
+        const juce::ScopedLock sl (lock);
+        std::cout << message << std::endl;
+    }
+
+    juce::File input;
+    RenderSettings settings;
+    std::atomic<int>& failures;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (RenderJob)
+};
+
+//==============================================================================
+static int findIndex (const juce::StringArray& names, const juce::String& name)
+{
+    for (int i = 0; i < names.size(); ++i)
+        if (names[i].equalsIgnoreCase (name))
+            return i;
+
+    return -1;
+}
+
+static void printUsage()
+{
+    std::cout << "usage: BatchRender [--out <folder>] [--transpo st,st,...] [--window ms]" << std::endl
+              << "                   [--preset nice|weird|scary] [--shape sine|hann|tukey|trapezoid]" << std::endl
+              << "                   [--interp linear|hermite|lagrange|sinc] [--oversample 1|2|4|8]" << std::endl
+              << "                   [--block samples] [--threads n] <file|folder>..." << std::endl;
+}
+
+int main (int argc, char* argv[])
+{
+    // the processor's parameter tree flushes through the message thread machinery
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    RenderSettings settings;
+    int numThreads = juce::SystemStats::getNumCpus();
+    juce::Array<juce::File> inputs;
+
+    juce::AudioFormatManager formats;
+    formats.registerBasicFormats();
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const juce::String arg (argv[i]);
+        const juce::String value (i + 1 < argc ? argv[i + 1] : "");
+
+        if (arg == "--out")             { settings.outputFolder = juce::File::getCurrentWorkingDirectory().getChildFile (value); ++i; }
+        else if (arg == "--window")     { settings.windowSizeMs = value.getFloatValue(); ++i; }
+        else if (arg == "--block")      { settings.blockSize = juce::jmax (1, value.getIntValue()); ++i; }
+        else if (arg == "--threads")    { numThreads = juce::jmax (1, value.getIntValue()); ++i; }
+        else if (arg == "--transpo")
+        {
+            auto tokens = juce::StringArray::fromTokens (value, ",", "");
+
+            for (int voice = 0; voice < juce::jmin (tokens.size(), (int) VoiceEngine::maxVoices); ++voice)
+                settings.transpo.add (tokens[voice].getFloatValue());
+
+            ++i;
+        }
+        else if (arg == "--preset")
+        {
+            settings.preset = findIndex ({ "nice", "weird", "scary" }, value) + 1;
+
+            if (settings.preset == 0)
+            {
+                std::cerr << "unknown preset: " << value << std::endl;
+                return 1;
+            }
+
+            ++i;
+        }
+        else if (arg == "--shape")
+        {
+            juce::StringArray shapes;
+            for (int shape = 0; shape < GrainWindow::numShapes; ++shape)
+                shapes.add (GrainWindow::getName ((GrainWindow::Shape) shape));
+
+            settings.windowShape = findIndex (shapes, value);
+
+            if (settings.windowShape < 0)
+            {
+                std::cerr << "unknown window shape: " << value << std::endl;
+                return 1;
+            }
+
+            ++i;
+        }
+        else if (arg == "--interp")
+        {
+            juce::StringArray interpolations;
+            for (int type = 0; type < Interpolation::numTypes; ++type)
+                interpolations.add (Interpolation::getName ((Interpolation::Type) type));
+
+            settings.interpolation = findIndex (interpolations, value);
+
+            if (settings.interpolation < 0)
+            {
+                std::cerr << "unknown interpolation: " << value << std::endl;
+                return 1;
+            }
+
+            ++i;
+        }
+        else if (arg == "--oversample")
+        {
+            settings.oversampling = findIndex ({ "1", "2", "4", "8" }, value);
+
+            if (settings.oversampling < 0)
+            {
+                std::cerr << "unknown oversampling factor: " << value << std::endl;
+                return 1;
+            }
+
+            ++i;
+        }
+        else if (arg.startsWith ("--"))
+        {
+            printUsage();
+            return 1;
+        }
+        else
+        {
+            auto file = juce::File::getCurrentWorkingDirectory().getChildFile (arg);
+
+            if (file.isDirectory())
+                inputs.addArray (file.findChildFiles (juce::File::findFiles, true, formats.getWildcardForAllFormats()));
+            else
+                inputs.add (file);
+        }
+    }
+
+    if (inputs.isEmpty())
+    {
+        printUsage();
+        return 1;
+    }
+
+    if (settings.outputFolder != juce::File())
+        settings.outputFolder.createDirectory();
+
+    std::atomic<int> failures { 0 };
+    juce::ThreadPool pool (juce::jmin (numThreads, inputs.size()));
+
+    for (auto& input : inputs)
+        pool.addJob (new RenderJob (input, settings, failures), true);
+
+    while (pool.getNumJobs() > 0)
+        juce::Thread::sleep (20);
+
+    std::cout << inputs.size() - failures.load() << " of " << inputs.size() << " files rendered" << std::endl;
+    return failures.load() == 0 ? 0 : 1;
+}
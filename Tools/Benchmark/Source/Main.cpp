@@ -0,0 +1,167 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+    Benchmark - times PitchShifterAudioProcessor::processBlock headlessly.
+
+    Sweeps block size, sample rate, channel layout, window size and preset,
+    and prints one CSV row per configuration:
+
+        block,sample_rate,channels,window_ms,preset,ns_per_sample,realtime_factor
+
+    ns_per_sample is wall time per channel sample. realtime_factor is seconds
+    of audio processed per second of wall time, so 100 means one instance
+    uses roughly 1% of a core.
+
+    Benchmark [--seconds <s>] [--quick] [--double] [--out <file.csv>]
+
+    --double runs every configuration through the 64-bit processBlock.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../../../Source/PluginProcessor.h"
+
+//==============================================================================
+struct BenchConfig
+{
+    int blockSize;
+    double sampleRate;
+    int numChannels;
+    float windowSizeMs;
+    int preset;
+};
+
+static const char* getPresetName (int preset)
+{
+    switch (preset)
+    {
+        case nice:  return "nice";
+        case weird: return "weird";
+        case scary: return "scary";
+        default:    return "none";
+    }
+}
+
+template <typename SampleType>
+static double runConfig (const BenchConfig& config, double secondsOfAudio)
+{
+    PitchShifterAudioProcessor processor;
+    processor.setProcessingPrecision (std::is_same<SampleType, double>::value ? juce::AudioProcessor::doublePrecision
+                                                                               : juce::AudioProcessor::singlePrecision);
+
+    juce::AudioProcessor::BusesLayout layout;
+    auto channelSet = config.numChannels == 1 ? juce::AudioChannelSet::mono() : juce::AudioChannelSet::stereo();
+    layout.inputBuses.add (channelSet);
+    layout.outputBuses.add (channelSet);
+    processor.setBusesLayout (layout);
+
+    processor.applyPreset (config.preset);
+    processor.setParameterValue (ParamIDs::windowSize, config.windowSizeMs);
+    processor.setRateAndBufferSizeDetails (config.sampleRate, config.blockSize);
+    processor.prepareToPlay (config.sampleRate, config.blockSize);
+
+    juce::AudioBuffer<SampleType> input (config.numChannels, config.blockSize);
+    juce::AudioBuffer<SampleType> buffer (config.numChannels, config.blockSize);
+    juce::MidiBuffer midi;
+    juce::Random random (1234);
+
+    for (int channel = 0; channel < config.numChannels; ++channel)
+        for (int i = 0; i < config.blockSize; ++i)
+            input.setSample (channel, i, (SampleType) (random.nextFloat() * 2.0f - 1.0f));
+
+    const int numBlocks = juce::jmax (1, (int) (secondsOfAudio * config.sampleRate / config.blockSize));
+    const int warmupBlocks = juce::jmax (1, numBlocks / 10);
+
+    for (int block = 0; block < warmupBlocks; ++block)
+    {
+        buffer.makeCopyOf (input, true);
+        processor.processBlock (buffer, midi);
+    }
+
+    juce::int64 ticks = 0;
+
+    for (int block = 0; block < numBlocks; ++block)
+    {
+        // the copy restores fresh input but stays outside the timed region
+        buffer.makeCopyOf (input, true);
+
+        const auto start = juce::Time::getHighResolutionTicks();
+        processor.processBlock (buffer, midi);
+        ticks += juce::Time::getHighResolutionTicks() - start;
+    }
+
+    processor.releaseResources();
+
+    return juce::Time::highResolutionTicksToSeconds (ticks) / ((double) numBlocks * config.blockSize);
+}
+
+int main (int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    double secondsOfAudio = 2.0;
+    bool quick = false;
+    bool doublePrecision = false;
+    juce::File outputFile;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const juce::String arg (argv[i]);
+
+        if (arg == "--seconds" && i + 1 < argc)    secondsOfAudio = juce::String (argv[++i]).getDoubleValue();
+        else if (arg == "--quick")                 quick = true;
+        else if (arg == "--double")                doublePrecision = true;
+        else if (arg == "--out" && i + 1 < argc)   outputFile = juce::File::getCurrentWorkingDirectory().getChildFile (argv[++i]);
+        else
+        {
+            std::cerr << "usage: Benchmark [--seconds <s>] [--quick] [--double] [--out <file.csv>]" << std::endl;
+            return 1;
+        }
+    }
+
+    juce::Array<int> blockSizes   { 16, 32, 64, 128, 256, 512, 1024, 2048, 4096 };
+    juce::Array<double> rates     { 44100.0, 48000.0, 88200.0, 96000.0, 192000.0 };
+    juce::Array<int> channels     { 1, 2 };
+    juce::Array<float> windows    { 5.0f, 50.0f, 150.0f, 300.0f };
+    juce::Array<int> presets      { nice, weird, scary };
+
+    if (quick)
+    {
+        blockSizes = { 64, 512, 4096 };
+        rates = { 48000.0, 192000.0 };
+        windows = { 50.0f, 300.0f };
+    }
+
+    juce::StringArray rows;
+    rows.add ("block,sample_rate,channels,window_ms,preset,ns_per_sample,realtime_factor");
+    std::cout << rows[0] << std::endl;
+
+    for (auto blockSize : blockSizes)
+        for (auto rate : rates)
+            for (auto numChannels : channels)
+                for (auto windowMs : windows)
+                    for (auto preset : presets)
+                    {
+                        BenchConfig config { blockSize, rate, numChannels, windowMs, preset };
+                        auto secondsPerFrame = doublePrecision ? runConfig<double> (config, secondsOfAudio)
+                                                               : runConfig<float> (config, secondsOfAudio);
+
+                        auto nsPerSample = secondsPerFrame * 1.0e9 / numChannels;
+                        auto realtimeFactor = 1.0 / (secondsPerFrame * rate);
+
+                        auto row = juce::String (blockSize) + "," + juce::String (rate, 0) + ","
+                                 + juce::String (numChannels) + "," + juce::String (windowMs, 1) + ","
+                                 + getPresetName (preset) + "," + juce::String (nsPerSample, 3) + ","
+                                 + juce::String (realtimeFactor, 2);
+
+                        rows.add (row);
+                        std::cout << row << std::endl;
+                    }
+
+    if (outputFile != juce::File())
+        outputFile.replaceWithText (rows.joinIntoString ("\n") + "\n");
+
+    return 0;
+}
@@ -0,0 +1,88 @@
+/*
+  ==============================================================================
+
+    BlockScheduler.cpp
+
+  ==============================================================================
+*/
+
+#include "BlockScheduler.h"
+
+#include <algorithm>
+
+BlockScheduler::BlockScheduler (int numThreads, int maxStreams, std::function<void()> onBlockDoneToUse)
+    : onBlockDone (std::move (onBlockDoneToUse))
+{
+    heap.reserve ((size_t) maxStreams);
+
+    for (int i = 0; i < std::max (1, numThreads); ++i)
+        workers.emplace_back ([this] { run(); });
+}
+
+BlockScheduler::~BlockScheduler()
+{
+    {
+        const std::lock_guard<std::mutex> guard (lock);
+        stopping = true;
+    }
+
+    wake.notify_all();
+
+    for (auto& worker : workers)
+        worker.join();
+}
+
+void BlockScheduler::schedule (Stream& stream)
+{
+    if (stream.hasWork() && ! stream.queued.exchange (true))
+        push (stream);
+}
+
+void BlockScheduler::push (Stream& stream)
+{
+    {
+        const std::lock_guard<std::mutex> guard (lock);
+        heap.push_back ({ stream.getNextDeadline(), &stream });
+        std::push_heap (heap.begin(), heap.end());
+    }
+
+    wake.notify_one();
+}
+
+void BlockScheduler::run()
+{
+    for (;;)
+    {
+        Stream* stream = nullptr;
+
+        {
+            std::unique_lock<std::mutex> guard (lock);
+            wake.wait (guard, [this] { return stopping || ! heap.empty(); });
+
+            if (stopping)
+                return;
+
+            std::pop_heap (heap.begin(), heap.end());
+            stream = heap.back().stream;
+            heap.pop_back();
+        }
+
+        // queued stays set while rendering, so nothing else picks the stream up meanwhile
+        stream->renderBlock();
+        ++numBlocks;
+
+        if (stream->hasWork())
+        {
+            push (*stream);
+        }
+        else
+        {
+            // the I/O thread may have published a block after the check above, seen the
+            // stream still queued and left it; look again now the flag is down
+            stream->queued = false;
+            schedule (*stream);
+        }
+
+        onBlockDone();
+    }
+}
@@ -0,0 +1,65 @@
+/*
+  ==============================================================================
+
+    BlockScheduler.h
+    Worker threads that render stream blocks, earliest deadline first.
+
+    A stream with a block waiting is queued once, keyed by that block's
+    deadline. A worker takes the most urgent stream, renders one block and
+    queues it again if there's more, so one busy stream can't hold a worker
+    while others fall behind. A stream whose output ring is full drops out
+    of the queue until the I/O thread has drained some of it; that stalls
+    its input ring too, which is how back-pressure reaches the client.
+
+    The queue is a heap in storage reserved for every stream, so scheduling
+    never allocates.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "StreamPool.h"
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class BlockScheduler
+{
+public:
+    /** onBlockDone is called from a worker after every block, to wake the I/O thread. */
+    BlockScheduler (int numThreads, int maxStreams, std::function<void()> onBlockDone);
+    ~BlockScheduler();
+
+    /** Queues a stream if it has work and isn't queued already. Any thread. */
+    void schedule (Stream& stream);
+
+    /** Blocks rendered so far across every stream. */
+    uint64_t getNumBlocks() const noexcept      { return numBlocks.load(); }
+
+private:
+    struct Entry
+    {
+        Clock::time_point deadline;
+        Stream* stream;
+
+        // std::push_heap builds a max-heap, so the earliest deadline has to compare greatest
+        bool operator< (const Entry& other) const noexcept     { return deadline > other.deadline; }
+    };
+
+    void push (Stream& stream);
+    void run();
+
+    std::function<void()> onBlockDone;
+
+    std::mutex lock;
+    std::condition_variable wake;
+    std::vector<Entry> heap;
+    bool stopping = false;
+
+    std::atomic<uint64_t> numBlocks { 0 };
+    std::vector<std::thread> workers;
+};
@@ -0,0 +1,383 @@
+/*
+  ==============================================================================
+
+    Client.cpp
+    pitchshifter-client - stands in for the daemon's real callers.
+
+    Opens any number of streams against a running pitchshifterd, one thread
+    each, sends a few seconds of sine (or a raw float file) through them and
+    checks every stream gets back exactly as many frames as it sent. With
+    --realtime the input is paced at the sample rate, as a live source would
+    be, and the worst time from a frame going out to its shifted frame
+    coming back is reported per run.
+
+        pitchshifter-client --socket <path> [--streams <n>] [--seconds <s>]
+                            [--rate <hz>] [--channels <n>] [--transpo <semitones>]
+                            [--realtime] [--in <file.raw>] [--out <file.raw>]
+
+    --in and --out are interleaved native float32 at --rate and --channels;
+    --out keeps what the first stream got back.
+
+  ==============================================================================
+*/
+
+#include "StreamProtocol.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using Clock = std::chrono::steady_clock;
+
+//==============================================================================
+struct ClientOptions
+{
+    std::string socketPath;
+    int numStreams = 1;
+    double seconds = 5.0;
+    int sampleRate = 48000;
+    int numChannels = 2;
+    float transpo = 7.0f;
+    bool realtime = false;
+    std::string inputPath;
+    std::string outputPath;
+};
+
+struct StreamResult
+{
+    enum Outcome { done, turnedAway, failed };
+
+    Outcome outcome = failed;
+    uint64_t framesSent = 0;
+    uint64_t framesReceived = 0;
+    double worstTurnaroundMs = 0.0;
+    std::vector<float> output;
+};
+
+// frames handed to write() at a time, and the pacing step with --realtime
+static constexpr int chunkFrames = 128;
+
+static bool writeAll (int fd, const void* data, size_t numBytes)
+{
+    auto* bytes = static_cast<const char*> (data);
+
+    while (numBytes > 0)
+    {
+        const auto result = ::write (fd, bytes, numBytes);
+
+        if (result <= 0)
+            return false;
+
+        bytes += result;
+        numBytes -= (size_t) result;
+    }
+
+    return true;
+}
+
+static bool readAll (int fd, void* data, size_t numBytes)
+{
+    auto* bytes = static_cast<char*> (data);
+
+    while (numBytes > 0)
+    {
+        const auto result = ::read (fd, bytes, numBytes);
+
+        if (result <= 0)
+            return false;
+
+        bytes += result;
+        numBytes -= (size_t) result;
+    }
+
+    return true;
+}
+
+static void runStream (int index, const ClientOptions& options, const std::vector<float>& input, StreamResult& result)
+{
+    const int fd = ::socket (AF_UNIX, SOCK_STREAM, 0);
+
+    sockaddr_un address {};
+    address.sun_family = AF_UNIX;
+    std::strncpy (address.sun_path, options.socketPath.c_str(), sizeof (address.sun_path) - 1);
+
+    if (fd < 0 || ::connect (fd, reinterpret_cast<const sockaddr*> (&address), sizeof (address)) != 0)
+    {
+        std::fprintf (stderr, "stream %d: can't connect: %s\n", index, std::strerror (errno));
+
+        if (fd >= 0)
+            ::close (fd);
+
+        return;
+    }
+
+    auto header = StreamProtocol::makeHeader ((uint32_t) options.sampleRate, (uint32_t) options.numChannels);
+    header.transpo[0] = options.transpo;
+    header.transpo[1] = -options.transpo;
+
+    StreamProtocol::Reply reply {};
+
+    if (! writeAll (fd, &header, sizeof (header)) || ! readAll (fd, &reply, sizeof (reply))
+        || reply.magic != StreamProtocol::magic)
+    {
+        std::fprintf (stderr, "stream %d: no reply from the server\n", index);
+        ::close (fd);
+        return;
+    }
+
+    if (reply.status != StreamProtocol::ok)
+    {
+        result.outcome = reply.status == StreamProtocol::serverFull ? StreamResult::turnedAway : StreamResult::failed;
+        ::close (fd);
+        return;
+    }
+
+    const auto numChannels = (size_t) options.numChannels;
+    const auto frameBytes = sizeof (float) * numChannels;
+    const auto totalFrames = (uint64_t) (input.size() / numChannels);
+    const auto numChunks = (size_t) ((totalFrames + chunkFrames - 1) / chunkFrames);
+
+    // when each chunk went out, to time its frames' round trip
+    std::vector<Clock::time_point> sentAt (numChunks);
+    size_t chunksTimed = 0;
+
+    if (index == 0 && ! options.outputPath.empty())
+        result.output.resize (input.size());
+
+    std::vector<char> scratch (frameBytes * 1024);
+    size_t pendingBytes = 0;
+    uint64_t bytesSent = 0;
+    uint64_t bytesReceived = 0;
+    bool writeShut = false;
+
+    const auto totalBytes = totalFrames * frameBytes;
+    const auto start = Clock::now();
+    ::fcntl (fd, F_SETFL, ::fcntl (fd, F_GETFL) | O_NONBLOCK);
+
+    for (;;)
+    {
+        const auto now = Clock::now();
+        const auto chunkIndex = (size_t) (bytesSent / frameBytes / chunkFrames);
+        int timeoutMs = -1;
+
+        // paced input only releases a chunk once its first frame is due
+        bool mayWrite = bytesSent < totalBytes;
+
+        if (mayWrite && options.realtime && pendingBytes == 0)
+        {
+            const auto due = start + std::chrono::duration_cast<Clock::duration> (
+                                 std::chrono::duration<double> ((double) chunkIndex * chunkFrames / options.sampleRate));
+
+            if (now < due)
+            {
+                mayWrite = false;
+                timeoutMs = (int) std::chrono::duration_cast<std::chrono::milliseconds> (due - now).count() + 1;
+            }
+        }
+
+        if (bytesSent == totalBytes && ! writeShut)
+        {
+            ::shutdown (fd, SHUT_WR);
+            writeShut = true;
+        }
+
+        pollfd entry { fd, (short) (POLLIN | (mayWrite ? POLLOUT : 0)), 0 };
+
+        if (::poll (&entry, 1, timeoutMs) < 0 && errno != EINTR)
+            break;
+
+        if ((entry.revents & POLLOUT) != 0)
+        {
+            if (pendingBytes == 0)
+            {
+                sentAt[chunkIndex] = Clock::now();
+                pendingBytes = std::min<uint64_t> (chunkFrames * frameBytes, totalBytes - bytesSent);
+            }
+
+            const auto* src = reinterpret_cast<const char*> (input.data()) + bytesSent;
+            const auto written = ::write (fd, src, pendingBytes);
+
+            if (written > 0)
+            {
+                bytesSent += (uint64_t) written;
+                pendingBytes -= (size_t) written;
+            }
+            else if (errno != EAGAIN && errno != EINTR)
+            {
+                break;
+            }
+        }
+
+        if ((entry.revents & (POLLIN | POLLHUP)) != 0)
+        {
+            const auto numRead = ::read (fd, scratch.data(), scratch.size());
+
+            if (numRead == 0)
+                break;
+
+            if (numRead < 0)
+            {
+                if (errno != EAGAIN && errno != EINTR)
+                    break;
+
+                continue;
+            }
+
+            if (! result.output.empty())
+                std::memcpy (reinterpret_cast<char*> (result.output.data()) + bytesReceived, scratch.data(),
+                             (size_t) std::min<uint64_t> ((uint64_t) numRead, totalBytes - std::min (totalBytes, bytesReceived)));
+
+            bytesReceived += (uint64_t) numRead;
+
+            const auto arrived = Clock::now();
+
+            while (chunksTimed < numChunks
+                   && bytesReceived >= std::min<uint64_t> ((chunksTimed + 1) * chunkFrames, totalFrames) * frameBytes)
+            {
+                const auto turnaround = std::chrono::duration<double, std::milli> (arrived - sentAt[chunksTimed]).count();
+                result.worstTurnaroundMs = std::max (result.worstTurnaroundMs, turnaround);
+                ++chunksTimed;
+            }
+        }
+    }
+
+    ::close (fd);
+
+    result.framesSent = bytesSent / frameBytes;
+    result.framesReceived = bytesReceived / frameBytes;
+    result.outcome = bytesSent == totalBytes && bytesReceived == totalBytes ? StreamResult::done : StreamResult::failed;
+
+    if (result.outcome == StreamResult::failed)
+        std::fprintf (stderr, "stream %d: sent %llu frames, got %llu back\n", index,
+                      (unsigned long long) result.framesSent, (unsigned long long) result.framesReceived);
+}
+
+//==============================================================================
+static bool loadInput (const ClientOptions& options, std::vector<float>& input)
+{
+    if (options.inputPath.empty())
+    {
+        const auto numFrames = (size_t) (options.seconds * options.sampleRate);
+        input.resize (numFrames * (size_t) options.numChannels);
+
+        for (size_t i = 0; i < numFrames; ++i)
+            for (size_t channel = 0; channel < (size_t) options.numChannels; ++channel)
+                input[i * (size_t) options.numChannels + channel] = 0.5f * (float) std::sin (2.0 * M_PI * 220.0 * (double) (channel + 1) * (double) i / options.sampleRate);
+
+        return true;
+    }
+
+    auto* file = std::fopen (options.inputPath.c_str(), "rb");
+
+    if (file == nullptr)
+        return false;
+
+    std::vector<float> block (4096);
+    size_t numRead;
+
+    while ((numRead = std::fread (block.data(), sizeof (float), block.size(), file)) > 0)
+        input.insert (input.end(), block.begin(), block.begin() + (long) numRead);
+
+    std::fclose (file);
+    input.resize (input.size() - input.size() % (size_t) options.numChannels);
+    return true;
+}
+
+int main (int argc, char* argv[])
+{
+    ClientOptions options;
+    bool valid = true;
+
+    for (int i = 1; i < argc && valid; ++i)
+    {
+        const char* arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+
+        if (std::strcmp (arg, "--socket") == 0 && hasValue)             options.socketPath = argv[++i];
+        else if (std::strcmp (arg, "--streams") == 0 && hasValue)       options.numStreams = std::atoi (argv[++i]);
+        else if (std::strcmp (arg, "--seconds") == 0 && hasValue)       options.seconds = std::atof (argv[++i]);
+        else if (std::strcmp (arg, "--rate") == 0 && hasValue)          options.sampleRate = std::atoi (argv[++i]);
+        else if (std::strcmp (arg, "--channels") == 0 && hasValue)      options.numChannels = std::atoi (argv[++i]);
+        else if (std::strcmp (arg, "--transpo") == 0 && hasValue)       options.transpo = (float) std::atof (argv[++i]);
+        else if (std::strcmp (arg, "--realtime") == 0)                  options.realtime = true;
+        else if (std::strcmp (arg, "--in") == 0 && hasValue)            options.inputPath = argv[++i];
+        else if (std::strcmp (arg, "--out") == 0 && hasValue)           options.outputPath = argv[++i];
+        else                                                            valid = false;
+    }
+
+    valid = valid && ! options.socketPath.empty() && options.numStreams > 0
+                  && options.sampleRate > 0 && options.numChannels > 0;
+
+    if (! valid)
+    {
+        std::fprintf (stderr, "usage: pitchshifter-client --socket <path> [--streams <n>] [--seconds <s>]\n"
+                              "                           [--rate <hz>] [--channels <n>] [--transpo <semitones>]\n"
+                              "                           [--realtime] [--in <file.raw>] [--out <file.raw>]\n");
+        return 1;
+    }
+
+    std::vector<float> input;
+
+    if (! loadInput (options, input))
+    {
+        std::fprintf (stderr, "can't read %s\n", options.inputPath.c_str());
+        return 1;
+    }
+
+    std::vector<StreamResult> results ((size_t) options.numStreams);
+    std::vector<std::thread> threads;
+
+    for (int i = 0; i < options.numStreams; ++i)
+        threads.emplace_back ([&, i] { runStream (i, options, input, results[(size_t) i]); });
+
+    for (auto& thread : threads)
+        thread.join();
+
+    int numDone = 0, numTurnedAway = 0, numFailed = 0;
+    uint64_t totalFrames = 0;
+    double worstMs = 0.0, sumWorstMs = 0.0;
+
+    for (const auto& result : results)
+    {
+        numDone += result.outcome == StreamResult::done ? 1 : 0;
+        numTurnedAway += result.outcome == StreamResult::turnedAway ? 1 : 0;
+        numFailed += result.outcome == StreamResult::failed ? 1 : 0;
+        totalFrames += result.framesReceived;
+
+        if (result.outcome == StreamResult::done)
+        {
+            worstMs = std::max (worstMs, result.worstTurnaroundMs);
+            sumWorstMs += result.worstTurnaroundMs;
+        }
+    }
+
+    std::printf ("%d streams: %d done, %d turned away, %d failed; %llu frames back\n",
+                 options.numStreams, numDone, numTurnedAway, numFailed, (unsigned long long) totalFrames);
+
+    if (numDone > 0)
+        std::printf ("worst turnaround %.2f ms, mean per-stream worst %.2f ms\n", worstMs, sumWorstMs / numDone);
+
+    if (! options.outputPath.empty() && results[0].outcome == StreamResult::done)
+    {
+        if (auto* file = std::fopen (options.outputPath.c_str(), "wb"))
+        {
+            std::fwrite (results[0].output.data(), sizeof (float), results[0].output.size(), file);
+            std::fclose (file);
+        }
+    }
+
+    return numFailed == 0 ? 0 : 1;
+}
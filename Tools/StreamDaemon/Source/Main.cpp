@@ -0,0 +1,83 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+    pitchshifterd - shifts many live PCM streams at once.
+
+    Each connection sends a StreamProtocol::Header, then interleaved float
+    frames, and reads the shifted frames back. Blocks are rendered on a pool
+    of worker threads, most urgent first, and every stream has its own
+    deadline: a block is due --deadline blocks after its last byte arrives.
+    Late blocks are counted per stream and reported when it closes.
+
+        pitchshifterd --socket <path> [--max-streams <n>] [--threads <n>]
+                      [--block <frames>] [--queue <blocks>] [--deadline <blocks>]
+                      [--max-rate <hz>] [--max-channels <n>] [--verbose]
+        pitchshifterd --stdio [...]
+
+    --stdio serves a single stream on stdin and stdout instead, so the
+    daemon can be run behind a pair of named pipes or in a shell pipeline.
+
+  ==============================================================================
+*/
+
+#include "StreamServer.h"
+
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+static void handleSignal (int)
+{
+    StreamServer::stop();
+}
+
+int main (int argc, char* argv[])
+{
+    StreamServer::Options options;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const char* arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+
+        if (std::strcmp (arg, "--socket") == 0 && hasValue)                 options.socketPath = argv[++i];
+        else if (std::strcmp (arg, "--stdio") == 0)                         options.useStdio = true;
+        else if (std::strcmp (arg, "--max-streams") == 0 && hasValue)       options.maxStreams = std::atoi (argv[++i]);
+        else if (std::strcmp (arg, "--threads") == 0 && hasValue)           options.numThreads = std::atoi (argv[++i]);
+        else if (std::strcmp (arg, "--block") == 0 && hasValue)             options.blockSize = std::atoi (argv[++i]);
+        else if (std::strcmp (arg, "--queue") == 0 && hasValue)             options.queueBlocks = std::atoi (argv[++i]);
+        else if (std::strcmp (arg, "--deadline") == 0 && hasValue)          options.deadlineBlocks = std::atof (argv[++i]);
+        else if (std::strcmp (arg, "--max-rate") == 0 && hasValue)          options.maxSampleRate = std::atof (argv[++i]);
+        else if (std::strcmp (arg, "--max-channels") == 0 && hasValue)      options.maxChannels = std::atoi (argv[++i]);
+        else if (std::strcmp (arg, "--verbose") == 0)                       options.verbose = true;
+        else
+        {
+            options.socketPath.clear();
+            options.useStdio = false;
+            break;
+        }
+    }
+
+    const bool valid = (options.socketPath.empty() != ! options.useStdio)
+                    && options.maxStreams > 0 && options.blockSize >= 16 && options.blockSize <= ShifterCore::runLength * ShifterCore::maxRuns
+                    && options.queueBlocks >= 2 && options.deadlineBlocks > 0.0
+                    && options.maxSampleRate >= 8000.0 && options.maxChannels > 0;
+
+    if (! valid)
+    {
+        std::fprintf (stderr, "usage: pitchshifterd (--socket <path> | --stdio) [--max-streams <n>] [--threads <n>]\n"
+                              "                     [--block <frames>] [--queue <blocks>] [--deadline <blocks>]\n"
+                              "                     [--max-rate <hz>] [--max-channels <n>] [--verbose]\n");
+        return 1;
+    }
+
+    // a client vanishing mid-write shows up as EPIPE on that stream, not as a dead daemon
+    std::signal (SIGPIPE, SIG_IGN);
+    std::signal (SIGINT, handleSignal);
+    std::signal (SIGTERM, handleSignal);
+
+    StreamServer server (options);
+    return server.run();
+}
@@ -0,0 +1,169 @@
+/*
+  ==============================================================================
+
+    StreamPool.cpp
+
+  ==============================================================================
+*/
+
+#include "StreamPool.h"
+
+#include <algorithm>
+#include <cmath>
+
+Stream::Stream (int streamId, int maxChannelsToUse, int blockSizeToUse, double maxSampleRate, int numSlotsToUse)
+    : id (streamId), blockSize (blockSizeToUse), maxChannels (maxChannelsToUse), numSlots (numSlotsToUse)
+{
+    const auto blockFloats = (size_t) blockSize * (size_t) maxChannels;
+
+    inputBlocks.assign (blockFloats * (size_t) numSlots, 0.0f);
+    outputBlocks.assign (blockFloats * (size_t) numSlots, 0.0f);
+    inputFrames.assign ((size_t) numSlots, 0);
+    outputFrames.assign ((size_t) numSlots, 0);
+    deadlines.assign ((size_t) numSlots, Clock::time_point());
+    planar.assign (blockFloats, 0.0f);
+    channels.assign ((size_t) maxChannels, nullptr);
+
+    // the widest, fastest layout sizes every buffer; later prepares only reuse them
+    core.prepare (maxChannels, blockSize, maxSampleRate);
+}
+
+void Stream::start (const StreamProtocol::Header& newHeader, int newInputFd, int newOutputFd)
+{
+    header = newHeader;
+    inputFd = newInputFd;
+    outputFd = newOutputFd;
+    numChannels = (int) header.numChannels;
+    sampleRate = (double) header.sampleRate;
+
+    for (int channel = 0; channel < numChannels; ++channel)
+        channels[(size_t) channel] = planar.data() + (size_t) channel * (size_t) blockSize;
+
+    core.prepare (numChannels, blockSize, sampleRate);
+    core.setNumVoices ((int) header.numVoices);
+    core.setWindowSize (std::min (300.0f, std::max (5.0f, header.windowMs)));
+    core.setWindowShape ((GrainWindow::Shape) std::min<uint32_t> (header.windowShape, GrainWindow::numShapes - 1));
+    core.setInterpolation ((Interpolation::Type) std::min<uint32_t> (header.interpolation, Interpolation::numTypes - 1));
+    core.setLowLatency (header.lowLatency != 0);
+    core.setMix (header.mixPercent / 100.0f);
+    core.setOutputGain (std::pow (10.0f, header.outputGainDb / 20.0f));
+
+    for (int voice = 0; voice < StreamProtocol::maxVoices; ++voice)
+    {
+        core.setTranspo (voice, header.transpo[voice]);
+        core.setGain (voice, header.gainDb[voice] > -60.0f ? std::pow (10.0f, header.gainDb[voice] / 20.0f) : 0.0f);
+    }
+
+    core.reset();
+    phase = streaming;
+}
+
+int Stream::getLatencySamples() const noexcept
+{
+    return (int) std::lround (core.getLatencySamples());
+}
+
+void Stream::clear() noexcept
+{
+    inputFd = outputFd = -1;
+    numChannels = 0;
+    phase = idle;
+    headerBytes = inputBytes = outputBytes = 0;
+    inputEnded = false;
+
+    inputWritten = inputRead = outputWritten = outputRead = 0;
+
+    numBlocks = numLate = 0;
+    worstLatenessMs = -1.0e9;
+}
+
+bool Stream::hasWork() const noexcept
+{
+    return inputRead.load() != inputWritten.load()
+        && outputWritten.load() - outputRead.load() < (uint32_t) numSlots;
+}
+
+Clock::time_point Stream::getNextDeadline() const noexcept
+{
+    return deadlines[(size_t) (inputRead.load() % (uint32_t) numSlots)];
+}
+
+void Stream::publishInput (int numFrames, Clock::time_point deadline) noexcept
+{
+    const auto slot = (size_t) (inputWritten.load() % (uint32_t) numSlots);
+    inputFrames[slot] = numFrames;
+    deadlines[slot] = deadline;
+    inputWritten.fetch_add (1);
+}
+
+void Stream::renderBlock() noexcept
+{
+    const auto inSlot = (size_t) (inputRead.load() % (uint32_t) numSlots);
+    const auto outSlot = (size_t) (outputWritten.load() % (uint32_t) numSlots);
+    const float* in = inputBlocks.data() + getSlotOffset (inputRead.load());
+    float* out = outputBlocks.data() + getSlotOffset (outputWritten.load());
+
+    // a short last block is padded, so the core always sees whole blocks
+    const int numFrames = inputFrames[inSlot];
+
+    for (int channel = 0; channel < numChannels; ++channel)
+    {
+        float* row = channels[(size_t) channel];
+
+        for (int i = 0; i < numFrames; ++i)
+            row[i] = in[i * numChannels + channel];
+
+        std::fill (row + numFrames, row + blockSize, 0.0f);
+    }
+
+    core.process (channels.data(), channels.data(), blockSize);
+
+    for (int i = 0; i < numFrames; ++i)
+        for (int channel = 0; channel < numChannels; ++channel)
+            out[i * numChannels + channel] = channels[(size_t) channel][i];
+
+    const double latenessMs = std::chrono::duration<double, std::milli> (Clock::now() - deadlines[inSlot]).count();
+    worstLatenessMs = std::max (worstLatenessMs, latenessMs);
+    numLate += latenessMs > 0.0 ? 1 : 0;
+    ++numBlocks;
+
+    outputFrames[outSlot] = numFrames;
+    outputWritten.fetch_add (1);
+    inputRead.fetch_add (1);
+}
+
+bool Stream::isDrained() const noexcept
+{
+    return inputRead.load() == inputWritten.load() && outputRead.load() == outputWritten.load() && ! queued.load();
+}
+
+//==============================================================================
+StreamPool::StreamPool (int maxStreams, int maxChannels, int blockSize, double maxSampleRate, int numSlots)
+{
+    streams.reserve ((size_t) maxStreams);
+    freeList.reserve ((size_t) maxStreams);
+
+    for (int i = 0; i < maxStreams; ++i)
+        streams.push_back (std::make_unique<Stream> (i, maxChannels, blockSize, maxSampleRate, numSlots));
+
+    // handed out lowest id first
+    for (int i = maxStreams; --i >= 0;)
+        freeList.push_back (streams[(size_t) i].get());
+}
+
+Stream* StreamPool::acquire() noexcept
+{
+    if (freeList.empty())
+        return nullptr;
+
+    auto* stream = freeList.back();
+    freeList.pop_back();
+    stream->phase = Stream::awaitingHeader;
+    return stream;
+}
+
+void StreamPool::release (Stream& stream) noexcept
+{
+    stream.clear();
+    freeList.push_back (&stream);
+}
@@ -0,0 +1,154 @@
+/*
+  ==============================================================================
+
+    StreamPool.h
+    Per-connection state, allocated once at startup and reused.
+
+    Every slot is prepared for the widest channel count and highest sample
+    rate the server accepts, so taking one for a new connection only
+    re-prepares memory it already owns: connection churn never allocates.
+
+    Audio moves through two single-producer single-consumer rings of blocks.
+    The I/O thread fills input blocks and drains output blocks; whichever
+    worker the scheduler hands the stream to renders from one to the other.
+    The counters only ever grow, and their differences give the fill.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "StreamProtocol.h"
+#include "../../../Source/ShifterCore.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+class Stream
+{
+public:
+    Stream (int id, int maxChannels, int blockSize, double maxSampleRate, int numSlots);
+
+    /** Sets the stream up from a validated header. No allocation. I/O thread. */
+    void start (const StreamProtocol::Header& header, int inputFd, int outputFd);
+
+    /** Puts the slot back in its idle state once nothing refers to it any more. */
+    void clear() noexcept;
+
+    /** True when an input block is waiting and there's room for its output. Any thread. */
+    bool hasWork() const noexcept;
+
+    /** When the oldest waiting input block has to be finished by. */
+    Clock::time_point getNextDeadline() const noexcept;
+
+    /** Renders the oldest waiting input block. Worker thread, one at a time. */
+    void renderBlock() noexcept;
+
+    //==============================================================================
+    // the I/O thread's side of the rings
+    bool canReadInput() const noexcept      { return inputWritten.load() - inputRead.load() < (uint32_t) numSlots; }
+    float* getInputBlock() noexcept         { return inputBlocks.data() + getSlotOffset (inputWritten.load()); }
+    void publishInput (int numFrames, Clock::time_point deadline) noexcept;
+
+    bool hasOutput() const noexcept         { return outputRead.load() != outputWritten.load(); }
+    const float* getOutputBlock() const noexcept    { return outputBlocks.data() + getSlotOffset (outputRead.load()); }
+    int getOutputFrames() const noexcept    { return outputFrames[(size_t) (outputRead.load() % (uint32_t) numSlots)]; }
+    void consumeOutput() noexcept           { outputRead.fetch_add (1); }
+
+    bool isDrained() const noexcept;
+
+    /** The delay of the shifted signal for the settings the stream started with. */
+    int getLatencySamples() const noexcept;
+
+    //==============================================================================
+    const int id;
+    const int blockSize;
+
+    int inputFd = -1;
+    int outputFd = -1;
+    int numChannels = 0;
+    double sampleRate = 0.0;
+
+    // set while the stream sits in the scheduler's queue or a worker is on it
+    std::atomic<bool> queued { false };
+
+    // I/O thread bookkeeping: where the connection is, and how far into the current blocks
+    enum Phase
+    {
+        idle,
+        awaitingHeader,
+        streaming,
+        closing
+    };
+
+    Phase phase = idle;
+    StreamProtocol::Header header {};
+    size_t headerBytes = 0;
+    size_t inputBytes = 0;
+    size_t outputBytes = 0;
+    bool inputEnded = false;
+
+    // written by the worker, read by the I/O thread once the stream is drained
+    uint64_t numBlocks = 0;
+    uint64_t numLate = 0;
+    double worstLatenessMs = -1.0e9;
+
+private:
+    size_t getSlotOffset (uint32_t counter) const noexcept
+    {
+        return (size_t) (counter % (uint32_t) numSlots) * (size_t) blockSize * (size_t) maxChannels;
+    }
+
+    const int maxChannels;
+    const int numSlots;
+
+    ShifterCore core;
+
+    std::vector<float> inputBlocks;
+    std::vector<float> outputBlocks;
+    std::vector<int> inputFrames;
+    std::vector<int> outputFrames;
+    std::vector<Clock::time_point> deadlines;
+
+    std::atomic<uint32_t> inputWritten { 0 };
+    std::atomic<uint32_t> inputRead { 0 };
+    std::atomic<uint32_t> outputWritten { 0 };
+    std::atomic<uint32_t> outputRead { 0 };
+
+    // planar rows the core renders in, and pointers to them
+    std::vector<float> planar;
+    std::vector<float*> channels;
+};
+
+//==============================================================================
+class StreamPool
+{
+public:
+    StreamPool (int maxStreams, int maxChannels, int blockSize, double maxSampleRate, int numSlots);
+
+    /** Returns an idle stream, or nullptr when every slot is taken. */
+    Stream* acquire() noexcept;
+
+    /** Hands a drained stream back. */
+    void release (Stream& stream) noexcept;
+
+    int getNumActive() const noexcept       { return (int) streams.size() - (int) freeList.size(); }
+    int getMaxStreams() const noexcept      { return (int) streams.size(); }
+
+    template <typename Callback>
+    void forEachActive (Callback&& callback)
+    {
+        for (auto& stream : streams)
+            if (stream->phase != Stream::idle)
+                callback (*stream);
+    }
+
+private:
+    std::vector<std::unique_ptr<Stream>> streams;
+    std::vector<Stream*> freeList;
+};
@@ -0,0 +1,80 @@
+/*
+  ==============================================================================
+
+    StreamProtocol.h
+    What goes over a pitchshifterd connection.
+
+    The client opens the stream with a Header, the server answers with a
+    Reply, and from then on the client sends interleaved 32-bit float frames
+    and gets the same number of shifted frames back, in order. Shutting down
+    the write side ends the stream: the server renders what's left, pads the
+    last block internally, sends exactly as many frames as it received and
+    closes. Everything is in native byte order, since both ends are on the
+    same machine.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <cstdint>
+
+namespace StreamProtocol
+{
+    constexpr uint32_t magic = 0x64735350;      // "PSsd"
+    constexpr uint32_t version = 1;
+    constexpr int maxVoices = 16;
+
+    struct Header
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t sampleRate;
+        uint32_t numChannels;
+        uint32_t numVoices;
+        uint32_t windowShape;       // GrainWindow::Shape
+        uint32_t interpolation;     // Interpolation::Type
+        uint32_t lowLatency;
+        float windowMs;
+        float mixPercent;
+        float outputGainDb;
+        float reserved;
+        float transpo[maxVoices];   // semitones
+        float gainDb[maxVoices];    // -60 and below is silent
+    };
+
+    enum Status : uint32_t
+    {
+        ok = 0,
+        badHeader,          // wrong magic or version
+        unsupportedFormat,  // sample rate or channel count beyond what the server was started for
+        serverFull          // every stream slot is taken
+    };
+
+    /** Audio follows only when status is ok; otherwise the server closes the connection. */
+    struct Reply
+    {
+        uint32_t magic;
+        uint32_t status;
+        uint32_t blockSize;         // frames the server renders at a time
+        uint32_t latencySamples;    // delay of the shifted signal, for the client to compensate
+    };
+
+    /** The plugin's defaults: two voices at 0 semitones, a 50 ms sine window, fully wet. */
+    inline Header makeHeader (uint32_t sampleRate, uint32_t numChannels) noexcept
+    {
+        Header header {};
+        header.magic = magic;
+        header.version = version;
+        header.sampleRate = sampleRate;
+        header.numChannels = numChannels;
+        header.numVoices = 2;
+        header.windowMs = 50.0f;
+        header.mixPercent = 100.0f;
+
+        for (int voice = 0; voice < maxVoices; ++voice)
+            header.gainDb[voice] = 0.0f;
+
+        return header;
+    }
+}
@@ -0,0 +1,454 @@
+/*
+  ==============================================================================
+
+    StreamServer.cpp
+
+  ==============================================================================
+*/
+
+#include "StreamServer.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace
+{
+    std::atomic<bool> stopRequested { false };
+    int signalWakeFd = -1;
+
+    void wakeUp (int fd) noexcept
+    {
+        // a full pipe already has a wake-up in it, so a failed write loses nothing
+        const char byte = 0;
+        [[maybe_unused]] const auto result = ::write (fd, &byte, 1);
+    }
+
+    bool setNonBlocking (int fd) noexcept
+    {
+        const int flags = ::fcntl (fd, F_GETFL);
+        return flags >= 0 && ::fcntl (fd, F_SETFL, flags | O_NONBLOCK) == 0;
+    }
+
+    bool isRetry (ssize_t result) noexcept
+    {
+        return result < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR);
+    }
+}
+
+StreamServer::StreamServer (const Options& optionsToUse)
+    : options (optionsToUse),
+      pool (options.useStdio ? 1 : options.maxStreams, options.maxChannels, options.blockSize,
+            options.maxSampleRate, options.queueBlocks)
+{
+    if (::pipe (wakePipe) == 0)
+    {
+        setNonBlocking (wakePipe[0]);
+        setNonBlocking (wakePipe[1]);
+        signalWakeFd = wakePipe[1];
+    }
+
+    const int numThreads = options.numThreads > 0 ? options.numThreads
+                                                  : (int) std::max (1u, std::thread::hardware_concurrency());
+
+    const int wakeFd = wakePipe[1];
+    scheduler = std::make_unique<BlockScheduler> (numThreads, pool.getMaxStreams(), [wakeFd] { wakeUp (wakeFd); });
+
+    // the wake pipe, the listener, and up to two descriptors per stream
+    pollFds.reserve ((size_t) pool.getMaxStreams() * 2 + 2);
+    pollStreams.reserve (pollFds.capacity());
+}
+
+StreamServer::~StreamServer()
+{
+    // the workers go first: they touch the streams and the wake pipe
+    scheduler.reset();
+
+    pool.forEachActive ([this] (Stream& stream) { finish (stream); });
+
+    if (listenFd >= 0)
+    {
+        ::close (listenFd);
+        ::unlink (options.socketPath.c_str());
+    }
+
+    signalWakeFd = -1;
+    ::close (wakePipe[0]);
+    ::close (wakePipe[1]);
+}
+
+void StreamServer::stop() noexcept
+{
+    stopRequested = true;
+
+    if (signalWakeFd >= 0)
+        wakeUp (signalWakeFd);
+}
+
+bool StreamServer::openListener()
+{
+    sockaddr_un address {};
+    address.sun_family = AF_UNIX;
+
+    if (options.socketPath.size() >= sizeof (address.sun_path))
+    {
+        std::fprintf (stderr, "pitchshifterd: socket path too long: %s\n", options.socketPath.c_str());
+        return false;
+    }
+
+    std::strcpy (address.sun_path, options.socketPath.c_str());
+
+    // a socket left behind by an earlier run would make bind fail; anything else is left alone
+    struct stat info;
+
+    if (::stat (address.sun_path, &info) == 0 && S_ISSOCK (info.st_mode))
+        ::unlink (address.sun_path);
+
+    listenFd = ::socket (AF_UNIX, SOCK_STREAM, 0);
+
+    if (listenFd < 0
+        || ::bind (listenFd, reinterpret_cast<const sockaddr*> (&address), sizeof (address)) != 0
+        || ::listen (listenFd, 128) != 0
+        || ! setNonBlocking (listenFd))
+    {
+        std::fprintf (stderr, "pitchshifterd: can't listen on %s: %s\n", options.socketPath.c_str(), std::strerror (errno));
+        return false;
+    }
+
+    return true;
+}
+
+int StreamServer::run()
+{
+    if (wakePipe[0] < 0)
+        return 1;
+
+    if (options.useStdio)
+    {
+        auto* stream = pool.acquire();
+        stream->inputFd = STDIN_FILENO;
+        stream->outputFd = STDOUT_FILENO;
+        setNonBlocking (STDIN_FILENO);
+        setNonBlocking (STDOUT_FILENO);
+    }
+    else if (! openListener())
+    {
+        return 1;
+    }
+
+    while (! stopRequested.load())
+    {
+        pollFds.clear();
+        pollStreams.clear();
+
+        pollFds.push_back ({ wakePipe[0], POLLIN, 0 });
+        pollStreams.push_back (nullptr);
+
+        // a full server still accepts, to turn the connection away with a reply
+        if (listenFd >= 0)
+        {
+            pollFds.push_back ({ listenFd, POLLIN, 0 });
+            pollStreams.push_back (nullptr);
+        }
+
+        pool.forEachActive ([this] (Stream& stream) { addToPoll (stream); });
+
+        if (::poll (pollFds.data(), (nfds_t) pollFds.size(), -1) < 0 && errno != EINTR)
+        {
+            std::fprintf (stderr, "pitchshifterd: poll failed: %s\n", std::strerror (errno));
+            break;
+        }
+
+        if (pollFds[0].revents != 0)
+        {
+            char drain[64];
+            while (::read (wakePipe[0], drain, sizeof (drain)) > 0) {}
+        }
+
+        if (listenFd >= 0 && pollFds[1].revents != 0)
+            acceptConnections();
+
+        for (size_t i = 0; i < pollFds.size(); ++i)
+        {
+            auto* stream = pollStreams[i];
+            const auto revents = pollFds[i].revents;
+
+            if (stream == nullptr || revents == 0 || stream->phase == Stream::closing)
+                continue;
+
+            if ((revents & (POLLIN | POLLHUP)) != 0 && pollFds[i].fd == stream->inputFd && wantsInput (*stream))
+            {
+                if (stream->phase == Stream::awaitingHeader)
+                    readHeader (*stream);
+                else
+                    readInput (*stream);
+            }
+
+            if ((revents & POLLOUT) != 0 && pollFds[i].fd == stream->outputFd)
+                writeOutput (*stream);
+
+            if ((revents & (POLLERR | POLLNVAL)) != 0)
+                beginClosing (*stream);
+        }
+
+        bool stdioDone = false;
+
+        pool.forEachActive ([this, &stdioDone] (Stream& stream)
+        {
+            const bool complete = stream.phase == Stream::streaming && stream.inputEnded && stream.isDrained();
+            const bool abandoned = stream.phase == Stream::closing && ! stream.queued.load();
+
+            if (complete || abandoned)
+            {
+                stdioDone = options.useStdio;
+                finish (stream);
+            }
+        });
+
+        if (stdioDone)
+            break;
+    }
+
+    std::fprintf (stderr, "pitchshifterd: served %llu streams, turned away %llu, rendered %llu blocks, %llu late (worst %.2f ms)\n",
+                  (unsigned long long) numServed, (unsigned long long) numRejected,
+                  (unsigned long long) scheduler->getNumBlocks(), (unsigned long long) numLate,
+                  numServed > 0 ? worstLatenessMs : 0.0);
+    return 0;
+}
+
+void StreamServer::addToPoll (Stream& stream)
+{
+    if (stream.phase == Stream::closing)
+        return;
+
+    const short inputEvents = wantsInput (stream) ? POLLIN : 0;
+    const short outputEvents = stream.hasOutput() ? POLLOUT : 0;
+
+    // a socket is polled even with nothing wanted, so a hang-up or error still shows
+    if (stream.inputFd == stream.outputFd)
+    {
+        pollFds.push_back ({ stream.inputFd, (short) (inputEvents | outputEvents), 0 });
+        pollStreams.push_back (&stream);
+        return;
+    }
+
+    if (inputEvents != 0)
+    {
+        pollFds.push_back ({ stream.inputFd, inputEvents, 0 });
+        pollStreams.push_back (&stream);
+    }
+
+    if (outputEvents != 0)
+    {
+        pollFds.push_back ({ stream.outputFd, outputEvents, 0 });
+        pollStreams.push_back (&stream);
+    }
+}
+
+void StreamServer::acceptConnections()
+{
+    for (;;)
+    {
+        const int fd = ::accept (listenFd, nullptr, nullptr);
+
+        if (fd < 0)
+            return;
+
+        auto* stream = pool.acquire();
+
+        if (stream == nullptr || ! setNonBlocking (fd))
+        {
+            sendReply (fd, StreamProtocol::serverFull, 0);
+            ::close (fd);
+
+            if (stream != nullptr)
+                pool.release (*stream);
+
+            ++numRejected;
+            continue;
+        }
+
+        stream->inputFd = stream->outputFd = fd;
+    }
+}
+
+bool StreamServer::wantsInput (const Stream& stream) const noexcept
+{
+    if (stream.phase == Stream::awaitingHeader)
+        return true;
+
+    return stream.phase == Stream::streaming && ! stream.inputEnded && stream.canReadInput();
+}
+
+Clock::time_point StreamServer::getDeadline (const Stream& stream) const noexcept
+{
+    const double seconds = options.deadlineBlocks * stream.blockSize / stream.sampleRate;
+    return Clock::now() + std::chrono::duration_cast<Clock::duration> (std::chrono::duration<double> (seconds));
+}
+
+void StreamServer::readHeader (Stream& stream)
+{
+    auto* dest = reinterpret_cast<char*> (&stream.header) + stream.headerBytes;
+    const auto result = ::read (stream.inputFd, dest, sizeof (StreamProtocol::Header) - stream.headerBytes);
+
+    if (isRetry (result))
+        return;
+
+    if (result <= 0)
+    {
+        beginClosing (stream);
+        return;
+    }
+
+    stream.headerBytes += (size_t) result;
+
+    if (stream.headerBytes < sizeof (StreamProtocol::Header))
+        return;
+
+    const auto& header = stream.header;
+    auto status = StreamProtocol::ok;
+
+    if (header.magic != StreamProtocol::magic || header.version != StreamProtocol::version)
+        status = StreamProtocol::badHeader;
+    else if (header.numChannels < 1 || (int) header.numChannels > options.maxChannels
+             || header.sampleRate < 8000 || header.sampleRate > options.maxSampleRate)
+        status = StreamProtocol::unsupportedFormat;
+
+    if (status != StreamProtocol::ok)
+    {
+        sendReply (stream.outputFd, status, 0);
+        ++numRejected;
+        beginClosing (stream);
+        return;
+    }
+
+    stream.start (header, stream.inputFd, stream.outputFd);
+
+    if (! sendReply (stream.outputFd, StreamProtocol::ok, stream.getLatencySamples()))
+        beginClosing (stream);
+}
+
+bool StreamServer::sendReply (int fd, StreamProtocol::Status status, int latencySamples) const noexcept
+{
+    const StreamProtocol::Reply reply { StreamProtocol::magic, status, (uint32_t) options.blockSize, (uint32_t) latencySamples };
+
+    // nothing has been written to the connection yet, so the reply always fits in its buffer
+    return ::write (fd, &reply, sizeof (reply)) == (ssize_t) sizeof (reply);
+}
+
+void StreamServer::readInput (Stream& stream)
+{
+    const size_t frameBytes = sizeof (float) * (size_t) stream.numChannels;
+    const size_t blockBytes = frameBytes * (size_t) stream.blockSize;
+
+    while (stream.canReadInput())
+    {
+        auto* dest = reinterpret_cast<char*> (stream.getInputBlock()) + stream.inputBytes;
+        const auto result = ::read (stream.inputFd, dest, blockBytes - stream.inputBytes);
+
+        if (isRetry (result))
+            return;
+
+        if (result < 0)
+        {
+            beginClosing (stream);
+            return;
+        }
+
+        if (result == 0)
+        {
+            endInput (stream);
+            return;
+        }
+
+        stream.inputBytes += (size_t) result;
+
+        if (stream.inputBytes == blockBytes)
+        {
+            stream.publishInput (stream.blockSize, getDeadline (stream));
+            stream.inputBytes = 0;
+            scheduler->schedule (stream);
+        }
+    }
+}
+
+void StreamServer::endInput (Stream& stream)
+{
+    stream.inputEnded = true;
+
+    // the last block goes out short; a trailing partial frame is dropped
+    const int numFrames = (int) (stream.inputBytes / (sizeof (float) * (size_t) stream.numChannels));
+    stream.inputBytes = 0;
+
+    if (numFrames > 0)
+    {
+        stream.publishInput (numFrames, getDeadline (stream));
+        scheduler->schedule (stream);
+    }
+}
+
+void StreamServer::writeOutput (Stream& stream)
+{
+    while (stream.hasOutput())
+    {
+        const size_t blockBytes = sizeof (float) * (size_t) stream.numChannels * (size_t) stream.getOutputFrames();
+        const auto* src = reinterpret_cast<const char*> (stream.getOutputBlock()) + stream.outputBytes;
+        const auto result = ::write (stream.outputFd, src, blockBytes - stream.outputBytes);
+
+        if (isRetry (result))
+            return;
+
+        if (result <= 0)
+        {
+            beginClosing (stream);
+            return;
+        }
+
+        stream.outputBytes += (size_t) result;
+
+        if (stream.outputBytes == blockBytes)
+        {
+            stream.consumeOutput();
+            stream.outputBytes = 0;
+
+            // a stream held up by its full output ring can carry on now
+            scheduler->schedule (stream);
+        }
+    }
+}
+
+void StreamServer::beginClosing (Stream& stream) noexcept
+{
+    // anything still queued is rendered and discarded; the slot is freed once no worker holds it
+    stream.phase = Stream::closing;
+}
+
+void StreamServer::finish (Stream& stream)
+{
+    if (stream.numBlocks > 0)
+    {
+        ++numServed;
+        numLate += stream.numLate;
+        worstLatenessMs = std::max (worstLatenessMs, stream.worstLatenessMs);
+
+        if (options.verbose)
+            std::fprintf (stderr, "pitchshifterd: stream %d done: %.0f Hz, %d ch, %llu blocks, %llu late (worst %.2f ms)\n",
+                          stream.id, stream.sampleRate, stream.numChannels, (unsigned long long) stream.numBlocks,
+                          (unsigned long long) stream.numLate, stream.worstLatenessMs);
+    }
+
+    if (stream.inputFd >= 0)
+        ::close (stream.inputFd);
+
+    if (stream.outputFd >= 0 && stream.outputFd != stream.inputFd)
+        ::close (stream.outputFd);
+
+    pool.release (stream);
+}
@@ -0,0 +1,85 @@
+/*
+  ==============================================================================
+
+    StreamServer.h
+    The I/O side of pitchshifterd: one thread, one poll() loop.
+
+    Listens on a Unix socket for any number of streams, or serves a single
+    stream over stdin and stdout so the daemon can sit in a pipeline or
+    behind named pipes. Every descriptor is non-blocking. The loop moves
+    bytes between the connections and each stream's block rings and hands
+    complete blocks to the BlockScheduler; workers wake it through a pipe
+    when output is ready.
+
+    A stream's connection is only read while its input ring has room, and
+    its input ring only drains while its output ring has room, so a client
+    that stops reading soon finds its writes blocking too.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "BlockScheduler.h"
+
+#include <poll.h>
+#include <string>
+
+class StreamServer
+{
+public:
+    struct Options
+    {
+        std::string socketPath;
+        bool useStdio = false;
+        int maxStreams = 256;
+        int maxChannels = 2;
+        double maxSampleRate = 48000.0;
+        int blockSize = 256;
+        int queueBlocks = 8;
+        int numThreads = 0;             // 0 is one per core
+        double deadlineBlocks = 1.0;    // how long after arriving a block has to be rendered, in blocks
+        bool verbose = false;
+    };
+
+    explicit StreamServer (const Options& options);
+    ~StreamServer();
+
+    /** Serves until stop() is called, or with stdio until its stream ends. Returns an exit code. */
+    int run();
+
+    /** Safe to call from a signal handler. */
+    static void stop() noexcept;
+
+private:
+    bool openListener();
+    void acceptConnections();
+    void addToPoll (Stream& stream);
+
+    void readHeader (Stream& stream);
+    void readInput (Stream& stream);
+    void endInput (Stream& stream);
+    void writeOutput (Stream& stream);
+    bool sendReply (int fd, StreamProtocol::Status status, int latencySamples) const noexcept;
+
+    void beginClosing (Stream& stream) noexcept;
+    void finish (Stream& stream);
+
+    bool wantsInput (const Stream& stream) const noexcept;
+    Clock::time_point getDeadline (const Stream& stream) const noexcept;
+
+    Options options;
+    StreamPool pool;
+    int wakePipe[2] = { -1, -1 };
+    int listenFd = -1;
+    std::unique_ptr<BlockScheduler> scheduler;
+
+    // rebuilt every pass from storage reserved up front; a stream on stdio takes two entries
+    std::vector<pollfd> pollFds;
+    std::vector<Stream*> pollStreams;
+
+    uint64_t numServed = 0;
+    uint64_t numRejected = 0;
+    uint64_t numLate = 0;
+    double worstLatenessMs = -1.0e9;
+};